@@ -2,6 +2,7 @@
 
 // WARNING: sequence matters, System::IServiceProvider vs WinAPI IServiceProvider
 #include <msclr\marshal_cppstd.h>
+#include <vcclr.h>
 
 #include "ImGuiCLI.h"
 
@@ -34,6 +35,27 @@ inline std::string ToSTLString(System::String^ str)
     return stlStr;
 }
 
+// Encodes straight into the per-frame arena (see ImGui::MemAllocFrame), no std::string and no heap allocation.
+// Result is null terminated and only valid until the next NewFrame(), so it must be used between NewFrame() and Render().
+inline const char* ToFrameString(System::String^ str, const char** outEnd = nullptr)
+{
+    int byteCount = 0;
+    char* buf = nullptr;
+    if (str != nullptr && str->Length > 0)
+    {
+        pin_ptr<const wchar_t> chars = PtrToStringChars(str);
+        byteCount = System::Text::Encoding::UTF8->GetByteCount((wchar_t*)chars, str->Length);
+        buf = (char*)ImGui::MemAllocFrame(byteCount + 1);
+        System::Text::Encoding::UTF8->GetBytes((wchar_t*)chars, str->Length, (unsigned char*)buf, byteCount);
+    }
+    else
+        buf = (char*)ImGui::MemAllocFrame(1);
+    buf[byteCount] = 0;
+    if (outEnd)
+        *outEnd = buf + byteCount;
+    return buf;
+}
+
 inline void CopyStrBuff(System::String^ str, char* target)
 {        
     // Just retun out if the string is null
@@ -452,9 +474,26 @@ namespace ImGuiCLI
     void ImGuiCli::PushID(int id) { ImGui::PushID(id); }
     void ImGuiCli::PopID() { ImGui::PopID(); }
 
-    void ImGuiCli::Label(System::String^ label, System::String^ text) { ImGui::LabelText(LBL, ToSTLString(text).c_str()); }
-    void ImGuiCli::Text(System::String^ label) { return ImGui::Text(LBL); }
-    void ImGuiCli::TextWrapped(System::String^ label) { return ImGui::TextWrapped(LBL); }
+    // Text paths are routed through the unformatted entry points: user strings are not printf formats (a '%' would be misinterpreted) and
+    // skipping the ImFormatStringV() pass matters for log/inspector views emitting thousands of lines a frame.
+    void ImGuiCli::Label(System::String^ label, System::String^ text)
+    {
+        const char* textEnd;
+        const char* textStr = ToFrameString(text, &textEnd);
+        ImGui::LabelTextUnformatted(ToFrameString(label), textStr, textEnd);
+    }
+    void ImGuiCli::Text(System::String^ label)
+    {
+        const char* textEnd;
+        const char* text = ToFrameString(label, &textEnd);
+        ImGui::TextUnformatted(text, textEnd);
+    }
+    void ImGuiCli::TextWrapped(System::String^ label)
+    {
+        const char* textEnd;
+        const char* text = ToFrameString(label, &textEnd);
+        ImGui::TextWrappedUnformatted(text, textEnd);
+    }
     bool ImGuiCli::Button(System::String^ label) { return ImGui::Button(LBL); }
     bool ImGuiCli::Button(System::String^ label, Vector2 size) { return ImGui::Button(LBL, ImVec2(size.X, size.Y)); }
     bool ImGuiCli::ArrowButton(System::String^ label, ImGuiDir_ dir) { return ImGui::ArrowButton(LBL, (ImGuiDir)dir); }
@@ -604,7 +643,12 @@ namespace ImGuiCLI
     void ImGuiCli::NextColumn() { ImGui::NextColumn(); }
     float ImGuiCli::GetColumnWidth(int idx) { return ImGui::GetColumnWidth(idx); }
 
-    void ImGuiCli::SetTooltip(System::String^ label) { ImGui::SetTooltip(LBL); }
+    void ImGuiCli::SetTooltip(System::String^ label)
+    {
+        const char* textEnd;
+        const char* text = ToFrameString(label, &textEnd);
+        ImGui::SetTooltipUnformatted(text, textEnd);
+    }
     void ImGuiCli::BeginTooltip() { ImGui::BeginTooltip(); }
     void ImGuiCli::EndTooltip() { ImGui::EndTooltip(); }
 
@@ -704,6 +748,10 @@ namespace ImGuiCLI
     void ImGuiCli::ShowMetricsWindow() { ImGui::ShowMetricsWindow(); }
     void ImGuiCli::ShowStyleEditor() { ImGui::ShowStyleEditor(); }
 
+    void ImGuiCli::ProfileBegin(System::String^ name) { ImGui::ProfilerPush(ToSTLString(name).c_str(), true); }
+    void ImGuiCli::ProfileEnd() { ImGui::ProfilerPop(); }
+    bool ImGuiCli::ExportProfile(System::String^ path, int frames) { return ImGui::ProfilerExportChromeTrace(ToSTLString(path).c_str(), frames); }
+
     bool ImGuiEx::DragMatrix(Matrix% matrix)
     {
         Matrix m = matrix;
@@ -49,6 +49,7 @@ namespace ImGuiCLI {
         AlwaysHorizontalScrollbar = 1 << 15,  // Always show horizontal scrollbar (even if ContentSize.x < Size.x)
         AlwaysUseWindowPadding = 1 << 16,  // Ensure child windows without border uses style.WindowPadding (ignored by default for non-bordered child windows, because more convenient)
         ResizeFromAnySide = 1 << 17,  // (WIP) Enable resize from any corners and borders. Your back-end needs to honor the different values of io.MouseCursor set by imgui.
+        RetainDrawList = 1 << 20,  // (BETA) Reuse last frame vertices when the window content is unchanged and receives no input, skipping tessellation.
 
         // [Internal]
         ChildWindow = 1 << 24,  // Don't use! For internal use by BeginChild()
@@ -549,6 +550,13 @@ namespace ImGuiCLI {
         static void ShowDemoWindow();
         static void ShowMetricsWindow();
         static void ShowStyleEditor();
+
+        // Profiler (requires IMGUI_ENABLE_PROFILER, otherwise no-ops)
+        /// Opens a named timing scope, must be matched by ProfileEnd.
+        static void ProfileBegin(System::String^ name);
+        static void ProfileEnd();
+        /// Writes the last 'frames' profiled frames as Chrome trace JSON (-1 for all recorded frames).
+        static bool ExportProfile(System::String^ path, int frames);
 	};
 
     public ref class ImGuiEx
@@ -2,6 +2,7 @@
 #include "imgui.h"
 #include "imgui_internal.h"
 
+#include <limits>
 #include <vector>
 
 #undef max
@@ -23,6 +24,20 @@ namespace ImSequencer
         void Deactivate() { inThumb = inTrack = false; }
     };
 
+    // Keys per bucket of frames at every level of detail: a level 0 bucket is cLodBucketFrames frames wide, a bucket of
+    // the next level covers two of the level below. Drawn instead of the keys when frames are narrower than a pixel.
+    static const int cLodBucketFrames = 4;
+
+    struct KeyPyramid
+    {
+        int frameCount = 0;
+        TRACK_NATURE nature = TRACK_NATURE_DEFAULT;
+        std::vector<int> levelStarts;   // offset of every level in counts, plus the end
+        std::vector<int> counts;        // keys touching each bucket, levels in order
+        std::vector<int> maxCounts;     // highest count of every level, not lowered when keys move
+        unsigned int color = 0;
+    };
+
     struct Context
     {
         bool inTrackHeader = false;
@@ -35,6 +50,20 @@ namespace ImSequencer
         int movingPos = -1;
         int movingPart = -1;
         int verticalOffset = 0;
+
+        // key counts per track, valid while the sequence and its version stay the same
+        const SequenceInterface* keyCountSequence = nullptr;
+        unsigned keyCountVersion = 0;
+        std::vector<unsigned> keyCounts;
+        unsigned keyCountTotal = 0;
+
+        // frame width relative to the default one, under 1 when zoomed out
+        float zoom = 1.0f;
+
+        // key pyramids per track, built when first drawn and valid while the sequence and its version stay the same
+        const SequenceInterface* pyramidSequence = nullptr;
+        unsigned pyramidVersion = 0;
+        std::vector<KeyPyramid> pyramids;
     };
     static Context gContext;
 
@@ -58,13 +87,205 @@ namespace ImSequencer
 	static int min(int a, int b) { return (a < b) ? a : b; }
 	static int max(int a, int b) { return (a > b) ? a : b; }
 
+    // Returns false if the sequence has no version, its key counts are then asked for every time
+    static bool UpdateKeyCounts(SequenceInterface* sequence)
+    {
+        unsigned version = sequence->GetVersion();
+        if (version == 0)
+            return false;
+
+        int trackCount = sequence->GetTrackCount();
+        if (gContext.keyCountSequence != sequence || gContext.keyCountVersion != version || (int)gContext.keyCounts.size() != trackCount)
+        {
+            gContext.keyCountSequence = sequence;
+            gContext.keyCountVersion = version;
+            gContext.keyCounts.resize(trackCount);
+            gContext.keyCountTotal = 0;
+            for (int i = 0; i < trackCount; ++i)
+                gContext.keyCountTotal += gContext.keyCounts[i] = sequence->GetKeyFrameCount(i);
+        }
+        return true;
+    }
+
+    static unsigned GetKeyCount(SequenceInterface* sequence, int trackIndex)
+    {
+        return UpdateKeyCounts(sequence) ? gContext.keyCounts[trackIndex] : sequence->GetKeyFrameCount(trackIndex);
+    }
+
+    // First key of a sorted track that is drawn at or after frame, none of the keys before it are
+    static int FindFirstKeyFrom(SequenceInterface* sequence, int trackIndex, int keyCount, TRACK_NATURE nature, int frame)
+    {
+        int first = 0;
+        for (int count = keyCount; count > 0;)
+        {
+            int step = count / 2;
+            int *start, *end;
+            sequence->Get(trackIndex, first + step, &start, &end, NULL, NULL);
+
+            // a tick is one frame wide whatever its end
+            int last = nature == TRACK_NATURE_TICK ? *start : *end;
+            if (last < frame)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+                count = step;
+        }
+        return first;
+    }
+
+    static void GetKeyBuckets(const KeyPyramid& pyramid, int start, int end, int& first, int& last)
+    {
+        // a tick is one frame wide whatever its end
+        const int bucketCount = pyramid.levelStarts[1];
+        first = max(min(start / cLodBucketFrames, bucketCount - 1), 0);
+        last = max(min((pyramid.nature == TRACK_NATURE_TICK ? start : end) / cLodBucketFrames, bucketCount - 1), first);
+    }
+
+    static void BuildKeyPyramid(KeyPyramid& pyramid, SequenceInterface* sequence, int trackIndex, TRACK_NATURE nature, int frameCount)
+    {
+        pyramid.frameCount = frameCount;
+        pyramid.nature = nature;
+        pyramid.levelStarts.clear();
+        pyramid.levelStarts.push_back(0);
+        for (int size = max((frameCount + cLodBucketFrames - 1) / cLodBucketFrames, 1); ; size = (size + 1) / 2)
+        {
+            pyramid.levelStarts.push_back(pyramid.levelStarts.back() + size);
+            if (size == 1)
+                break;
+        }
+        pyramid.counts.assign(pyramid.levelStarts.back(), 0);
+        pyramid.maxCounts.assign(pyramid.levelStarts.size() - 1, 0);
+        pyramid.color = 0;
+
+        // every key adds one to the level 0 buckets it touches, through differences summed afterwards
+        const int bucketCount = pyramid.levelStarts[1];
+        std::vector<int> deltas(bucketCount + 1, 0);
+        unsigned keyCt = GetKeyCount(sequence, trackIndex);
+        for (unsigned keyIndex = 0; keyIndex < keyCt; ++keyIndex)
+        {
+            int *start, *end;
+            unsigned int color;
+            sequence->Get(trackIndex, keyIndex, &start, &end, NULL, &color);
+            if (keyIndex == 0)
+                pyramid.color = color;
+
+            int first, last;
+            GetKeyBuckets(pyramid, *start, *end, first, last);
+            ++deltas[first];
+            --deltas[last + 1];
+        }
+        for (int i = 0, count = 0; i < bucketCount; ++i)
+        {
+            count += deltas[i];
+            pyramid.counts[i] = count;
+            pyramid.maxCounts[0] = max(pyramid.maxCounts[0], count);
+        }
+
+        for (size_t level = 1; level + 1 < pyramid.levelStarts.size(); ++level)
+        {
+            const int* below = &pyramid.counts[pyramid.levelStarts[level - 1]];
+            const int belowCount = pyramid.levelStarts[level] - pyramid.levelStarts[level - 1];
+            for (int i = pyramid.levelStarts[level], j = 0; i < pyramid.levelStarts[level + 1]; ++i, j += 2)
+            {
+                pyramid.counts[i] = below[j] + (j + 1 < belowCount ? below[j + 1] : 0);
+                pyramid.maxCounts[level] = max(pyramid.maxCounts[level], pyramid.counts[i]);
+            }
+        }
+    }
+
+    // Adds count (1 or -1) to the buckets a key touches, at every level
+    static void UpdateKeyPyramid(KeyPyramid& pyramid, int start, int end, int count)
+    {
+        int first, last;
+        GetKeyBuckets(pyramid, start, end, first, last);
+        for (int i = first; i <= last; ++i)
+        {
+            pyramid.counts[i] += count;
+            pyramid.maxCounts[0] = max(pyramid.maxCounts[0], pyramid.counts[i]);
+        }
+
+        for (size_t level = 1; level + 1 < pyramid.levelStarts.size(); ++level)
+        {
+            first /= 2;
+            last /= 2;
+            const int* below = &pyramid.counts[pyramid.levelStarts[level - 1]];
+            const int belowCount = pyramid.levelStarts[level] - pyramid.levelStarts[level - 1];
+            int* counts = &pyramid.counts[pyramid.levelStarts[level]];
+            for (int i = first; i <= last; ++i)
+            {
+                counts[i] = below[i * 2] + (i * 2 + 1 < belowCount ? below[i * 2 + 1] : 0);
+                pyramid.maxCounts[level] = max(pyramid.maxCounts[level], counts[i]);
+            }
+        }
+    }
+
+    // Returns null unless the pyramid of the track is built and stays valid, it then has to follow the keys moved
+    static KeyPyramid* FindKeyPyramid(SequenceInterface* sequence, int trackIndex)
+    {
+        if (gContext.pyramidSequence != sequence || gContext.pyramidVersion == 0 || gContext.pyramidVersion != sequence->GetVersion() || trackIndex >= (int)gContext.pyramids.size())
+            return nullptr;
+        KeyPyramid& pyramid = gContext.pyramids[trackIndex];
+        return pyramid.levelStarts.empty() ? nullptr : &pyramid;
+    }
+
+    // Without a version the pyramid of a track is built again every frame it is drawn
+    static KeyPyramid& GetKeyPyramid(SequenceInterface* sequence, int trackIndex, TRACK_NATURE nature, int frameCount)
+    {
+        unsigned version = sequence->GetVersion();
+        int trackCount = sequence->GetTrackCount();
+        if (gContext.pyramidSequence != sequence || gContext.pyramidVersion != version || (int)gContext.pyramids.size() != trackCount)
+        {
+            gContext.pyramidSequence = sequence;
+            gContext.pyramidVersion = version;
+            gContext.pyramids.clear();
+            gContext.pyramids.resize(trackCount);
+        }
+
+        KeyPyramid& pyramid = gContext.pyramids[trackIndex];
+        if (version == 0 || pyramid.levelStarts.empty() || pyramid.frameCount != frameCount || pyramid.nature != nature)
+            BuildKeyPyramid(pyramid, sequence, trackIndex, nature, frameCount);
+        return pyramid;
+    }
+
+    // Density bar of a track from the finest level with buckets at least a pixel wide, a rectangle per run of buckets
+    // of the same shade so there are never more than pixels across
+    static void DrawKeyDensity(ImDrawList* draw_list, const KeyPyramid& pyramid, int firstFrame, float framePixelWidth, ImVec2 pos, float right, int height)
+    {
+        size_t level = 0;
+        while (cLodBucketFrames * (1 << level) * framePixelWidth < 1.0f && level + 2 < pyramid.levelStarts.size())
+            ++level;
+
+        const int* counts = &pyramid.counts[pyramid.levelStarts[level]];
+        const int bucketCount = pyramid.levelStarts[level + 1] - pyramid.levelStarts[level];
+        const int bucketFrames = cLodBucketFrames << level;
+        const int maxCount = max(pyramid.maxCounts[level], 1);
+        auto shade = [&](int bucket) { return counts[bucket] > 0 ? 1 + (counts[bucket] * 7) / maxCount : 0; };
+        auto left = [&](int bucket) { return pos.x + (bucket * bucketFrames - firstFrame) * framePixelWidth; };
+
+        for (int bucket = max(firstFrame / bucketFrames, 0); bucket < bucketCount && left(bucket) < right;)
+        {
+            int bucketShade = shade(bucket);
+            int runEnd = bucket + 1;
+            while (runEnd < bucketCount && left(runEnd) < right && shade(runEnd) == bucketShade)
+                ++runEnd;
+            if (bucketShade)
+            {
+                unsigned int alpha = 0x30 + bucketShade * 0x19;
+                draw_list->AddRectFilled(ImVec2(left(bucket), pos.y + 2), ImVec2(left(runEnd), pos.y + height - 2), (pyramid.color & 0x00FFFFFF) | (alpha << 24));
+            }
+            bucket = runEnd;
+        }
+    }
+
 	bool Sequencer(SequenceInterface *sequence, int *currentFrame, bool *expanded, int *selectedEntry, int* selectedKey, int *firstFrame, int sequenceOptions)
 	{
 		bool ret = false;
 		ImGuiIO& io = ImGui::GetIO();
 		int cx = (int)(io.MousePos.x);
 		int cy = (int)(io.MousePos.y);
-		int framePixelWidth = ImGui::GetFont()->FontSize * 0.8f;
+		int defaultFramePixelWidth = ImGui::GetFont()->FontSize * 0.8f;
 		int legendWidth = 300;
 
         const float scrollX = ImGui::GetScrollX();
@@ -92,16 +313,40 @@ namespace ImSequencer
 			draw_list->AddRectFilled(canvas_pos, ImVec2(canvas_size.x + canvas_pos.x, canvas_pos.y + ItemHeight), 0xFF3D3837, 0);
 			char tmps[512];
             int keyCt = 0;
-            for (int i = 0; i < sequenceCount; ++i)
-                keyCt += sequence->GetKeyFrameCount(i);
+            if (UpdateKeyCounts(sequence))
+                keyCt = gContext.keyCountTotal;
+            else
+            {
+                for (int i = 0; i < sequenceCount; ++i)
+                    keyCt += sequence->GetKeyFrameCount(i);
+            }
 			sprintf_s(tmps, sizeof(tmps), "%d Frames / %d tracks / %d keyframes", frameCount, sequenceCount, keyCt);
 			draw_list->AddText(ImVec2(canvas_pos.x + 26, canvas_pos.y), 0xFFFFFFFF, tmps);
 		}
 		else
 		{
+            // Ctrl + wheel zooms out around the frame under the mouse, down to the whole sequence in view
+            const float trackAreaWidth = canvas_size.x - legendWidth;
+            const float minZoom = frameCount > 0 ? ImClamp(trackAreaWidth / (frameCount * (float)defaultFramePixelWidth), 0.0f, 1.0f) : 1.0f;
+            float zoom = ImClamp(gContext.zoom, minZoom, 1.0f);
+            ImRect trackArea(ImVec2(canvas_pos.x + legendWidth, canvas_pos.y), ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y));
+            if (io.KeyCtrl && io.MouseWheel != 0.0f && gContext.movingTrack == -1 && trackArea.Contains(io.MousePos) && ImGui::IsWindowHovered())
+            {
+                float mouseX = io.MousePos.x - trackArea.Min.x;
+                float mouseFrame = firstFrameUsed + mouseX / (zoom * defaultFramePixelWidth);
+                zoom = ImClamp(zoom * powf(1.25f, io.MouseWheel), minZoom, 1.0f);
+                if (firstFrame)
+                {
+                    int newFirstFrame = (int)(mouseFrame - mouseX / (zoom * defaultFramePixelWidth));
+                    *firstFrame = firstFrameUsed = max(min(newFirstFrame, frameCount - (int)(trackAreaWidth / (zoom * defaultFramePixelWidth))), 0);
+                }
+            }
+            gContext.zoom = zoom;
+            const float framePixelWidth = zoom * defaultFramePixelWidth;
+
 			bool hasHorizScrollBar = false;
             bool hasVerticalScrollBar = false;
-			int framesPixelWidth = frameCount * framePixelWidth;
+			int framesPixelWidth = (int)(frameCount * framePixelWidth);
 			if ((framesPixelWidth + legendWidth) >= canvas_size.x)
 			{
                 hasHorizScrollBar = true;
@@ -169,6 +414,7 @@ namespace ImSequencer
 						if (ImGui::Selectable(sequence->GetTrackTypeName(i)))
 						{
 							sequence->Add(i);
+                            gContext.pyramids.clear();
 							*selectedEntry = sequence->GetTrackCount() - 1;
                             *selectedKey = -1;
 						}
@@ -202,7 +448,7 @@ namespace ImSequencer
             ImRect outerClip(ImVec2(canvas_pos.x + legendWidth, canvas_pos.y + scrollY), ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + controlHeight + scrollY));
 			draw_list->PushClipRect(outerClip.Min, outerClip.Max, true);
             ImRect innerClip = outerClip;
-            innerClip.Max.x -= hasVerticalScrollBar ? (float)framePixelWidth : 0;
+            innerClip.Max.x -= hasVerticalScrollBar ? (float)defaultFramePixelWidth : 0;
             innerClip.Max.y -= hasHorizScrollBar ? (float)scrollBarHeight : 0;
 			
 			// slots background
@@ -222,12 +468,16 @@ namespace ImSequencer
 				draw_list->AddRectFilled(pos, sz, col, 0);
 			}
 
-            // Timeline ticks and counts
+            // Timeline ticks and counts, for the frames in view. Zoomed out they are 10, 100... frames apart to stay a few
+            // pixels apart.
             draw_list->AddRectFilled(canvas_pos, ImVec2(canvas_size.x + canvas_pos.x, canvas_pos.y + ItemHeight), 0xFF3D3837, 0);
-			for (int i = 0; i <= frameCount; i++)
+            int tickStep = 1;
+            while (tickStep * framePixelWidth < 4.0f)
+                tickStep *= 10;
+			for (int i = max(firstFrameUsed, 0) / tickStep * tickStep; i <= frameCount && i <= firstFrameUsed + visibleFrameCount + 1; i += tickStep)
 			{
-				bool baseIndex = ((i % 10) == 0) || (i == frameCount);
-				bool halfIndex = (i % 5) == 0;
+				bool baseIndex = ((i % (tickStep * 10)) == 0) || (i == frameCount);
+				bool halfIndex = (i % (tickStep * 5)) == 0;
 				int px = (int)canvas_pos.x + i * framePixelWidth + legendWidth - firstFrameUsed * framePixelWidth;
 				int tiretStart = baseIndex ? 4 : (halfIndex ? 10 : 14);
 				int tiretEnd = baseIndex ? effectiveHeight : ItemHeight;
@@ -257,7 +507,23 @@ namespace ImSequencer
 			for (int trackIndex = gContext.verticalOffset; trackIndex < sequenceCount && trackIndex < gContext.verticalOffset + visibleTrackCount; ++trackIndex)
 			{
                 TRACK_NATURE nature = sequence->GetTrackNature(trackIndex);
-                unsigned keyCt = sequence->GetKeyFrameCount(trackIndex);
+
+                // zoomed out past a pixel per frame, keys are too many to draw or pick and the track shows their density
+                if (framePixelWidth < 1.0f)
+                {
+                    const KeyPyramid& pyramid = GetKeyPyramid(sequence, trackIndex, nature, frameCount);
+                    DrawKeyDensity(draw_list, pyramid, firstFrameUsed, framePixelWidth, ImVec2(canvas_pos.x + legendWidth, curY + 1), innerClip.Max.x, ItemHeight);
+                    curY += ItemHeight;
+                    continue;
+                }
+
+                unsigned keyCt = GetKeyCount(sequence, trackIndex);
+
+                // keys in order are walked from the first one in view up to the first one past it, a frame of margin
+                // on the left keeps the edge of a key ending there
+                const bool sorted = sequence->AreKeyFramesSorted(trackIndex);
+                const int firstKey = sorted ? FindFirstKeyFrom(sequence, trackIndex, keyCt, nature, firstFrameUsed - 1) : 0;
+                const int lastFrame = sorted ? firstFrameUsed + visibleFrameCount + 1 : std::numeric_limits<int>::max();
 
                 static auto Lerp = [](const ImVec4& lhs, const ImVec4& rhs, float td) {
                     return ImColor(ImVec4(
@@ -269,11 +535,13 @@ namespace ImSequencer
 
 #define GLOW_ANIM(A, B) Lerp(ImColor(A), ImColor(B), GetTimeCurve())
 
-                for (int keyIndex = 0; keyIndex < keyCt; ++keyIndex)
+                for (int keyIndex = firstKey; keyIndex < keyCt; ++keyIndex)
                 {
                     int *start, *end;
                     unsigned int color;
                     sequence->Get(trackIndex, keyIndex, &start, &end, NULL, &color);
+                    if (*start > lastFrame)
+                        break;
 
                     ImVec2 pos = ImVec2(canvas_pos.x + legendWidth - firstFrameUsed * framePixelWidth, curY + 1);
                     ImVec2 slotP1(pos.x + *start * framePixelWidth, pos.y + 2);
@@ -370,22 +638,33 @@ namespace ImSequencer
                 TRACK_NATURE nature = sequence->GetTrackNature(gContext.movingTrack);
 				ImGui::CaptureMouseFromApp();
 
-                // need to grab key starts for reordering keys
-                unsigned keyCt = sequence->GetKeyFrameCount(gContext.movingTrack);
-                std::vector<int> keyStarts;
-                for (int keyIndex = 0; keyIndex < keyCt; ++keyIndex)
+                // need to grab the starts of the neighbouring keys for reordering keys
+                unsigned keyCt = GetKeyCount(sequence, gContext.movingTrack);
+                int previousStart = 0, nextStart = 0;
+                if (gContext.movingKey > 0)
+                {
+                    int *start;
+                    sequence->Get(gContext.movingTrack, gContext.movingKey - 1, &start, 0x0, 0x0, 0x0);
+                    previousStart = *start;
+                }
+                if (gContext.movingKey < keyCt - 1)
                 {
                     int *start;
-                    sequence->Get(gContext.movingTrack, keyIndex, &start, 0x0, 0x0, 0x0);
-                    keyStarts.push_back(*start);
+                    sequence->Get(gContext.movingTrack, gContext.movingKey + 1, &start, 0x0, 0x0, 0x0);
+                    nextStart = *start;
                 }
 
-				int diffFrame = (cx - gContext.movingPos) / framePixelWidth;
+				int diffFrame = (int)((cx - gContext.movingPos) / framePixelWidth);
 				if (abs(diffFrame) > 0)
 				{
 					int *start, *end;
 					sequence->Get(gContext.movingTrack, gContext.movingKey, &start, &end, NULL, NULL);
 
+                    // a pyramid built for the zoomed out view follows the key rather than being built again
+                    KeyPyramid* pyramid = FindKeyPyramid(sequence, gContext.movingTrack);
+                    if (pyramid)
+                        UpdateKeyPyramid(*pyramid, *start, *end, -1);
+
 					int & l = *start;
 					int & r = *end;
                     if (nature == TRACK_NATURE_TICK)
@@ -413,19 +692,18 @@ namespace ImSequencer
                         if (gContext.movingPart & 2 && r < l)
                             r = l;
                     }
+                    if (pyramid)
+                        UpdateKeyPyramid(*pyramid, l, r, 1);
 
                     // swap key orders
-                    if (gContext.movingKey > 0)
+                    if (gContext.movingKey > 0 && previousStart > l)
                     {
-                        if (keyStarts[gContext.movingKey - 1] > l)
-                        {
-                            if (sequence->SwapKeyframes(gContext.movingTrack, gContext.movingKey, gContext.movingKey - 1))
-                                gContext.movingKey = gContext.movingKey - 1;
-                        }
+                        if (sequence->SwapKeyframes(gContext.movingTrack, gContext.movingKey, gContext.movingKey - 1))
+                            gContext.movingKey = gContext.movingKey - 1;
                     }
-                    if (gContext.movingKey < keyCt - 1)
+                    else if (gContext.movingKey < keyCt - 1)
                     {
-                        if (keyStarts[gContext.movingKey + 1] < l)
+                        if (nextStart < l)
                         {
                             if (sequence->SwapKeyframes(gContext.movingTrack, gContext.movingKey, gContext.movingKey + 1))
                                 gContext.movingKey = gContext.movingKey + 1;
@@ -435,7 +713,7 @@ namespace ImSequencer
                         *firstFrame -= 1;
                     while (l > *firstFrame + visibleFrameCount || r > *firstFrame + visibleFrameCount)
                         *firstFrame += 1;
-                    gContext.movingPos += diffFrame * framePixelWidth;
+                    gContext.movingPos += (int)(diffFrame * framePixelWidth);
 				}
 				if (!io.MouseDown[0])
 				{
@@ -488,7 +766,7 @@ namespace ImSequencer
 			
             if (hasHorizScrollBar)
             {
-                const float vertTake = hasVerticalScrollBar ? framePixelWidth*2 : framePixelWidth;
+                const float vertTake = hasVerticalScrollBar ? defaultFramePixelWidth*2 : defaultFramePixelWidth;
                 int scrollBarStartHeight = canvas_size.y - scrollBarHeight;
                 // ratio = number of frames visible in control / number to total frames
                 int visibleFrameCount = (int)floorf((canvas_size.x - legendWidth) / framePixelWidth);
@@ -553,7 +831,7 @@ namespace ImSequencer
             {
                 float scrollBarStartHeight = canvas_pos.y + ItemHeight;
                 float scrollBarRight = canvas_pos.x + canvas_size.x;
-                float scrollBarLeft = scrollBarRight - framePixelWidth;
+                float scrollBarLeft = scrollBarRight - defaultFramePixelWidth;
                 float scrollBarBottom = canvas_pos.y + canvas_size.y - (hasHorizScrollBar ? scrollBarHeight : 0);
 
                 ImRect scrollRect({ scrollBarLeft, scrollBarStartHeight }, { scrollBarRight, scrollBarBottom });
@@ -577,7 +855,7 @@ namespace ImSequencer
                         ImGui::CaptureMouseFromApp();
                         auto delta = ImGui::GetMouseDragDelta(0);
                         float ff = gContext.verticalOffset;
-                        ff += delta.y / framePixelWidth;
+                        ff += delta.y / defaultFramePixelWidth;
                         int newOffset = roundf(ff);
                         if (newOffset != gContext.verticalOffset)
                         {
@@ -617,6 +895,7 @@ namespace ImSequencer
 		if (delEntry != -1)
 		{
 			sequence->Del(delEntry);
+            gContext.pyramids.clear();
             if (selectedEntry && (*selectedEntry == delEntry || *selectedEntry >= sequence->GetTrackCount()))
             {
                 *selectedEntry = -1;
@@ -627,6 +906,7 @@ namespace ImSequencer
 		if (dupEntry != -1)
 		{
 			sequence->Duplicate(dupEntry);
+            gContext.pyramids.clear();
 		}
 		return ret;
 	}
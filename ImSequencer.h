@@ -38,6 +38,14 @@ namespace ImSequencer
 		virtual void Duplicate(int /*index*/) {}
         virtual bool SwapKeyframes(int trackIndex, int keyIndex, int withIndex) { return false; }
 
+        // Optional, for long tracks. When the keys of a track are in order of both start and end frame (as dragging
+        // keeps them with SwapKeyframes), only the keys in view are looked at: the first one is found by binary search.
+        virtual bool AreKeyFramesSorted(int /*trackIndex*/) const { return false; }
+        // Optional: changes whenever tracks or keys are added, removed or moved outside the sequencer. Key counts, and
+        // the key densities drawn when zoomed out (ctrl + wheel), are cached for as long as it stays the same; 0 asks
+        // for them every frame.
+        virtual unsigned GetVersion() const { return 0; }
+
 		virtual void Copy() {}
 		virtual void Paste() {}
 	};
@@ -0,0 +1,724 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include "TextDiff.h"
+#include "imgui_internal.h"
+
+#undef max
+#undef min
+
+// Columns left of the text: the line number and the change marker
+static const int cTextStart = 8;
+static const int cMarkerColumn = 7;
+static const float cOverviewWidth = 12.0f;
+static const int cScrollContextRows = 3;	// rows shown above a hunk scrolled to
+
+// Below this many edits a split of the diff is exact, past it the furthest reaching path is taken (see Split)
+static const int cMinMaxCost = 256;
+// Longer lines are not compared character by character, the whole line is marked
+static const int cMaxRefineLength = 4096;
+
+static const ImU32 cChangedColors[2] = { 0x403030e0, 0x4030c030 };	// lines only on the left / only on the right
+static const ImU32 cPairedColor = 0x28e09040;
+static const ImU32 cSpanColors[2] = { 0x703030e0, 0x7030c030 };
+static const ImU32 cFillerColor = 0x18808080;
+static const ImU32 cMarkerColors[2] = { 0xff4040e0, 0xff40c040 };
+static const ImU32 cOverviewColors[4] = { 0, 0xc03030e0, 0xc030c030, 0xc0e09040 };	// by overview kind
+static const ImU32 cOverviewViewColor = 0x40ffffff;
+
+// Linear space Myers diff: marks the elements of two sequences that are not in a shortest edit script between them,
+// by splitting at the middle snake and recursing on both halves. A split that would take more than mMaxCost edits
+// takes the furthest reaching path found so far instead, as xdiff does, so very different inputs cost O(N * mMaxCost)
+// per split at the price of a diff that is longer than it has to be.
+template <typename T>
+class MyersDiff
+{
+public:
+	MyersDiff(const T* aA, int aCountA, const T* aB, int aCountB, char* aChangedA, char* aChangedB, const std::function<bool()>& aCancelled)
+		: mA(aA)
+		, mB(aB)
+		, mCountA(aCountA)
+		, mCountB(aCountB)
+		, mChangedA(aChangedA)
+		, mChangedB(aChangedB)
+		, mCancelled(aCancelled)
+	{
+		// Diagonal k = a - b runs from -mCountB to mCountA, plus a sentinel on both ends
+		mForward.resize(aCountA + aCountB + 3);
+		mBackward.resize(aCountA + aCountB + 3);
+		mOffset = aCountB + 1;
+		mMaxCost = std::max(cMinMaxCost, (int)std::sqrt((double)(aCountA + aCountB + 3)));
+	}
+
+	void Run() { Compare(0, mCountA, 0, mCountB); }
+
+private:
+	void Compare(int aLowA, int aHighA, int aLowB, int aHighB)
+	{
+		while (aLowA < aHighA && aLowB < aHighB && mA[aLowA] == mB[aLowB])
+			++aLowA, ++aLowB;
+		while (aLowA < aHighA && aLowB < aHighB && mA[aHighA - 1] == mB[aHighB - 1])
+			--aHighA, --aHighB;
+
+		int splitA = aLowA, splitB = aLowB;
+		if (aLowA < aHighA && aLowB < aHighB && !mCancelled())
+			Split(aLowA, aHighA, aLowB, aHighB, splitA, splitB);
+
+		// Without a split that makes both halves smaller everything left is changed
+		if ((splitA == aLowA && splitB == aLowB) || (splitA == aHighA && splitB == aHighB))
+		{
+			std::fill(mChangedA + aLowA, mChangedA + aHighA, 1);
+			std::fill(mChangedB + aLowB, mChangedB + aHighB, 1);
+			return;
+		}
+		Compare(aLowA, splitA, aLowB, splitB);
+		Compare(splitA, aHighA, splitB, aHighB);
+	}
+
+	// Runs the forward and backward searches until their paths overlap and returns a point where they do
+	void Split(int aLowA, int aHighA, int aLowB, int aHighB, int& aOutA, int& aOutB)
+	{
+		auto forward = mForward.data() + mOffset;
+		auto backward = mBackward.data() + mOffset;
+		int minDiagonal = aLowA - aHighB, maxDiagonal = aHighA - aLowB;
+		int forwardMid = aLowA - aLowB, backwardMid = aHighA - aHighB;
+		bool odd = ((forwardMid - backwardMid) & 1) != 0;
+		int forwardMin = forwardMid, forwardMax = forwardMid;
+		int backwardMin = backwardMid, backwardMax = backwardMid;
+		forward[forwardMid] = aLowA;
+		backward[backwardMid] = aHighA;
+
+		for (int cost = 1;; ++cost)
+		{
+			if (forwardMin > minDiagonal)
+				forward[--forwardMin - 1] = -1;
+			else
+				++forwardMin;
+			if (forwardMax < maxDiagonal)
+				forward[++forwardMax + 1] = -1;
+			else
+				--forwardMax;
+			for (int d = forwardMax; d >= forwardMin; d -= 2)
+			{
+				int a = forward[d - 1] >= forward[d + 1] ? forward[d - 1] + 1 : forward[d + 1];
+				int b = a - d;
+				while (a < aHighA && b < aHighB && mA[a] == mB[b])
+					++a, ++b;
+				forward[d] = a;
+				if (odd && backwardMin <= d && d <= backwardMax && backward[d] <= a)
+				{
+					aOutA = a;
+					aOutB = b;
+					return;
+				}
+			}
+
+			if (backwardMin > minDiagonal)
+				backward[--backwardMin - 1] = std::numeric_limits<int>::max();
+			else
+				++backwardMin;
+			if (backwardMax < maxDiagonal)
+				backward[++backwardMax + 1] = std::numeric_limits<int>::max();
+			else
+				--backwardMax;
+			for (int d = backwardMax; d >= backwardMin; d -= 2)
+			{
+				int a = backward[d - 1] < backward[d + 1] ? backward[d - 1] : backward[d + 1] - 1;
+				int b = a - d;
+				while (a > aLowA && b > aLowB && mA[a - 1] == mB[b - 1])
+					--a, --b;
+				backward[d] = a;
+				if (!odd && forwardMin <= d && d <= forwardMax && a <= forward[d])
+				{
+					aOutA = a;
+					aOutB = b;
+					return;
+				}
+			}
+
+			if (cost < mMaxCost)
+				continue;
+
+			// Too expensive: split where the forward or the backward search got furthest
+			int forwardBest = -1, forwardBestA = -1;
+			for (int d = forwardMax; d >= forwardMin; d -= 2)
+			{
+				int a = std::min(forward[d], aHighA);
+				int b = a - d;
+				if (b > aHighB)
+					a = aHighB + d, b = aHighB;
+				if (a + b > forwardBest)
+					forwardBest = a + b, forwardBestA = a;
+			}
+			int backwardBest = std::numeric_limits<int>::max(), backwardBestA = -1;
+			for (int d = backwardMax; d >= backwardMin; d -= 2)
+			{
+				int a = std::max(aLowA, backward[d]);
+				int b = a - d;
+				if (b < aLowB)
+					a = aLowB + d, b = aLowB;
+				if (a + b < backwardBest)
+					backwardBest = a + b, backwardBestA = a;
+			}
+			if ((aHighA + aHighB) - backwardBest < forwardBest - (aLowA + aLowB))
+			{
+				aOutA = forwardBestA;
+				aOutB = forwardBest - forwardBestA;
+			}
+			else
+			{
+				aOutA = backwardBestA;
+				aOutB = backwardBest - backwardBestA;
+			}
+			return;
+		}
+	}
+
+	const T* mA;
+	const T* mB;
+	int mCountA;
+	int mCountB;
+	char* mChangedA;
+	char* mChangedB;
+	const std::function<bool()>& mCancelled;
+	std::vector<int> mForward;	// furthest a reached per diagonal
+	std::vector<int> mBackward;	// lowest a reached per diagonal
+	int mOffset;
+	int mMaxCost;
+};
+
+// Diffs snapshots of the two texts. A newer job makes the one running stop early, only the result of the newest
+// finished job is kept for the UI thread.
+class TextDiff::DiffWorker
+{
+public:
+	struct Job
+	{
+		uint32_t mVersion;
+		std::string mTexts[2];
+	};
+
+	DiffWorker()
+		: mQuit(false)
+		, mVersion(0)
+		, mResultVersion(0)
+	{
+		mThread = std::thread([this]() { Run(); });
+	}
+
+	~DiffWorker()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQuit = true;
+		}
+		mWakeUp.notify_one();
+		mThread.join();
+	}
+
+	void Submit(std::unique_ptr<Job> aJob)
+	{
+		mVersion = aJob->mVersion;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mPending = std::move(aJob);
+		}
+		mWakeUp.notify_one();
+	}
+
+	// The newest finished changes, null if there are none since the last call
+	std::unique_ptr<Changes> Take(uint32_t& aVersion)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		aVersion = mResultVersion;
+		return std::move(mResult);
+	}
+
+private:
+	struct LineText
+	{
+		const char* mText;
+		size_t mSize;
+
+		bool operator==(const LineText& aOther) const { return mSize == aOther.mSize && memcmp(mText, aOther.mText, mSize) == 0; }
+	};
+
+	struct LineTextHash
+	{
+		size_t operator()(const LineText& aLine) const
+		{
+			// FNV-1a
+			uint32_t hash = 2166136261u;
+			for (size_t i = 0; i < aLine.mSize; ++i)
+				hash = (hash ^ (unsigned char)aLine.mText[i]) * 16777619u;
+			return hash;
+		}
+	};
+
+	void Run()
+	{
+		for (;;)
+		{
+			std::unique_ptr<Job> job;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mWakeUp.wait(lock, [this]() { return mQuit || mPending != nullptr; });
+				if (mQuit)
+					return;
+				job = std::move(mPending);
+			}
+
+			std::function<bool()> cancelled = [&]() { return mQuit || mVersion != job->mVersion; };
+			std::unique_ptr<Changes> changes(new Changes());
+			Diff(*job, *changes, cancelled);
+			if (cancelled())
+				continue;
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			mResult = std::move(changes);
+			mResultVersion = job->mVersion;
+		}
+	}
+
+	// Splits the way TextEditor::SetText does: an empty text has no lines, otherwise there is one more than newlines
+	static void SplitLines(const std::string& aText, std::vector<LineText>& aLines)
+	{
+		if (aText.empty())
+			return;
+		auto first = aText.data(), last = first + aText.size();
+		for (;;)
+		{
+			auto newline = (const char*)memchr(first, '\n', last - first);
+			auto end = newline != nullptr ? newline : last;
+			aLines.push_back(LineText{ first, (size_t)(end - first) });
+			if (newline == nullptr)
+				return;
+			first = newline + 1;
+		}
+	}
+
+	static void Diff(const Job& aJob, Changes& aChanges, const std::function<bool()>& aCancelled)
+	{
+		// Lines are compared by id, equal lines get the same one
+		std::vector<LineText> lines[2];
+		std::vector<int> ids[2];
+		std::unordered_map<LineText, int, LineTextHash> lineIds;
+		for (int side = 0; side < 2; ++side)
+		{
+			SplitLines(aJob.mTexts[side], lines[side]);
+			ids[side].reserve(lines[side].size());
+			for (auto& line : lines[side])
+				ids[side].push_back(lineIds.emplace(line, (int)lineIds.size()).first->second);
+		}
+
+		int counts[2] = { (int)ids[0].size(), (int)ids[1].size() };
+		std::vector<char> changed[2] = { std::vector<char>(counts[0]), std::vector<char>(counts[1]) };
+		MyersDiff<int>(ids[0].data(), counts[0], ids[1].data(), counts[1], changed[0].data(), changed[1].data(), aCancelled).Run();
+
+		// Runs of changed lines become hunks, the lines between them are equal in order
+		int row = 0;
+		for (int a = 0, b = 0; a < counts[0] || b < counts[1];)
+		{
+			if (a < counts[0] && b < counts[1] && !changed[0][a] && !changed[1][b])
+			{
+				++a, ++b, ++row;
+				continue;
+			}
+			Hunk hunk;
+			hunk.mLeftLine = a;
+			hunk.mRightLine = b;
+			while (a < counts[0] && changed[0][a])
+				++a;
+			while (b < counts[1] && changed[1][b])
+				++b;
+			hunk.mLeftCount = a - hunk.mLeftLine;
+			hunk.mRightCount = b - hunk.mRightLine;
+			hunk.mRow = row;
+			hunk.mFirstPair = aChanges.mHunks.empty() ? 0 : aChanges.mHunks.back().mFirstPair +
+				std::min(aChanges.mHunks.back().mLeftCount, aChanges.mHunks.back().mRightCount);
+			row += std::max(hunk.mLeftCount, hunk.mRightCount);
+			aChanges.mHunks.push_back(hunk);
+		}
+
+		// Paired lines are refined to the characters that changed
+		std::vector<char> changedChars[2];
+		for (auto& hunk : aChanges.mHunks)
+		{
+			if (aCancelled())
+				return;
+			int pairs = std::min(hunk.mLeftCount, hunk.mRightCount);
+			for (int i = 0; i < pairs; ++i)
+			{
+				const LineText* pair[2] = { &lines[0][hunk.mLeftLine + i], &lines[1][hunk.mRightLine + i] };
+				for (int side = 0; side < 2; ++side)
+					changedChars[side].assign(pair[side]->mSize, 0);
+				if (pair[0]->mSize > (size_t)cMaxRefineLength || pair[1]->mSize > (size_t)cMaxRefineLength)
+				{
+					for (int side = 0; side < 2; ++side)
+						changedChars[side].assign(pair[side]->mSize, 1);
+				}
+				else
+				{
+					MyersDiff<char>(pair[0]->mText, (int)pair[0]->mSize, pair[1]->mText, (int)pair[1]->mSize,
+						changedChars[0].data(), changedChars[1].data(), aCancelled).Run();
+				}
+
+				for (int side = 0; side < 2; ++side)
+				{
+					aChanges.mSpanStarts[side].push_back((int)aChanges.mSpans[side].size());
+					AddSpans(pair[side]->mText, changedChars[side], aChanges.mSpans[side]);
+				}
+			}
+		}
+		for (int side = 0; side < 2; ++side)
+			aChanges.mSpanStarts[side].push_back((int)aChanges.mSpans[side].size());
+	}
+
+	// Runs of changed characters, widened to whole UTF-8 sequences
+	static void AddSpans(const char* aText, const std::vector<char>& aChanged, std::vector<Span>& aSpans)
+	{
+		auto first = aSpans.size();
+		auto continuation = [&](int aIndex) { return ((unsigned char)aText[aIndex] & 0xC0) == 0x80; };
+		int size = (int)aChanged.size();
+		for (int i = 0; i < size;)
+		{
+			if (!aChanged[i])
+			{
+				++i;
+				continue;
+			}
+			int start = i;
+			while (i < size && aChanged[i])
+				++i;
+			while (start > 0 && continuation(start))
+				--start;
+			while (i < size && continuation(i))
+				++i;
+			if (aSpans.size() > first && aSpans.back().mEnd >= start)
+				aSpans.back().mEnd = i;
+			else
+				aSpans.push_back(Span{ start, i });
+		}
+	}
+
+	std::thread mThread;
+	std::mutex mMutex;
+	std::condition_variable mWakeUp;
+	std::unique_ptr<Job> mPending;
+	std::atomic<bool> mQuit;
+	std::atomic<uint32_t> mVersion;	// version of the newest job, older ones stop early
+	std::unique_ptr<Changes> mResult;
+	uint32_t mResultVersion;
+};
+
+TextDiff::TextDiff()
+	: mVersion(0)
+	, mResultVersion(0)
+	, mLongest(0)
+	, mScrollToRow(-1)
+	, mOverviewVersion(0)
+{
+	mLeft.SetReadOnly(true);
+	mRight.SetReadOnly(true);
+}
+
+TextDiff::~TextDiff()
+{
+}
+
+void TextDiff::SetTexts(const std::string& aLeft, const std::string& aRight)
+{
+	mLeft.SetText(aLeft);
+	mRight.SetText(aRight);
+	mChanges = Changes();
+	mLongest = 0;
+	mOverview.clear();
+
+	if (!mWorker)
+		mWorker.reset(new DiffWorker());
+	std::unique_ptr<DiffWorker::Job> job(new DiffWorker::Job());
+	job->mVersion = ++mVersion;
+	job->mTexts[0] = aLeft;
+	job->mTexts[1] = aRight;
+	mWorker->Submit(std::move(job));
+}
+
+void TextDiff::SetLanguageDefinition(const TextEditor::LanguageDefinition& aLanguageDef)
+{
+	mLeft.SetLanguageDefinition(aLanguageDef);
+	mRight.SetLanguageDefinition(aLanguageDef);
+}
+
+void TextDiff::SetPalette(const TextEditor::Palette& aValue)
+{
+	mLeft.SetPalette(aValue);
+	mRight.SetPalette(aValue);
+}
+
+void TextDiff::ScrollToHunk(int aIndex)
+{
+	if (aIndex >= 0 && aIndex < (int)mChanges.mHunks.size())
+		mScrollToRow = mChanges.mHunks[aIndex].mRow;
+}
+
+void TextDiff::TakeChanges()
+{
+	if (!mWorker || !IsDiffPending())
+		return;
+
+	uint32_t version;
+	auto changes = mWorker->Take(version);
+	if (changes != nullptr && version == mVersion)
+	{
+		mChanges = std::move(*changes);
+		mResultVersion = version;
+	}
+}
+
+int TextDiff::GetRowCount() const
+{
+	int lines[2] = { mLeft.GetTotalLines(), mRight.GetTotalLines() };
+	if (mChanges.mHunks.empty())
+		return std::max(lines[0], lines[1]);
+
+	// The lines after the last hunk are equal
+	auto& last = mChanges.mHunks.back();
+	return last.mRow + std::max(last.mLeftCount, last.mRightCount) + lines[0] - (last.mLeftLine + last.mLeftCount);
+}
+
+TextDiff::Row TextDiff::GetRow(int aRow) const
+{
+	Row row = { { aRow, aRow }, -1, -1 };
+
+	// Rows map one to one onto equal lines, offset by the rows of the hunks above
+	auto& hunks = mChanges.mHunks;
+	auto next = std::upper_bound(hunks.begin(), hunks.end(), aRow, [](int aValue, const Hunk& aHunk) { return aValue < aHunk.mRow; });
+	if (next != hunks.begin())
+	{
+		auto& hunk = *(next - 1);
+		int firsts[2] = { hunk.mLeftLine, hunk.mRightLine };
+		int counts[2] = { hunk.mLeftCount, hunk.mRightCount };
+		int offset = aRow - hunk.mRow;
+		int rows = std::max(counts[0], counts[1]);
+		if (offset < rows)
+		{
+			row.mHunk = (int)(next - 1 - hunks.begin());
+			if (offset < std::min(counts[0], counts[1]))
+				row.mPair = hunk.mFirstPair + offset;
+			for (int side = 0; side < 2; ++side)
+				row.mLines[side] = offset < counts[side] ? firsts[side] + offset : -1;
+		}
+		else
+		{
+			for (int side = 0; side < 2; ++side)
+				row.mLines[side] = firsts[side] + counts[side] + offset - rows;
+		}
+	}
+
+	int lines[2] = { mLeft.GetTotalLines(), mRight.GetTotalLines() };
+	for (int side = 0; side < 2; ++side)
+		if (row.mLines[side] >= lines[side])
+			row.mLines[side] = -1;
+	return row;
+}
+
+void TextDiff::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
+{
+	TakeChanges();
+	mLeft.UpdateColors();
+	mRight.UpdateColors();
+
+	auto font = ImGui::GetFont();
+	auto fontSize = ImGui::GetFontSize();
+	mCharAdvance = ImVec2(font->IndexAdvanceX['X'] * fontSize / font->FontSize, fontSize);
+
+	auto& palette = mLeft.GetPalette();
+	ImGui::PushStyleColor(ImGuiCol_ChildWindowBg, ImGui::ColorConvertU32ToFloat4(palette[(int)TextEditor::PaletteIndex::Background]));
+	ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0.0f, 0.0f));
+	ImGui::BeginChild(aTitle, aSize, aBorder, ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_NoMove);
+
+	if (mScrollToRow >= 0)
+	{
+		ImGui::SetScrollY(std::max(0, mScrollToRow - cScrollContextRows) * mCharAdvance.y);
+		mScrollToRow = -1;
+	}
+
+	// One window scrolls both sides, they are laid out by hand left and right of the overview strip
+	auto scrollX = ImGui::GetScrollX();
+	auto scrollY = ImGui::GetScrollY();
+	auto visibleWidth = ImGui::GetWindowContentRegionMax().x - ImGui::GetWindowContentRegionMin().x;
+	auto visibleHeight = ImGui::GetWindowContentRegionMax().y - ImGui::GetWindowContentRegionMin().y;
+	auto origin = ImGui::GetCursorScreenPos();
+	auto left = origin.x + scrollX;
+	auto top = origin.y + scrollY;
+	auto paneWidth = std::max(0.0f, (visibleWidth - cOverviewWidth) * 0.5f);
+
+	// Only the rows in view are looked up and drawn
+	int rowCount = GetRowCount();
+	int firstRow = std::max(0, (int)floor(scrollY / mCharAdvance.y));
+	int lastRow = std::min(rowCount, firstRow + (int)ceil(visibleHeight / mCharAdvance.y) + 1);
+	std::vector<Row> rows;
+	for (int row = firstRow; row < lastRow; ++row)
+		rows.push_back(GetRow(row));
+
+	for (int side = 0; side < 2; ++side)
+	{
+		auto x = left + side * (paneWidth + cOverviewWidth);
+		RenderSide(side, rows, firstRow, ImVec2(x, origin.y), ImVec2(x, top), ImVec2(x + paneWidth, top + visibleHeight), scrollX);
+	}
+	RenderOverview(ImVec2(left + paneWidth, top), ImVec2(left + paneWidth + cOverviewWidth, top + visibleHeight), scrollY, visibleHeight);
+
+	// Scrolling sideways moves the text of both sides, as far as the widest line drawn so far needs
+	auto textWidth = paneWidth - cTextStart * mCharAdvance.x;
+	ImGui::Dummy(ImVec2(visibleWidth + std::max(0.0f, (mLongest + 2) * mCharAdvance.x - textWidth), rowCount * mCharAdvance.y));
+
+	ImGui::EndChild();
+	ImGui::PopStyleVar();
+	ImGui::PopStyleColor();
+}
+
+void TextDiff::RenderSide(int aSide, const std::vector<Row>& aRows, int aFirstRow, const ImVec2& aOrigin, const ImVec2& aClipMin, const ImVec2& aClipMax, float aScrollX)
+{
+	auto& editor = aSide == 0 ? mLeft : mRight;
+	auto& palette = editor.GetPalette();
+	auto tabSize = editor.GetTabSize();
+	auto drawList = ImGui::GetWindowDrawList();
+	auto font = ImGui::GetFont();
+	auto fontSize = ImGui::GetFontSize();
+	auto textX = aOrigin.x + cTextStart * mCharAdvance.x;
+
+	// Row backgrounds and the gutter do not scroll sideways
+	drawList->PushClipRect(aClipMin, aClipMax, true);
+	for (size_t i = 0; i < aRows.size(); ++i)
+	{
+		auto& row = aRows[i];
+		auto lineNo = row.mLines[aSide];
+		ImVec2 rowMin(aOrigin.x, aOrigin.y + (aFirstRow + (int)i) * mCharAdvance.y);
+		if (row.mHunk >= 0)
+			drawList->AddRectFilled(rowMin, ImVec2(aClipMax.x, rowMin.y + mCharAdvance.y),
+				lineNo < 0 ? cFillerColor : row.mPair >= 0 ? cPairedColor : cChangedColors[aSide]);
+		if (lineNo < 0)
+			continue;
+
+		char number[16];
+		snprintf(number, 16, "%6d", lineNo + 1);
+		for (int c = 0; number[c] != '\0'; ++c)
+			font->RenderChar(drawList, fontSize, ImVec2(rowMin.x + c * mCharAdvance.x, rowMin.y), palette[(int)TextEditor::PaletteIndex::LineNumber], (unsigned short)number[c]);
+		if (row.mHunk >= 0)
+			font->RenderChar(drawList, fontSize, ImVec2(rowMin.x + cMarkerColumn * mCharAdvance.x, rowMin.y), cMarkerColors[aSide], aSide == 0 ? '-' : '+');
+	}
+	drawList->PopClipRect();
+
+	// Text is clipped to the area right of the gutter, changed characters are marked on a channel below it
+	drawList->PushClipRect(ImVec2(std::max(aClipMin.x, textX), aClipMin.y), aClipMax, true);
+	drawList->ChannelsSplit(2);
+	for (size_t i = 0; i < aRows.size(); ++i)
+	{
+		auto& row = aRows[i];
+		auto lineNo = row.mLines[aSide];
+		if (lineNo < 0)
+			continue;
+
+		auto& line = editor.GetLine(lineNo);
+		auto y = aOrigin.y + (aFirstRow + (int)i) * mCharAdvance.y;
+		auto x0 = textX - aScrollX;
+		const Span* span = nullptr;
+		const Span* spanEnd = nullptr;
+		if (row.mPair >= 0)
+		{
+			span = mChanges.mSpans[aSide].data() + mChanges.mSpanStarts[aSide][row.mPair];
+			spanEnd = mChanges.mSpans[aSide].data() + mChanges.mSpanStarts[aSide][row.mPair + 1];
+		}
+
+		int column = 0;
+		float spanX = 0.0f;
+		for (int g = 0; g < (int)line.size();)
+		{
+			auto x = x0 + column * mCharAdvance.x;
+			if (span != spanEnd && g == span->mStart)
+				spanX = x;
+
+			auto& glyph = line[g];
+			unsigned int c = (unsigned char)glyph.mChar;
+			int length = 1;
+			if (c == '\t')
+			{
+				column += tabSize - column % tabSize;
+			}
+			else
+			{
+				if (c >= 0x80)
+				{
+					char utf8[4];
+					int count = 0;
+					for (; count < 4 && g + count < (int)line.size(); ++count)
+						utf8[count] = line[g + count].mChar;
+					length = std::max(1, ImTextCharFromUtf8(&c, utf8, utf8 + count));
+				}
+				if (x + mCharAdvance.x >= aClipMin.x && x <= aClipMax.x)
+				{
+					drawList->ChannelsSetCurrent(1);
+					auto color = palette[(int)(glyph.mMultiLineComment ? TextEditor::PaletteIndex::MultiLineComment : glyph.mColorIndex)];
+					font->RenderChar(drawList, fontSize, ImVec2(x, y), color, (unsigned short)c);
+				}
+				column += length;
+			}
+			g += length;
+
+			if (span != spanEnd && g >= span->mEnd)
+			{
+				drawList->ChannelsSetCurrent(0);
+				drawList->AddRectFilled(ImVec2(spanX, y), ImVec2(x0 + column * mCharAdvance.x, y + mCharAdvance.y), cSpanColors[aSide]);
+				++span;
+			}
+		}
+		mLongest = std::max(mLongest, column);
+	}
+	drawList->ChannelsMerge();
+	drawList->PopClipRect();
+}
+
+void TextDiff::RenderOverview(const ImVec2& aMin, const ImVec2& aMax, float aScrollY, float aVisibleHeight)
+{
+	auto drawList = ImGui::GetWindowDrawList();
+	int height = std::max(0, (int)(aMax.y - aMin.y));
+	int rowCount = std::max(1, GetRowCount());
+
+	// Hunks are binned into pixels once per diff and height, then each run of a kind is one rectangle
+	if ((int)mOverview.size() != height || mOverviewVersion != mResultVersion)
+	{
+		mOverview.assign(height, 0);
+		mOverviewVersion = mResultVersion;
+		for (auto& hunk : mChanges.mHunks)
+		{
+			uint8_t kind = hunk.mRightCount == 0 ? 1 : hunk.mLeftCount == 0 ? 2 : 3;
+			int first = (int)((long long)hunk.mRow * height / rowCount);
+			int last = (int)((long long)(hunk.mRow + std::max(hunk.mLeftCount, hunk.mRightCount)) * height / rowCount);
+			for (int y = first; y < std::min(std::max(first + 1, last), height); ++y)
+				mOverview[y] = std::max(mOverview[y], kind);
+		}
+	}
+	for (int y = 0; y < height;)
+	{
+		int end = y + 1;
+		while (end < height && mOverview[end] == mOverview[y])
+			++end;
+		if (mOverview[y] != 0)
+			drawList->AddRectFilled(ImVec2(aMin.x + 2.0f, aMin.y + y), ImVec2(aMax.x - 2.0f, aMin.y + end), cOverviewColors[mOverview[y]]);
+		y = end;
+	}
+
+	// The rows in view, a click on the strip centers the view there
+	auto totalHeight = rowCount * mCharAdvance.y;
+	drawList->AddRectFilled(ImVec2(aMin.x, aMin.y + std::min(1.0f, aScrollY / totalHeight) * height),
+		ImVec2(aMax.x, aMin.y + std::min(1.0f, (aScrollY + aVisibleHeight) / totalHeight) * height), cOverviewViewColor);
+	if (height > 0 && ImGui::IsWindowHovered() && ImGui::IsMouseClicked(0) && ImGui::IsMouseHoveringRect(aMin, aMax))
+		ImGui::SetScrollY(std::max(0.0f, (ImGui::GetMousePos().y - aMin.y) / height * totalHeight - aVisibleHeight * 0.5f));
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "TextEditor.h"
+
+// Two documents side by side with their differences marked. The diff runs on a worker thread: lines are compared with
+// Myers' algorithm, then the characters of each pair of changed lines. Both sides scroll as one, lines missing on one
+// side leave empty rows on it, and only the rows in view are drawn however long the documents are.
+class TextDiff
+{
+public:
+	// Characters [mStart, mEnd) of a line that are not in the line it is paired with
+	struct Span
+	{
+		int mStart;
+		int mEnd;
+	};
+
+	// Lines of the left document replaced by lines of the right one. The first min(mLeftCount, mRightCount) lines of
+	// each side are paired, the rest were removed (left) or added (right).
+	struct Hunk
+	{
+		int mLeftLine;
+		int mLeftCount;
+		int mRightLine;
+		int mRightCount;
+		int mRow;		// the first of its max(mLeftCount, mRightCount) rows
+		int mFirstPair;	// index of its first pair of lines in the changed spans
+	};
+
+	TextDiff();
+	~TextDiff();
+
+	void SetTexts(const std::string& aLeft, const std::string& aRight);
+	void SetLanguageDefinition(const TextEditor::LanguageDefinition& aLanguageDef);
+	void SetPalette(const TextEditor::Palette& aValue);
+
+	const TextEditor& GetLeft() const { return mLeft; }
+	const TextEditor& GetRight() const { return mRight; }
+
+	// Hunks of the texts last set, empty until the worker is done with them
+	bool IsDiffPending() const { return mResultVersion != mVersion; }
+	const std::vector<Hunk>& GetHunks() const { return mChanges.mHunks; }
+	void ScrollToHunk(int aIndex);
+
+	void Render(const char* aTitle, const ImVec2& aSize = ImVec2(), bool aBorder = false);
+
+private:
+	// Diff thread, defined in TextDiff.cpp so this header stays free of <thread> and <atomic> (it is included from /clr code)
+	class DiffWorker;
+
+	struct Changes
+	{
+		std::vector<Hunk> mHunks;
+		std::vector<int> mSpanStarts[2];	// per pair of lines and side, into mSpans, plus the end
+		std::vector<Span> mSpans[2];
+	};
+
+	// What a row shows: a line per side or -1, and its hunk and pair of lines if it has them
+	struct Row
+	{
+		int mLines[2];
+		int mHunk;
+		int mPair;
+	};
+
+	void TakeChanges();
+	int GetRowCount() const;
+	Row GetRow(int aRow) const;
+	void RenderSide(int aSide, const std::vector<Row>& aRows, int aFirstRow, const ImVec2& aOrigin, const ImVec2& aClipMin, const ImVec2& aClipMax, float aScrollX);
+	void RenderOverview(const ImVec2& aMin, const ImVec2& aMax, float aScrollY, float aVisibleHeight);
+
+	TextEditor mLeft;
+	TextEditor mRight;
+	std::unique_ptr<DiffWorker> mWorker;
+	uint32_t mVersion;
+	uint32_t mResultVersion;
+	Changes mChanges;
+
+	ImVec2 mCharAdvance;
+	int mLongest;			// columns of the widest line drawn so far, for the horizontal scroll range
+	int mScrollToRow;		// -1 unless ScrollToHunk was called
+	std::vector<uint8_t> mOverview;	// change kinds per pixel of the overview strip
+	uint32_t mOverviewVersion;
+};
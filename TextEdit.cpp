@@ -1,5 +1,8 @@
 #include "TextEdit.h"
 
+#include <vcclr.h>
+
+#include "TextDiff.h"
 #include "TextEditor.h"
 
 using namespace System;
@@ -8,16 +11,47 @@ using namespace System::Runtime::InteropServices;
 inline std::string ToSTLString(System::String^ str)
 {
     // need to do this because ImGui works with UTF-8, C# works with UTF-16, meshes up international characters and Font-Awesome
-    array<Byte>^ bytes = System::Text::Encoding::UTF8->GetBytes(str);
+    // Encodes straight into the std::string, documents can be large enough that an extra byte array matters
     std::string stlStr;
-    stlStr.resize(bytes->Length);
-    Marshal::Copy(bytes, 0, IntPtr((void*)stlStr.data()), bytes->Length);
+    if (str == nullptr || str->Length == 0)
+        return stlStr;
+    pin_ptr<const wchar_t> chars = PtrToStringChars(str);
+    int byteCount = System::Text::Encoding::UTF8->GetByteCount((wchar_t*)chars, str->Length);
+    stlStr.resize(byteCount);
+    System::Text::Encoding::UTF8->GetBytes((wchar_t*)chars, str->Length, (unsigned char*)&stlStr[0], byteCount);
     return stlStr;
 }
 
+inline System::String^ ToCLIString(const std::string& str)
+{
+    // gcnew String(char*) would decode with the ANSI code page
+    if (str.empty())
+        return System::String::Empty;
+    return gcnew System::String((signed char*)str.data(), 0, (int)str.size(), System::Text::Encoding::UTF8);
+}
+
 namespace ImGuiCLI
 {
 
+    static ::TextEditor::LanguageDefinition ToLanguageDefinition(TextEditorLang l)
+    {
+        switch (l)
+        {
+        case TextEditorLang::GLSL:
+            return ::TextEditor::LanguageDefinition::GLSL();
+        case TextEditorLang::HLSL:
+            return ::TextEditor::LanguageDefinition::HLSL();
+        case TextEditorLang::CClassic:
+            return ::TextEditor::LanguageDefinition::C();
+        case TextEditorLang::Lua:
+            return ::TextEditor::LanguageDefinition::Lua();
+        case TextEditorLang::Angelscript:
+            return ::TextEditor::LanguageDefinition::AngelScript();
+        default:
+            return ::TextEditor::LanguageDefinition::CPlusPlus();
+        }
+    }
+
     TextEditor::TextEditor()
     {
         editor_ = new ::TextEditor();
@@ -30,7 +64,7 @@ namespace ImGuiCLI
 
     System::String^ TextEditor::Text::get()
     {
-        return gcnew System::String(editor_->GetText().c_str());
+        return ToCLIString(editor_->GetText());
     }
     void TextEditor::Text::set(System::String^ txt)
     {
@@ -38,39 +72,132 @@ namespace ImGuiCLI
     }
     System::String^ TextEditor::SelectedText::get()
     {
-        return gcnew System::String(editor_->GetSelectedText().c_str());
+        return ToCLIString(editor_->GetSelectedText());
     }
 
     bool TextEditor::IsReadOnly::get() { return editor_->IsReadOnly(); }
     void TextEditor::IsReadOnly::set(bool value) { editor_->SetReadOnly(value); }
+    bool TextEditor::IsFileView::get() { return editor_->IsFileView(); }
+    bool TextEditor::WordWrap::get() { return editor_->IsWordWrap(); }
+    void TextEditor::WordWrap::set(bool value) { editor_->SetWordWrap(value); }
+    int TextEditor::UndoMemoryLimit::get() { return (int)editor_->GetUndoMemoryLimit(); }
+    void TextEditor::UndoMemoryLimit::set(int value) { editor_->SetUndoMemoryLimit((size_t)std::max(0, value)); }
+    bool TextEditor::AutoComplete::get() { return editor_->IsAutoComplete(); }
+    void TextEditor::AutoComplete::set(bool value) { editor_->SetAutoComplete(value); }
+    int TextEditor::LineLimit::get() { return editor_->GetLineLimit(); }
+    void TextEditor::LineLimit::set(int value) { editor_->SetLineLimit(value); }
+    int TextEditor::CursorCount::get() { return editor_->GetCursorCount(); }
+
+    bool TextEditor::OpenFileView(System::String^ path)
+    {
+        return editor_->OpenFileView(ToSTLString(path).c_str());
+    }
+    bool TextEditor::LoadFile(System::String^ path)
+    {
+        return editor_->LoadFile(ToSTLString(path).c_str());
+    }
+    bool TextEditor::SaveFile(System::String^ path)
+    {
+        return editor_->SaveFile(ToSTLString(path).c_str());
+    }
+
+    bool TextEditor::FindNext(System::String^ what, bool regex, bool caseSensitive, bool backwards)
+    {
+        return editor_->FindNext(ToSTLString(what), regex, caseSensitive, backwards);
+    }
+    bool TextEditor::FindAll(System::String^ what, bool regex, bool caseSensitive)
+    {
+        return editor_->FindAll(ToSTLString(what), regex, caseSensitive);
+    }
+    void TextEditor::ClearFind() { editor_->ClearFind(); }
+    int TextEditor::FindResultCount::get() { return (int)editor_->GetFindResults().size(); }
+    bool TextEditor::Replace(System::String^ what, System::String^ with, bool regex, bool caseSensitive)
+    {
+        return editor_->Replace(ToSTLString(what), ToSTLString(with), regex, caseSensitive);
+    }
+    int TextEditor::ReplaceAll(System::String^ what, System::String^ with, bool regex, bool caseSensitive)
+    {
+        return editor_->ReplaceAll(ToSTLString(what), ToSTLString(with), regex, caseSensitive);
+    }
+    bool TextEditor::Fold(int line, bool folded) { return editor_->Fold(line, folded); }
+    bool TextEditor::ToggleFold(int line) { return editor_->ToggleFold(line); }
+    void TextEditor::FoldAll(bool folded) { editor_->FoldAll(folded); }
+    bool TextEditor::IsLineHidden(int line) { return editor_->IsLineHidden(line); }
+
+    array<System::String^>^ TextEditor::GetCompletions(System::String^ prefix, int max)
+    {
+        auto completions = editor_->GetCompletions(ToSTLString(prefix), (size_t)std::max(0, max));
+        auto result = gcnew array<System::String^>((int)completions.size());
+        for (int i = 0; i < result->Length; ++i)
+            result[i] = ToCLIString(completions[i]);
+        return result;
+    }
+
+    void TextEditor::AppendText(System::String^ text)
+    {
+        editor_->AppendText(ToSTLString(text));
+    }
+    void TextEditor::PostText(System::String^ text)
+    {
+        editor_->PostText(ToSTLString(text));
+    }
+
+    void TextEditor::AddCursor(int line, int column)
+    {
+        editor_->AddCursor(::TextEditor::Coordinates(line, column));
+    }
+    void TextEditor::SetColumnSelection(int startLine, int startColumn, int endLine, int endColumn)
+    {
+        editor_->SetColumnSelection(::TextEditor::Coordinates(startLine, startColumn), ::TextEditor::Coordinates(endLine, endColumn));
+    }
+    void TextEditor::ClearExtraCursors() { editor_->ClearExtraCursors(); }
+    bool TextEditor::JumpToMatchingBracket(bool select) { return editor_->JumpToMatchingBracket(select); }
+    unsigned TextEditor::TextVersion::get() { return editor_->GetTextVersion(); }
+    bool TextEditor::SetSemanticTokens(array<TextEditorToken>^ tokens, unsigned textVersion)
+    {
+        if (tokens == nullptr || tokens->Length == 0)
+            return editor_->SetSemanticTokens(nullptr, 0, textVersion);
+
+        // The array is blittable, the native side reads it in place while it is pinned
+        pin_ptr<TextEditorToken> first = &tokens[0];
+        TextEditorToken* data = first;
+        return editor_->SetSemanticTokens(reinterpret_cast<const ::TextEditor::SemanticToken*>(data), tokens->Length, textVersion);
+    }
+    void TextEditor::ClearSemanticTokens() { editor_->ClearSemanticTokens(); }
 
     void TextEditor::SetLanguage(TextEditorLang l)
     {
-        switch (l)
-        {
-        case TextEditorLang::CPP:
-            editor_->SetLanguageDefinition(::TextEditor::LanguageDefinition::CPlusPlus());
-            break;
-        case TextEditorLang::GLSL:
-            editor_->SetLanguageDefinition(::TextEditor::LanguageDefinition::GLSL());
-            break;
-        case TextEditorLang::HLSL:
-            editor_->SetLanguageDefinition(::TextEditor::LanguageDefinition::HLSL());
-            break;
-        case TextEditorLang::CClassic:
-            editor_->SetLanguageDefinition(::TextEditor::LanguageDefinition::C());
-            break;
-        case TextEditorLang::Lua:
-            editor_->SetLanguageDefinition(::TextEditor::LanguageDefinition::Lua());
-            break;
-        case TextEditorLang::Angelscript:
-            editor_->SetLanguageDefinition(::TextEditor::LanguageDefinition::AngelScript());
-            break;
-        }
+        editor_->SetLanguageDefinition(ToLanguageDefinition(l));
     }
     void TextEditor::Render(System::String^ title, Vector2 size, bool border)
     {
         editor_->Render(ToSTLString(title).c_str(), ImVec2(size.X, size.Y), border);
     }
 
+    TextDiff::TextDiff()
+    {
+        diff_ = new ::TextDiff();
+        diff_->SetLanguageDefinition(::TextEditor::LanguageDefinition::CPlusPlus());
+    }
+    TextDiff::~TextDiff()
+    {
+        delete diff_;
+    }
+
+    void TextDiff::SetTexts(System::String^ left, System::String^ right)
+    {
+        diff_->SetTexts(ToSTLString(left), ToSTLString(right));
+    }
+    void TextDiff::SetLanguage(TextEditorLang l)
+    {
+        diff_->SetLanguageDefinition(ToLanguageDefinition(l));
+    }
+    bool TextDiff::IsDiffPending::get() { return diff_->IsDiffPending(); }
+    int TextDiff::HunkCount::get() { return (int)diff_->GetHunks().size(); }
+    void TextDiff::ScrollToHunk(int index) { diff_->ScrollToHunk(index); }
+    void TextDiff::Render(System::String^ title, Vector2 size, bool border)
+    {
+        diff_->Render(ToSTLString(title).c_str(), ImVec2(size.X, size.Y), border);
+    }
+
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 class TextEditor;
+class TextDiff;
 
 using namespace Microsoft::Xna::Framework;
 
@@ -17,6 +18,34 @@ namespace ImGuiCLI
         Angelscript
     };
 
+    /// Syntax colors of the editor palette, in the same order.
+    public enum class TextEditorColor
+    {
+        Default,
+        Keyword,
+        Number,
+        String,
+        CharLiteral,
+        Punctuation,
+        Preprocessor,
+        Identifier,
+        KnownIdentifier,
+        PreprocIdentifier,
+        Comment,
+        MultiLineComment
+    };
+
+    /// A run of text colored from outside, e.g. by a language server. Line is zero based, Column and Length count the
+    /// UTF-8 bytes of the line. Laid out like the native token so an array of them is passed without conversion.
+    [System::Runtime::InteropServices::StructLayout(System::Runtime::InteropServices::LayoutKind::Sequential)]
+    public value struct TextEditorToken
+    {
+        int Line;
+        int Column;
+        int Length;
+        TextEditorColor Color;
+    };
+
     public ref class TextEditor
     {
     public:
@@ -26,12 +55,82 @@ namespace ImGuiCLI
         property System::String^ Text { System::String^ get(); void set(System::String^); }
         property System::String^ SelectedText { System::String^ get(); }
         property bool IsReadOnly { bool get(); void set(bool); }
+        property bool IsFileView { bool get(); }
+        /// Wraps long lines at the window width instead of scrolling horizontally.
+        property bool WordWrap { bool get(); void set(bool); }
+        /// Bytes of undo history kept, the oldest edits are forgotten first.
+        property int UndoMemoryLimit { int get(); void set(int); }
+        /// Offers identifiers from the text that start with the word being typed. Tab or enter takes one.
+        property bool AutoComplete { bool get(); void set(bool); }
+        /// Lines kept by AppendText and PostText, the oldest are dropped past it. 0 keeps every line.
+        property int LineLimit { int get(); void set(int); }
+        /// Cursors in the text, typing and pasting edit at every one of them as a single undo step.
+        property int CursorCount { int get(); }
 
         void SetLanguage(TextEditorLang);
+        /// Shows a file read-only without reading it into memory, returns false if it cannot be opened. Setting Text leaves this mode.
+        bool OpenFileView(System::String^ path);
+        /// Reads or writes the text as UTF-8 in chunks, without building it as one string. Return false on I/O errors.
+        bool LoadFile(System::String^ path);
+        bool SaveFile(System::String^ path);
+        /// Selects the next match after the cursor, wrapping around. Regular expressions use ECMAScript syntax.
+        bool FindNext(System::String^ what, bool regex, bool caseSensitive, bool backwards);
+        /// Highlights every match, returns false if the expression is invalid. Large regular expression searches finish in the background.
+        bool FindAll(System::String^ what, bool regex, bool caseSensitive);
+        void ClearFind();
+        property int FindResultCount { int get(); }
+        bool Replace(System::String^ what, System::String^ with, bool regex, bool caseSensitive);
+        /// Returns the number of replacements, undone as a single step.
+        int ReplaceAll(System::String^ what, System::String^ with, bool regex, bool caseSensitive);
+        /// Folds or unfolds the region starting on a line (zero based), returns false if none starts there.
+        bool Fold(int line, bool folded);
+        bool ToggleFold(int line);
+        void FoldAll(bool folded);
+        bool IsLineHidden(int line);
+        /// Identifiers in the text starting with prefix, in order.
+        array<System::String^>^ GetCompletions(System::String^ prefix, int max);
+        /// Adds text at the end, following it if the view was at the bottom.
+        void AppendText(System::String^ text);
+        /// Same as AppendText but safe from any thread, the text shows up on the next Render.
+        void PostText(System::String^ text);
+        /// Adds a cursor at a line and character (zero based), it becomes the one scrolled to.
+        void AddCursor(int line, int column);
+        /// Puts a cursor on every line from startLine to endLine, selecting the same columns on each.
+        void SetColumnSelection(int startLine, int startColumn, int endLine, int endColumn);
+        void ClearExtraCursors();
+        /// Moves the cursor to the bracket matching the one at or just before it, returns false if there is none.
+        bool JumpToMatchingBracket(bool select);
+        /// Changes with every edit. Semantic tokens are only taken for the version they were computed from.
+        property unsigned TextVersion { unsigned get(); }
+        /// Draws the tokens over the syntax colors, returns false if the text changed since textVersion. Tokens are
+        /// sorted by line then column, edits drop the ones on the lines around them.
+        bool SetSemanticTokens(array<TextEditorToken>^ tokens, unsigned textVersion);
+        void ClearSemanticTokens();
         void Render(System::String^ title, Vector2 size, bool border);
 
     private:
         ::TextEditor* editor_;
     };
 
+    /// Two texts side by side with the lines and characters that differ marked. The diff is worked out in the
+    /// background, both sides scroll together.
+    public ref class TextDiff
+    {
+    public:
+        TextDiff();
+        ~TextDiff();
+
+        void SetTexts(System::String^ left, System::String^ right);
+        void SetLanguage(TextEditorLang);
+        /// True until the diff of the texts last set is done, HunkCount is 0 until then.
+        property bool IsDiffPending { bool get(); }
+        /// Runs of lines that differ between the two sides.
+        property int HunkCount { int get(); }
+        void ScrollToHunk(int index);
+        void Render(System::String^ title, Vector2 size, bool border);
+
+    private:
+        ::TextDiff* diff_;
+    };
+
 }
\ No newline at end of file
@@ -1,34 +1,169 @@
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 #include <string>
 #include <regex>
+#include <thread>
 
 #include "TextEditor.h"
 #include "imgui_internal.h"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTEDITOR_SSE2
+#include <emmintrin.h>
+#endif
+
 #undef max
 #undef min
 
 static const int cTextStart = 7;
 
+// Dirty ranges up to this many lines are colorized on the UI thread, anything bigger goes to the worker
+static const int cMaxColorizeLinesPerFrame = 500;
+static const int cColorizeLinesPerResult = 4096;
+static const int cColorizeLinesPerJob = 2 * cColorizeLinesPerResult;	// bounds the snapshot copied per frame
+
+// Render caches kept, a power of two comfortably above the number of lines that fit on screen
+static const int cRenderCacheLines = 256;
+
+// Lines longer than this many glyphs get a ColumnIndex, with one entry per block of this many glyphs
+static const int cColumnBlock = 64;
+static const int cColumnIndexLines = 64;
+
+// Wrap points are cached for about as many lines as render data, rows are never narrower than cMinWrapColumns
+static const int cWrapCacheLines = 256;
+static const int cMinWrapColumns = 16;
+static const int cMaxRecountLinesPerFrame = 16384;	// after the wrap width changed
+
+// Fold ranges open are kept about every this many lines. An edit finds ranges again from the checkpoint above it down
+// to one below it where the same ranges are open.
+static const int cFoldCheckpointLines = 1024;
+
+// Completions offered for the word at the cursor. New identifiers are merged into the ordered ones this many at a time.
+static const size_t cMaxCompletions = 12;
+static const size_t cMaxUnsortedIdentifiers = 256;
+
+// Characters typed or deleted one after the other share an undo record until a new word starts or the user pauses this long
+static const int cUndoGroupMilliseconds = 1000;
+static const size_t cDefaultUndoMemoryLimit = 16 * 1024 * 1024;
+
+static const size_t cTextStreamBuffer = 64 * 1024;
+
 // TODO
 // - multiline comments vs single-line: latter is blocking start of a ML
 // - handle non-monospace fonts
 // - handle unicode/utf
 // - testing
 
+// Created up front, PostText may be called from other threads at any time
+class TextEditor::PostedTextStack
+{
+public:
+	struct Node
+	{
+		std::string mText;
+		Node* mNext;
+	};
+
+	PostedTextStack() : mTop(nullptr) {}
+
+	~PostedTextStack()
+	{
+		for (auto node = Take(); node != nullptr;)
+		{
+			auto next = node->mNext;
+			delete node;
+			node = next;
+		}
+	}
+
+	void Push(std::string aText)
+	{
+		auto node = new Node{ std::move(aText), mTop.load(std::memory_order_relaxed) };
+		while (!mTop.compare_exchange_weak(node->mNext, node, std::memory_order_release, std::memory_order_relaxed))
+			;
+	}
+
+	// Returns everything pushed so far oldest first, the caller owns it. The stack has the newest text on top.
+	Node* Take()
+	{
+		Node* oldest = nullptr;
+		for (auto top = mTop.exchange(nullptr, std::memory_order_acquire); top != nullptr;)
+		{
+			auto next = top->mNext;
+			top->mNext = oldest;
+			oldest = top;
+			top = next;
+		}
+		return oldest;
+	}
+
+private:
+	std::atomic<Node*> mTop;
+};
+
 TextEditor::TextEditor()
 	: mLineSpacing(0.0f)
 	, mUndoIndex(0)
+	, mUndoMemory(0)
+	, mUndoMemoryLimit(cDefaultUndoMemoryLimit)
+	, mUndoMergeable(false)
+	, mUndoTime(0)
 	, mTabSize(4)
 	, mOverwrite(false)
 	, mReadOnly(false)
 	, mWithinRender(false)
 	, mScrollToCursor(false)
 	, mWordSelectionMode(false)
-	, mColorRangeMin(0)
+	, mWordWrap(false)
+	, mColorRangeMin(std::numeric_limits<int>::max())
 	, mColorRangeMax(0)
-	, mCheckMultilineComments(true)
+	, mTextVersion(0)
+	, mEditVersion(0)
+	, mColorizedLines(std::numeric_limits<int>::max())
+	, mLastLineCount(0)
+	, mLineLimit(0)
+	, mFollowEnd(false)
+	, mPostedText(new PostedTextStack())
+	, mFindDirtyMin(std::numeric_limits<int>::max())
+	, mFindDirtyMax(0)
+	, mRenderCache(cRenderCacheLines)
+	, mColumnIndex(cColumnIndexLines)
+	, mWrapColumns(80)
+	, mRowStartsDirty(0)
+	, mRowsDirtyMin(std::numeric_limits<int>::max())
+	, mRowsDirtyMax(0)
+	, mRowsRecounted(0)
+	, mLineWraps(cWrapCacheLines)
+	, mFoldDirtyMin(std::numeric_limits<int>::max())
+	, mFoldDirtyMax(0)
+	, mIdentifiersDirtyMin(std::numeric_limits<int>::max())
+	, mIdentifiersDirtyMax(0)
+	, mAutoComplete(false)
+	, mCompletionIndex(0)
+	, mCompletionVersion(0)
+	, mBracketLeaves(0)
+	, mBracketTreeLines(0)
+	, mBracketsDirtyMin(std::numeric_limits<int>::max())
+	, mBracketsDirtyMax(0)
+	, mBracketsMoved(std::numeric_limits<int>::max())
+	, mStyleVersion(0)
+	, mRenderFont(nullptr)
+	, mRenderFontSize(0.0f)
 {
 	SetPalette(GetDarkPalette());
 	SetLanguageDefinition(LanguageDefinition::HLSL());
@@ -42,53 +177,176 @@ TextEditor::~TextEditor()
 
 void TextEditor::SetLanguageDefinition(const LanguageDefinition & aLanguageDef)
 {
+	// The worker reads the language definition, stop it before changing anything. It restarts on demand.
+	mColorizeWorker.reset();
+
 	mLanguageDefinition = aLanguageDef;
 	mRegexList.clear();
+	mKeywordTable.Build(mLanguageDefinition);
+
+	// Compiling the regular expressions is expensive, only do it when there is no hand written tokenizer to use
+	if (mLanguageDefinition.mTokenize == nullptr)
+	{
+		for (auto& r : mLanguageDefinition.mTokenRegexStrings)
+			mRegexList.push_back(std::make_pair(std::regex(r.first, std::regex_constants::optimize), r.second));
+	}
 
-	for (auto& r : mLanguageDefinition.mTokenRegexStrings)
-		mRegexList.push_back(std::make_pair(std::regex(r.first, std::regex_constants::optimize), r.second));
+	// A file view colorizes lines as they load, dropping them gets them colorized for the new language
+	mLines.Unload();
+	ClearFolds();
+	++mStyleVersion;
 }
 
 void TextEditor::SetPalette(const Palette & aValue)
 {
 	mPalette = aValue;
+	++mStyleVersion;
 }
 
-int TextEditor::AppendBuffer(std::string& aBuffer, char chr, int aIndex)
+const TextEditor::LineRenderCache& TextEditor::GetRenderCache(int aLineNo, const Line& aLine, int aFirstColumn, int aLastColumn)
 {
-	if (chr != '\t')
+	auto& cache = mRenderCache[aLineNo & (cRenderCacheLines - 1)];
+	if (cache.mLine == aLineNo && cache.mLineVersion == aLine.mVersion && cache.mStyleVersion == mStyleVersion &&
+		cache.mFirstColumn <= aFirstColumn && aLastColumn <= cache.mLastColumn)
+		return cache;
+
+	// Build a screen width of margin on both sides, so scrolling a little does not rebuild every frame
+	auto margin = aLastColumn - aFirstColumn;
+	cache.mLine = aLineNo;
+	cache.mLineVersion = aLine.mVersion;
+	cache.mStyleVersion = mStyleVersion;
+	cache.mFirstColumn = std::max(0, aFirstColumn - margin);
+	cache.mLastColumn = aLastColumn + margin;
+	cache.mWidth = TextDistanceToLineStart(Coordinates(aLineNo, (int)aLine.size()));
+	cache.mQuads.clear();
+
+	// Same glyph placement as ImFont::RenderText, except that every character starts on its column: quads are relative
+	// to the rounded line start and include the font's display offset.
+	auto font = ImGui::GetFont();
+	auto scale = ImGui::GetFontSize() / font->FontSize;
+	auto addGlyph = [&](unsigned int aChar, int aColumn, ImU32 aColor)
 	{
-		aBuffer.push_back(chr);
-		return aIndex + 1;
+		if (aChar < 32 || aChar == ' ')
+			return;
+		auto glyph = font->FindGlyph((ImWchar)aChar);
+		if (glyph == nullptr)
+			return;
+		auto x = (float)(int)(aColumn * mCharAdvance.x) + font->DisplayOffset.x;
+		auto y = font->DisplayOffset.y;
+		RenderQuad quad;
+		quad.mCellX = x;
+		quad.mMin = ImVec2(x + glyph->X0 * scale, y + glyph->Y0 * scale);
+		quad.mMax = ImVec2(x + glyph->X1 * scale, y + glyph->Y1 * scale);
+		quad.mUVMin = ImVec2(glyph->U0, glyph->V0);
+		quad.mUVMax = ImVec2(glyph->U1, glyph->V1);
+		quad.mColor = aColor;
+		cache.mQuads.push_back(quad);
+	};
+
+	char number[16];
+	snprintf(number, 16, "%6d", aLineNo + 1);
+	for (int i = 0; number[i] != '\0'; ++i)
+		addGlyph((unsigned char)number[i], i, mPalette[(int)PaletteIndex::LineNumber]);
+
+	// Start from the first glyph in the window, skipping any UTF-8 continuation bytes the window cuts into
+	size_t i = GlyphIndexAtDistance(aLineNo, cache.mFirstColumn);
+	int column = TextDistanceToLineStart(Coordinates(aLineNo, (int)i));
+	for (; i < aLine.size() && ((unsigned char)aLine[i].mChar & 0xC0) == 0x80; ++i)
+		++column;
+
+	// Semantic tokens of the line take over from the lexer's colors
+	const SemanticSpan* span = nullptr;
+	const SemanticSpan* spanEnd = nullptr;
+	if (aLineNo + 1 < (int)mSemanticLineStarts.size())
+	{
+		span = mSemanticSpans.data() + mSemanticLineStarts[aLineNo];
+		spanEnd = mSemanticSpans.data() + mSemanticLineStarts[aLineNo + 1];
 	}
-	else
+
+	while (i < aLine.size() && column < cache.mLastColumn)
 	{
-		auto num = mTabSize - aIndex % mTabSize;
-		for (int j = num; j > 0; --j)
-			aBuffer.push_back(' ');
-		return aIndex + num;
+		auto& glyph = aLine[i];
+		while (span != spanEnd && span->mColumn + span->mLength <= (int)i)
+			++span;
+		auto colorIndex = glyph.mMultiLineComment ? PaletteIndex::MultiLineComment : glyph.mColorIndex;
+		if (span != spanEnd && span->mColumn <= (int)i)
+			colorIndex = span->mColorIndex;
+		auto color = mPalette[(int)colorIndex];
+		unsigned int c = (unsigned char)glyph.mChar;
+		if (c == '\t')
+		{
+			column += mTabSize - column % mTabSize;
+			++i;
+			continue;
+		}
+
+		int length = 1;
+		if (c >= 0x80)
+		{
+			char utf8[4];
+			int count = 0;
+			for (; count < 4 && i + count < aLine.size(); ++count)
+				utf8[count] = aLine[i + count].mChar;
+			length = std::max(1, ImTextCharFromUtf8(&c, utf8, utf8 + count));
+		}
+		addGlyph(c, cTextStart + column, color);
+		column += length;
+		i += length;
 	}
+	return cache;
 }
 
 std::string TextEditor::GetText(const Coordinates & aStart, const Coordinates & aEnd) const
 {
 	std::string result;
+	if (aEnd <= aStart)
+		return result;
+
+	auto lastLine = std::min(aEnd.mLine, (int)mLines.size() - 1);
+	if (aStart.mLine > lastLine)
+		return result;
 
-	int prevLineNo = aStart.mLine;
-	for (auto it = aStart; it <= aEnd; Advance(it))
+	// A file view is copied straight from the mapping, where the lines in between are the bytes in between. Going through
+	// the lines would load every chunk of them.
+	if (mLines.IsMapped())
 	{
-		if (prevLineNo != it.mLine && it.mLine < (int) mLines.size())
-			result.push_back('\n');
+		size_t firstSize, lastSize;
+		auto first = mLines.GetMappedLine(aStart.mLine, firstSize);
+		auto last = mLines.GetMappedLine(lastLine, lastSize);
+		first += std::min((size_t)std::max(0, aStart.mColumn), firstSize);
+		last += lastLine == aEnd.mLine ? std::min((size_t)std::max(0, aEnd.mColumn), lastSize) : lastSize;
+		return last > first ? std::string(first, last) : result;
+	}
 
-		if (it == aEnd)
-			break;
+	// Measured first, so the text is copied line by line into a single allocation of the right size
+	auto span = [&](int aLine, size_t& aFirst, size_t& aLast)
+	{
+		auto size = mLines[aLine].size();
+		aFirst = aLine == aStart.mLine ? std::min((size_t)std::max(0, aStart.mColumn), size) : 0;
+		aLast = aLine == aEnd.mLine ? std::min((size_t)std::max(0, aEnd.mColumn), size) : size;
+		aLast = std::max(aFirst, aLast);
+	};
 
-		prevLineNo = it.mLine;
-		const auto& line = mLines[it.mLine];
-		if (!line.empty() && it.mColumn < (int)line.size())
-			result.push_back(line[it.mColumn].mChar);
+	size_t length = 0;
+	for (int i = aStart.mLine; i <= lastLine; ++i)
+	{
+		size_t first, last;
+		span(i, first, last);
+		length += last - first + (i > aStart.mLine ? 1 : 0);
 	}
 
+	result.resize(length);
+	auto out = &result[0];
+	for (int i = aStart.mLine; i <= lastLine; ++i)
+	{
+		if (i > aStart.mLine)
+			*out++ = '\n';
+		size_t first, last;
+		span(i, first, last);
+		auto& line = mLines[i];
+		for (auto j = first; j < last; ++j)
+			*out++ = line[j].mChar;
+	}
 	return result;
 }
 
@@ -144,8 +402,12 @@ void TextEditor::DeleteRange(const Coordinates & aStart, const Coordinates & aEn
 		firstLine.erase(firstLine.begin() + aStart.mColumn, firstLine.end());
 		lastLine.erase(lastLine.begin(), lastLine.begin() + aEnd.mColumn);
 
+		// The joined line ends with what ended the last one, keep its lexer state so re-colorizing stops in the right place
 		if (aStart.mLine < aEnd.mLine)
+		{
 			firstLine.insert(firstLine.end(), lastLine.begin(), lastLine.end());
+			firstLine.mEndState = lastLine.mEndState;
+		}
 
 		if (aStart.mLine < aEnd.mLine)
 			RemoveLine(aStart.mLine + 1, aEnd.mLine + 1);
@@ -156,53 +418,117 @@ int TextEditor::InsertTextAt(Coordinates& /* inout */ aWhere, const char * aValu
 {
 	assert(!mReadOnly);
 
-	int totalLines = 0;
-	auto chr = *aValue;
-	while (chr != '\0')
+	if (*aValue == '\0')
+		return 0;
+	if (mLines.empty())
+		mLines.push_back(Line());
+
+	// Each run of characters between newlines is inserted in one go, and the lines after the first are built aside and
+	// spliced in together, so a paste costs the size of the pasted text rather than a shift of the line per character.
+	auto appendRun = [](std::vector<Glyph>& aGlyphs, const char* aBegin, const char* aEnd)
 	{
-		if (mLines.empty())
-			mLines.push_back(Line());
+		aGlyphs.reserve(aGlyphs.size() + (aEnd - aBegin));
+		for (auto p = aBegin; p != aEnd; ++p)
+			if (*p != '\r')
+				aGlyphs.push_back(Glyph(*p, PaletteIndex::Default));
+	};
 
-		if (chr == '\r')
-		{
-			// skip
-		}
-		else if (chr == '\n')
-		{
-			if (aWhere.mColumn < (int)mLines[aWhere.mLine].size())
-			{
-				auto& newLine = InsertLine(aWhere.mLine + 1);
-				auto& line = mLines[aWhere.mLine];
-				newLine.insert(newLine.begin(), line.begin() + aWhere.mColumn, line.end());
-				line.erase(line.begin() + aWhere.mColumn, line.end());
-			}
-			else
-			{
-				InsertLine(aWhere.mLine + 1);
-			}
-			++aWhere.mLine;
-			aWhere.mColumn = 0;
-			++totalLines;
-		}
-		else
-		{
-			auto& line = mLines[aWhere.mLine];
-			line.insert(line.begin() + aWhere.mColumn, Glyph(chr, PaletteIndex::Default));
-			++aWhere.mColumn;
-		}
-		chr = *(++aValue);
+	auto& line = mLines[aWhere.mLine];
+	auto end = aValue + strlen(aValue);
+	auto newline = (const char*)memchr(aValue, '\n', end - aValue);
+	if (newline == nullptr)
+	{
+		std::vector<Glyph> run;
+		appendRun(run, aValue, end);
+		line.insert(line.begin() + aWhere.mColumn, run.begin(), run.end());
+		aWhere.mColumn += (int)run.size();
+		return 0;
+	}
+
+	std::vector<Glyph> tail(line.begin() + aWhere.mColumn, line.end());
+	line.erase(line.begin() + aWhere.mColumn, line.end());
+	appendRun(line, aValue, newline);
+
+	std::vector<Line> newLines;
+	for (auto first = newline + 1;;)
+	{
+		newline = (const char*)memchr(first, '\n', end - first);
+		newLines.emplace_back();
+		appendRun(newLines.back(), first, newline != nullptr ? newline : end);
+		if (newline == nullptr)
+			break;
+		first = newline + 1;
 	}
 
+	auto totalLines = (int)newLines.size();
+	newLines.back().insert(newLines.back().end(), tail.begin(), tail.end());
+	newLines.back().mEndState = line.mEndState;
+	aWhere = Coordinates(aWhere.mLine + totalLines, (int)(newLines.back().size() - tail.size()));
+	InsertLines(aWhere.mLine - totalLines + 1, std::move(newLines));
 	return totalLines;
 }
 
-void TextEditor::AddUndo(UndoRecord& aValue)
+void TextEditor::AddUndo(UndoRecord& aValue, bool aMergeable)
 {
 	assert(!mReadOnly);
 
-	mUndoBuffer.resize(mUndoIndex + 1);
-	mUndoBuffer.back() = aValue;
+	auto now = (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	bool merge = aMergeable && mUndoMergeable && mUndoIndex == (int)mUndoBuffer.size() && now - mUndoTime < cUndoGroupMilliseconds;
+	mUndoMergeable = aMergeable;
+	mUndoTime = now;
+
+	while ((int)mUndoBuffer.size() > mUndoIndex)
+	{
+		mUndoMemory -= mUndoBuffer.back().GetMemoryUsage();
+		mUndoBuffer.pop_back();
+	}
+
+	if (merge)
+	{
+		auto& last = mUndoBuffer.back();
+		auto before = last.GetMemoryUsage();
+		if (last.Merge(aValue))
+		{
+			mUndoMemory += last.GetMemoryUsage() - before;
+			return;
+		}
+	}
+
+	// Text gathered glyph by glyph can have twice the capacity it needs
+	if (!aMergeable)
+	{
+		aValue.mAdded.shrink_to_fit();
+		aValue.mRemoved.shrink_to_fit();
+	}
+	mUndoBuffer.push_back(std::move(aValue));
+	mUndoMemory += mUndoBuffer.back().GetMemoryUsage();
 	++mUndoIndex;
+	TrimUndo();
+}
+
+void TextEditor::TrimUndo()
+{
+	// Only records that can be undone are dropped, redo has to stay contiguous with the current text
+	while (mUndoMemory > mUndoMemoryLimit && mUndoIndex > 0 && mUndoBuffer.size() > 1)
+	{
+		mUndoMemory -= mUndoBuffer.front().GetMemoryUsage();
+		mUndoBuffer.pop_front();
+		--mUndoIndex;
+	}
+}
+
+void TextEditor::ClearUndo()
+{
+	mUndoBuffer.clear();
+	mUndoIndex = 0;
+	mUndoMemory = 0;
+	mUndoMergeable = false;
+}
+
+void TextEditor::SetUndoMemoryLimit(size_t aBytes)
+{
+	mUndoMemoryLimit = aBytes;
+	TrimUndo();
 }
 
 TextEditor::Coordinates TextEditor::ScreenPosToCoordinates(const ImVec2& aPosition) const
@@ -218,20 +544,12 @@ TextEditor::Coordinates TextEditor::ScreenPosToCoordinates(const ImVec2& aPositi
     if (frac > 0.5f)
         columnCoord += 1;
 
+	if (HasRowIndex())
+		return RowPositionToCoordinates(lineNo, columnCoord);
+
 	int column = 0;
 	if (lineNo >= 0 && lineNo < (int)mLines.size())
-	{
-		auto& line = mLines[lineNo];
-		auto distance = 0;
-		while (distance < columnCoord && column < (int)line.size())
-		{
-			if (line[column].mChar == '\t')
-				distance = (distance / mTabSize) * mTabSize + mTabSize;
-			else
-				++distance;
-			++column;
-		}
-	}
+		column = GlyphIndexAtDistance(lineNo, columnCoord);
 	return Coordinates(lineNo, column);
 }
 
@@ -289,6 +607,393 @@ bool TextEditor::IsOnWordBoundary(const Coordinates & aAt) const
 	return line[aAt.mColumn].mColorIndex != line[aAt.mColumn - 1].mColorIndex;
 }
 
+void TextEditor::Lines::clear()
+{
+	mChunks.clear();
+	mChunkStarts.clear();
+	mSize = 0;
+	mLastChunk = 0;
+
+	mFile.reset();
+	mNewlines.clear();
+	mNewlines.shrink_to_fit();
+	mColorizer = nullptr;
+	mLoadedChunks.clear();
+	mChunkStartStates.clear();
+}
+
+void TextEditor::Lines::push_back(Line&& aLine)
+{
+	assert(!IsMapped());
+	if (mChunks.empty() || mChunks.back().size() >= cChunkLines)
+	{
+		mChunkStarts.push_back((int)mSize);
+		mChunks.emplace_back();
+		mChunks.back().reserve(cChunkLines);
+	}
+	mChunks.back().push_back(std::move(aLine));
+	++mSize;
+}
+
+TextEditor::Line& TextEditor::Lines::insert(int aIndex, Line&& aLine)
+{
+	assert(!IsMapped() && aIndex >= 0 && aIndex <= (int)mSize);
+	if (aIndex == (int)mSize)
+	{
+		push_back(std::move(aLine));
+		return back();
+	}
+
+	auto chunk = FindChunk(aIndex);
+	auto offset = aIndex - mChunkStarts[chunk];
+	auto& lines = mChunks[chunk];
+	lines.insert(lines.begin() + offset, std::move(aLine));
+	++mSize;
+
+	if (lines.size() > cChunkLines)
+	{
+		// Split the full chunk in halves
+		auto half = (int)lines.size() / 2;
+		std::vector<Line> upper(std::make_move_iterator(lines.begin() + half), std::make_move_iterator(lines.end()));
+		lines.erase(lines.begin() + half, lines.end());
+		mChunks.insert(mChunks.begin() + chunk + 1, std::move(upper));
+		if (offset >= half)
+		{
+			++chunk;
+			offset -= half;
+		}
+	}
+	UpdateStarts(chunk);
+	return mChunks[chunk][offset];
+}
+
+void TextEditor::Lines::insert(int aIndex, std::vector<Line>&& aLines)
+{
+	assert(!IsMapped() && aIndex >= 0 && aIndex <= (int)mSize);
+	if (aLines.empty())
+		return;
+
+	if (aIndex == (int)mSize)
+	{
+		for (auto& line : aLines)
+			push_back(std::move(line));
+		return;
+	}
+
+	// Cut the chunk at the insertion point, then refill it and as many new chunks as needed from the inserted lines
+	// followed by the cut off tail
+	mSize += aLines.size();
+	auto chunk = FindChunk(aIndex);
+	auto offset = aIndex - mChunkStarts[chunk];
+	auto& lines = mChunks[chunk];
+	aLines.insert(aLines.end(), std::make_move_iterator(lines.begin() + offset), std::make_move_iterator(lines.end()));
+	lines.erase(lines.begin() + offset, lines.end());
+
+	auto next = aLines.begin();
+	auto fill = std::min((size_t)(aLines.end() - next), cChunkLines - lines.size());
+	lines.insert(lines.end(), std::make_move_iterator(next), std::make_move_iterator(next + fill));
+	next += fill;
+
+	std::vector<std::vector<Line>> added;
+	while (next != aLines.end())
+	{
+		auto count = std::min((size_t)(aLines.end() - next), (size_t)cChunkLines);
+		added.emplace_back(std::make_move_iterator(next), std::make_move_iterator(next + count));
+		next += count;
+	}
+	mChunks.insert(mChunks.begin() + chunk + 1, std::make_move_iterator(added.begin()), std::make_move_iterator(added.end()));
+	UpdateStarts(chunk);
+}
+
+void TextEditor::Lines::erase(int aFirst, int aLast)
+{
+	assert(!IsMapped());
+	assert(aFirst >= 0 && aFirst <= aLast && aLast <= (int)mSize);
+	if (aFirst == aLast)
+		return;
+
+	auto first = FindChunk(aFirst);
+	auto chunk = first;
+	auto offset = aFirst - mChunkStarts[chunk];
+	auto remaining = aLast - aFirst;
+	mSize -= remaining;
+	while (remaining > 0)
+	{
+		auto& lines = mChunks[chunk];
+		auto count = std::min(remaining, (int)lines.size() - offset);
+		lines.erase(lines.begin() + offset, lines.begin() + offset + count);
+		remaining -= count;
+		if (lines.empty())
+			mChunks.erase(mChunks.begin() + chunk);
+		else
+			++chunk;
+		offset = 0;
+	}
+
+	// Merge what is left around the hole with a neighbour, so repeated deletes do not leave a trail of tiny chunks
+	first = std::min(first, (int)mChunks.size() - 1);
+	for (auto i = std::max(0, first - 1); i <= first && i + 1 < (int)mChunks.size(); ++i)
+	{
+		if (mChunks[i].size() + mChunks[i + 1].size() <= cChunkLines)
+		{
+			auto& lines = mChunks[i];
+			lines.insert(lines.end(), std::make_move_iterator(mChunks[i + 1].begin()), std::make_move_iterator(mChunks[i + 1].end()));
+			mChunks.erase(mChunks.begin() + i + 1);
+			break;
+		}
+	}
+	UpdateStarts(std::max(0, first - 1));
+}
+
+void TextEditor::Lines::UpdateStarts(int aFromChunk)
+{
+	mChunkStarts.resize(mChunks.size());
+	for (auto i = aFromChunk; i < (int)mChunks.size(); ++i)
+		mChunkStarts[i] = i == 0 ? 0 : mChunkStarts[i - 1] + (int)mChunks[i - 1].size();
+	mLastChunk = 0;
+}
+
+class TextEditor::Lines::MappedFile
+{
+public:
+	MappedFile()
+		: mData(nullptr)
+		, mSize(0)
+#ifdef _WIN32
+		, mFile(INVALID_HANDLE_VALUE)
+		, mMapping(nullptr)
+#else
+		, mFile(-1)
+#endif
+	{}
+
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if (mData != nullptr)
+			UnmapViewOfFile(mData);
+		if (mMapping != nullptr)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+#else
+		if (mData != nullptr)
+			munmap((void*)mData, mSize);
+		if (mFile != -1)
+			close(mFile);
+#endif
+	}
+
+	bool Open(const char* aPath)
+	{
+#ifdef _WIN32
+		wchar_t path[MAX_PATH];
+		if (MultiByteToWideChar(CP_UTF8, 0, aPath, -1, path, MAX_PATH) == 0)
+			return false;
+		mFile = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		LARGE_INTEGER size;
+		if (mFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(mFile, &size) || (uint64_t)size.QuadPart > (uint64_t)SIZE_MAX)
+			return false;
+		mSize = (size_t)size.QuadPart;
+		if (mSize == 0)
+			return true;
+		mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mMapping == nullptr)
+			return false;
+		mData = (const char*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		mFile = open(aPath, O_RDONLY);
+		struct stat st;
+		if (mFile == -1 || fstat(mFile, &st) != 0)
+			return false;
+		mSize = (size_t)st.st_size;
+		if (mSize == 0)
+			return true;
+		auto data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+		mData = data != MAP_FAILED ? (const char*)data : nullptr;
+#endif
+		return mData != nullptr;
+	}
+
+	const char* mData;
+	size_t mSize;
+
+private:
+#ifdef _WIN32
+	HANDLE mFile;
+	HANDLE mMapping;
+#else
+	int mFile;
+#endif
+};
+
+static inline int CountTrailingZeros(unsigned aValue)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, aValue);
+	return (int)index;
+#else
+	return __builtin_ctz(aValue);
+#endif
+}
+
+// Appends the offset of every '\n' in [aBegin, aEnd), 16 bytes per compare where SSE2 is available
+static void FindNewlines(const char* aBegin, const char* aEnd, uint64_t aBase, std::vector<uint64_t>& aOut)
+{
+	auto p = aBegin;
+#ifdef TEXTEDITOR_SSE2
+	const __m128i newline = _mm_set1_epi8('\n');
+	for (; aEnd - p >= 16; p += 16)
+	{
+		auto mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), newline));
+		for (; mask != 0; mask &= mask - 1)
+			aOut.push_back(aBase + (p - aBegin) + CountTrailingZeros(mask));
+	}
+#endif
+	for (; p != aEnd; ++p)
+		if (*p == '\n')
+			aOut.push_back(aBase + (p - aBegin));
+}
+
+bool TextEditor::Lines::Map(const char* aPath, const TextEditor* aColorizer)
+{
+	auto file = std::make_shared<MappedFile>();
+	if (!file->Open(aPath))
+		return false;
+
+	// Scan slices of the file for newlines on as many threads as are useful, then concatenate the slices in order
+	static const size_t cMinBytesPerThread = 4 << 20;
+	auto threadCount = (int)std::max<size_t>(1, std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), file->mSize / cMinBytesPerThread));
+	auto sliceSize = file->mSize / threadCount;
+	std::vector<std::vector<uint64_t>> slices(threadCount);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; ++i)
+	{
+		auto begin = i * sliceSize;
+		auto end = i + 1 == threadCount ? file->mSize : begin + sliceSize;
+		auto scan = [&file, &slices, i, begin, end]() { FindNewlines(file->mData + begin, file->mData + end, begin, slices[i]); };
+		if (i + 1 == threadCount)
+			scan();
+		else
+			threads.emplace_back(scan);
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	clear();
+	size_t newlineCount = 0;
+	for (auto& slice : slices)
+		newlineCount += slice.size();
+	mNewlines.reserve(newlineCount);
+	for (auto& slice : slices)
+		mNewlines.insert(mNewlines.end(), slice.begin(), slice.end());
+
+	mFile = std::move(file);
+	mColorizer = aColorizer;
+	mSize = mNewlines.size() + 1;
+	auto chunkCount = (mSize + cChunkLines - 1) / cChunkLines;
+	mChunks.resize(chunkCount);
+	mChunkStarts.resize(chunkCount);
+	for (size_t i = 0; i < chunkCount; ++i)
+		mChunkStarts[i] = (int)(i * cChunkLines);
+	mChunkStartStates.assign(chunkCount, LexerState::Default);
+	return true;
+}
+
+void TextEditor::Lines::Load(int aChunk) const
+{
+	assert(IsMapped());
+
+	auto& lines = mChunks[aChunk];
+	auto first = (size_t)aChunk * cChunkLines;
+	lines.resize(std::min((size_t)cChunkLines, mSize - first));
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+		size_t size;
+		auto text = GetMappedLine((int)(first + i), size);
+		auto& line = lines[i];
+		line.reserve(size);
+		for (auto p = text; p != text + size; ++p)
+			line.push_back(Glyph(*p, PaletteIndex::Default));
+		Touch(line);
+	}
+	mLoadedChunks.push_back(aChunk);
+
+	// The state at the end of the chunk above is only known if it is loaded, a wrong guess is fixed up when it loads
+	if (mColorizer != nullptr)
+		ColorizeChunks(aChunk, aChunk > 0 && !mChunks[aChunk - 1].empty() ? mChunks[aChunk - 1].back().mEndState : LexerState::Default);
+}
+
+void TextEditor::Lines::ColorizeChunks(int aChunk, LexerState aState) const
+{
+	// Re-colorize loaded chunks below in place for as long as they were colorized from a different start state
+	for (auto chunk = aChunk; chunk < (int)mChunks.size() && !mChunks[chunk].empty(); ++chunk)
+	{
+		if (chunk != aChunk && mChunkStartStates[chunk] == aState)
+			break;
+		mChunkStartStates[chunk] = aState;
+		for (auto& line : mChunks[chunk])
+		{
+			aState = mColorizer->ColorizeGlyphs(line.data(), line.size(), aState, mColorizeBuffer);
+			line.mEndState = aState;
+			Touch(line);
+		}
+	}
+}
+
+void TextEditor::Lines::Trim(int aFirstLine, int aLastLine)
+{
+	if (!IsMapped() || mLoadedChunks.size() <= cMaxLoadedChunks)
+		return;
+
+	auto firstKept = aFirstLine / cChunkLines;
+	auto lastKept = aLastLine / cChunkLines;
+	auto excess = mLoadedChunks.size() - cMaxLoadedChunks;
+	std::vector<int> loaded;
+	for (auto chunk : mLoadedChunks)
+	{
+		if (excess > 0 && (chunk < firstKept || chunk > lastKept))
+		{
+			std::vector<Line>().swap(mChunks[chunk]);
+			--excess;
+		}
+		else
+			loaded.push_back(chunk);
+	}
+	mLoadedChunks.swap(loaded);
+}
+
+const char* TextEditor::Lines::GetMappedText(size_t& aSize) const
+{
+	assert(IsMapped());
+	aSize = mFile->mSize;
+	return mFile->mData;
+}
+
+std::shared_ptr<const char> TextEditor::Lines::ShareMappedText(size_t& aSize) const
+{
+	assert(IsMapped());
+	aSize = mFile->mSize;
+	return std::shared_ptr<const char>(mFile, mFile->mData);
+}
+
+const char* TextEditor::Lines::GetMappedLine(int aIndex, size_t& aSize) const
+{
+	assert(IsMapped());
+	auto begin = aIndex == 0 ? 0 : mNewlines[aIndex - 1] + 1;
+	auto end = aIndex < (int)mNewlines.size() ? mNewlines[aIndex] : mFile->mSize;
+	aSize = (size_t)(end - begin);
+	return mFile->mData + begin;
+}
+
+void TextEditor::Lines::Unload()
+{
+	for (auto chunk : mLoadedChunks)
+		std::vector<Line>().swap(mChunks[chunk]);
+	mLoadedChunks.clear();
+}
+
 void TextEditor::RemoveLine(int aStart, int aEnd)
 {
 	assert(!mReadOnly);
@@ -312,7 +1017,7 @@ void TextEditor::RemoveLine(int aStart, int aEnd)
 	}
 	mBreakpoints = std::move(btmp);
 
-	mLines.erase(mLines.begin() + aStart, mLines.begin() + aEnd);
+	mLines.erase(aStart, aEnd);
 }
 
 void TextEditor::RemoveLine(int aIndex)
@@ -338,14 +1043,14 @@ void TextEditor::RemoveLine(int aIndex)
 	}
 	mBreakpoints = std::move(btmp);
 
-	mLines.erase(mLines.begin() + aIndex);
+	mLines.erase(aIndex, aIndex + 1);
 }
 
 TextEditor::Line& TextEditor::InsertLine(int aIndex)
 {
 	assert(!mReadOnly);
 
-	auto& result = *mLines.insert(mLines.begin() + aIndex, Line());
+	auto& result = mLines.insert(aIndex, Line());
 
 	ErrorMarkers etmp;
 	for (auto& i : mErrorMarkers)
@@ -360,6 +1065,24 @@ TextEditor::Line& TextEditor::InsertLine(int aIndex)
 	return result;
 }
 
+void TextEditor::InsertLines(int aIndex, std::vector<Line>&& aLines)
+{
+	assert(!mReadOnly);
+
+	auto count = (int)aLines.size();
+	mLines.insert(aIndex, std::move(aLines));
+
+	ErrorMarkers etmp;
+	for (auto& i : mErrorMarkers)
+		etmp.insert(ErrorMarkers::value_type(i.first >= aIndex ? i.first + count : i.first, i.second));
+	mErrorMarkers = std::move(etmp);
+
+	Breakpoints btmp;
+	for (auto i : mBreakpoints)
+		btmp.insert(i >= aIndex ? i + count : i);
+	mBreakpoints = std::move(btmp);
+}
+
 std::string TextEditor::GetWordUnderCursor() const
 {
 	auto c = GetCursorPosition();
@@ -383,6 +1106,10 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 {
 	mWithinRender = true;
 
+	// Pick up background colorizer output before any input is processed, edits would make it stale
+	ApplyColorizeResults();
+	AppendPostedText();
+
 	ImGuiIO& io = ImGui::GetIO();
     ::ImGuiContext* c = ImGui::GetCurrentContext();
     auto xadv = (c->Font->IndexAdvanceX['X']);
@@ -395,10 +1122,16 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 	ImGui::BeginChild(aTitle, aSize, aBorder, ImGuiWindowFlags_HorizontalScrollbar | ImGuiWindowFlags_NoMove);
 
 	ImGui::PushAllowKeyboardFocus(true);
+	auto atEnd = ImGui::GetScrollY() >= ImGui::GetScrollMaxY();
+
+	// The text area right of the line numbers, with a column to spare for the cursor
+	if (mWordWrap)
+		SetWrapColumns(std::max(cMinWrapColumns, (int)(ImGui::GetWindowContentRegionWidth() / mCharAdvance.x) - cTextStart - 1));
 
 	auto shift = io.KeyShift;
 	auto ctrl = io.KeyCtrl;
 	auto alt = io.KeyAlt;
+	auto typed = false;
 
 	if (ImGui::IsWindowFocused())
 	{
@@ -418,7 +1151,27 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 		if (!IsReadOnly() && ctrl && !shift && !alt && ImGui::IsKeyPressed('Y'))
 			Redo();
 
-		if (!ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+		// While completions are shown the keys that pick and take one go to them
+		auto completing = !mCompletions.empty() && !ctrl && !shift && !alt;
+		auto completed = false;
+		if (completing && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+			mCompletionIndex = (mCompletionIndex + (int)mCompletions.size() - 1) % (int)mCompletions.size();
+		else if (completing && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+			mCompletionIndex = (mCompletionIndex + 1) % (int)mCompletions.size();
+		else if (completing && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape)))
+			mCompletions.clear();
+		else if (completing && (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Tab)) || ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Enter))))
+		{
+			AcceptCompletion();
+			completed = true;
+		}
+		else if (ctrl && alt && !shift && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
+			AddCursorRow(-1);
+		else if (ctrl && alt && !shift && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
+			AddCursorRow(1);
+		else if (!mState.mCursors.empty() && !ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape)))
+			ClearExtraCursors();
+		else if (!ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)))
 			MoveUp(1, shift);
 		else if (!ctrl && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)))
 			MoveDown(1, shift);
@@ -458,6 +1211,10 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 			Cut();
 		else if (ctrl && !shift && !alt && ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_A)))
 			SelectAll();
+		else if (ctrl && !shift && !alt && ImGui::IsKeyPressed('M'))
+			ToggleFold(mState.mCursorPosition.mLine);
+		else if (ctrl && !alt && ImGui::IsKeyPressed(0xDD))	// VK_OEM_6, the ] key
+			JumpToMatchingBracket(shift);
 
 		if (!IsReadOnly())
 		{
@@ -466,11 +1223,15 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 				auto c = (unsigned char)io.InputCharacters[i];
 				if (c != 0)
 				{
+					// The tab or enter that took a completion also arrives as a character
+					if (completed && (c == '\t' || c == '\r' || c == '\n'))
+						continue;
 					if (isprint(c) || isspace(c))
 					{
 						if (c == '\r')
 							c = '\n';
 						EnterCharacter((char)c);
+						typed = true;
 					}
 				}
 			}
@@ -481,14 +1242,20 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 	{
 		if (!shift && !alt)
 		{
-			if (ImGui::IsMouseClicked(0))
+			// A click on the fold marker left of the text only toggles the fold
+			auto markerX = ImGui::GetMousePos().x - ImGui::GetCursorScreenPos().x - (cTextStart - 1) * mCharAdvance.x;
+			auto foldClicked = ImGui::IsMouseClicked(0) && markerX >= 0.0f && markerX < mCharAdvance.x &&
+				ToggleFold(ScreenPosToCoordinates(ImGui::GetMousePos()).mLine);
+
+			if (ImGui::IsMouseClicked(0) && !foldClicked)
 			{
+				mState.mCursors.clear();
 				mState.mCursorPosition = mInteractiveStart = mInteractiveEnd = SanitizeCoordinates(ScreenPosToCoordinates(ImGui::GetMousePos()));
 				if (ctrl)
 					mWordSelectionMode = true;
 				SetSelection(mInteractiveStart, mInteractiveEnd, mWordSelectionMode);
 			}
-			if (ImGui::IsMouseDoubleClicked(0) && !ctrl)
+			if (ImGui::IsMouseDoubleClicked(0) && !ctrl && !foldClicked)
 			{
 				mState.mCursorPosition = mInteractiveStart = mInteractiveEnd = SanitizeCoordinates(ScreenPosToCoordinates(ImGui::GetMousePos()));
 				mWordSelectionMode = true;
@@ -501,151 +1268,282 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 				SetSelection(mInteractiveStart, mInteractiveEnd, mWordSelectionMode);
 			}
 		}
+		else if (alt && !shift && !ctrl)
+		{
+			// Alt+click adds a cursor, dragging from there selects the columns between the click and the mouse. Columns
+			// are measured from the mouse, so they can go past the end of the line clicked on.
+			if (ImGui::IsMouseClicked(0))
+			{
+				mInteractiveStart = mInteractiveEnd = SanitizeCoordinates(ScreenPosToCoordinates(ImGui::GetMousePos()));
+				AddCursor(mInteractiveStart);
+			}
+			else if (ImGui::IsMouseDragging(0) && ImGui::IsMouseDown(0))
+			{
+				io.WantCaptureMouse = true;
+				auto origin = ImGui::GetCursorScreenPos();
+				auto column = [&](const ImVec2& aPosition) { return std::max(0, (int)floor((aPosition.x - origin.x) / mCharAdvance.x - cTextStart + 0.5f)); };
+				auto start = io.MouseClickedPos[0];
+				auto end = ImGui::GetMousePos();
+				SelectColumns(ScreenPosToCoordinates(start).mLine, column(start), ScreenPosToCoordinates(end).mLine, column(end));
+			}
+		}
 
 		if (!ImGui::IsMouseDown(0))
 			mWordSelectionMode = false;
 	}
 
 	ColorizeInternal();
+	UpdateFindResults();
+	UpdateFolds();
+	UpdateCompletions(typed);
+
+	auto font = ImGui::GetFont();
+	if (font != mRenderFont || ImGui::GetFontSize() != mRenderFontSize)
+	{
+		mRenderFont = font;
+		mRenderFontSize = ImGui::GetFontSize();
+		++mStyleVersion;
+	}
 
-	static std::string buffer;
 	auto contentSize = ImGui::GetWindowContentRegionMax();
 	auto drawList = ImGui::GetWindowDrawList();
-	int appendIndex = 0;
 	int longest = cTextStart;
 
 	ImVec2 cursorScreenPos = ImGui::GetCursorScreenPos();
 	auto scrollX = ImGui::GetScrollX();
 	auto scrollY = ImGui::GetScrollY();
 
-	auto lineNo = (int)floor(scrollY / mCharAdvance.y);
-	auto lineMax = std::max(0, std::min((int)mLines.size() - 1, lineNo + (int)floor((scrollY + contentSize.y) / mCharAdvance.y)));
+	// Screen rows are lines unless wrapping or folding
+	auto rows = HasRowIndex();
+	auto rowMin = (int)floor(scrollY / mCharAdvance.y);
+	auto rowMax = rowMin + (int)floor((scrollY + contentSize.y) / mCharAdvance.y);
+	auto lineNo = rows ? RowToLine(rowMin) : rowMin;
+	auto lineMin = lineNo;
+	auto firstColumn = std::max(0, (int)floor(scrollX / mCharAdvance.x) - cTextStart);
+	auto lastColumn = (int)ceil((scrollX + ImGui::GetWindowWidth()) / mCharAdvance.x) - cTextStart + 1;
+	auto lineMax = std::max(0, std::min((int)mLines.size() - 1, rows ? RowToLine(rowMax) : rowMax));
+
+	// After the wrap width changed, lines are counted again a batch per frame, and the ones in view right away
+	if (mWordWrap && mRowsRecounted < (int)mLines.size())
+	{
+		RecountRows(mRowsRecounted, mRowsRecounted + cMaxRecountLinesPerFrame);
+		mRowsRecounted = std::min((int)mLines.size(), mRowsRecounted + cMaxRecountLinesPerFrame);
+		lineNo = lineMin = RowToLine(rowMin);
+		lineMax = RowToLine(rowMax);
+		for (auto counted = lineNo; counted <= lineMax; lineMax = RowToLine(rowMax))
+		{
+			RecountRows(counted, lineMax + 1);
+			counted = lineMax + 1;
+		}
+	}
+
+	// Every cursor blinks at once
+	static auto blinkStart = std::chrono::system_clock::now();
+	auto blinkNow = std::chrono::system_clock::now();
+	auto blinkElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(blinkNow - blinkStart).count();
+	auto cursorShown = ImGui::IsWindowFocused() && blinkElapsed > 400;
+	if (blinkElapsed > 800)
+		blinkStart = blinkNow;
+
+	// The bracket at the cursor and its match are outlined
+	Coordinates brackets[2];
+	auto bracketsShown = FindMatchingBracket(GetActualCursorCoordinates(), brackets[0], brackets[1]);
+
+	// Selections and cursors on the line being drawn, as distances from its start
+	std::vector<std::pair<int, int>> lineSelections;
+	std::vector<int> lineCursors;
 	if (!mLines.empty())
 	{
 		while (lineNo <= lineMax)
 		{
-			ImVec2 lineStartScreenPos = ImVec2(cursorScreenPos.x, cursorScreenPos.y + lineNo * mCharAdvance.y);
-			ImVec2 textScreenPos = ImVec2(lineStartScreenPos.x + mCharAdvance.x * cTextStart, lineStartScreenPos.y);
-
 			auto& line = mLines[lineNo];
-			longest = std::max(cTextStart + TextDistanceToLineStart(Coordinates(lineNo, (int) line.size())), longest);
-			auto columnNo = 0;
+			auto wrap = mWordWrap ? &GetLineWrap(lineNo) : nullptr;
+			auto lineRow = rows ? LineToRow(lineNo) : lineNo;
+			auto rowCount = wrap != nullptr ? (int)wrap->mGlyphs.size() : 1;
+			auto firstRow = std::min(rowCount - 1, std::max(0, rowMin - lineRow));
+			auto lastRow = std::max(firstRow, std::min(rowCount - 1, rowMax - lineRow));
+			auto& cache = wrap != nullptr ?
+				GetRenderCache(lineNo, line, wrap->mDistances[firstRow], wrap->mDistances[lastRow] + mWrapColumns + mTabSize) :
+				GetRenderCache(lineNo, line, firstColumn, lastColumn);
+			longest = std::max(cTextStart + cache.mWidth, longest);
 			Coordinates lineStartCoord(lineNo, 0);
 			Coordinates lineEndCoord(lineNo, (int)line.size());
 
-			int sstart = -1;
-			int ssend = -1;
-
 			assert(mState.mSelectionStart <= mState.mSelectionEnd);
-			if (mState.mSelectionStart <= lineEndCoord)
-				sstart = mState.mSelectionStart > lineStartCoord ? TextDistanceToLineStart(mState.mSelectionStart) : 0;
-			if (mState.mSelectionEnd > lineStartCoord)
-				ssend = TextDistanceToLineStart(mState.mSelectionEnd < lineEndCoord ? mState.mSelectionEnd : lineEndCoord);
-
-			if (mState.mSelectionEnd.mLine > lineNo)
-				++ssend;
-
-			if (sstart != -1 && ssend != -1 && sstart < ssend)
+			lineSelections.clear();
+			lineCursors.clear();
+			auto addCursor = [&](const Cursor& aCursor)
 			{
-				ImVec2 vstart(lineStartScreenPos.x + (mCharAdvance.x) * (sstart + cTextStart), lineStartScreenPos.y);
-				ImVec2 vend(lineStartScreenPos.x + (mCharAdvance.x) * (ssend + cTextStart), lineStartScreenPos.y + mCharAdvance.y);
-				drawList->AddRectFilled(vstart, vend, mPalette[(int)PaletteIndex::Selection]);
-			}
+				if (aCursor.mCursorPosition.mLine == lineNo)
+					lineCursors.push_back(TextDistanceToLineStart(aCursor.mCursorPosition));
+				if (aCursor.mSelectionStart < aCursor.mSelectionEnd && aCursor.mSelectionStart <= lineEndCoord && aCursor.mSelectionEnd > lineStartCoord)
+				{
+					auto sstart = aCursor.mSelectionStart > lineStartCoord ? TextDistanceToLineStart(aCursor.mSelectionStart) : 0;
+					auto ssend = TextDistanceToLineStart(aCursor.mSelectionEnd < lineEndCoord ? aCursor.mSelectionEnd : lineEndCoord);
+					if (aCursor.mSelectionEnd.mLine > lineNo)
+						++ssend;
+					lineSelections.push_back(std::make_pair(sstart, ssend));
+				}
+			};
+
+			// The other cursors are ordered and do not overlap, the ones on this line are found by their ends
+			addCursor(mState);
+			auto other = std::lower_bound(mState.mCursors.begin(), mState.mCursors.end(), lineStartCoord,
+				[](const Cursor& aCursor, const Coordinates& aCoord) { return aCursor.mSelectionEnd < aCoord; });
+			for (; other != mState.mCursors.end() && other->mSelectionStart <= lineEndCoord; ++other)
+				addCursor(*other);
+
+			// FindAll matches on this line, mFindResults is in document order
+			auto foundBegin = std::lower_bound(mFindResults.begin(), mFindResults.end(), lineStartCoord,
+				[](const FindResult& aResult, const Coordinates& aCoord) { return aResult.mStart < aCoord; });
+			auto foundEnd = foundBegin;
+			while (foundEnd != mFindResults.end() && foundEnd->mStart.mLine == lineNo)
+				++foundEnd;
+
+			auto cursorLine = mState.mCursorPosition.mLine == lineNo;
+			auto foldable = mFolds.Find(lineNo) >= 0;
+			auto folded = foldable && IsFolded(lineNo);
+
+			for (int row = firstRow; row <= lastRow; ++row)
+			{
+				// A row of a wrapped line is drawn as the whole line moved left by where the row starts, clipped to the row
+				auto rowStart = wrap != nullptr ? wrap->mDistances[row] : 0;
+				auto rowEnd = wrap != nullptr && row + 1 < rowCount ? wrap->mDistances[row + 1] : std::numeric_limits<int>::max();
+				ImVec2 lineStartScreenPos = ImVec2(cursorScreenPos.x - mCharAdvance.x * rowStart, cursorScreenPos.y + (lineRow + row) * mCharAdvance.y);
 
-			static char buf[16];
-			auto start = ImVec2(lineStartScreenPos.x + scrollX, lineStartScreenPos.y);
+				for (auto& selection : lineSelections)
+				{
+					auto selectionStart = std::max(selection.first, rowStart);
+					auto selectionEnd = std::min(selection.second, rowEnd);
+					if (selectionStart < selectionEnd)
+					{
+						ImVec2 vstart(lineStartScreenPos.x + (mCharAdvance.x) * (selectionStart + cTextStart), lineStartScreenPos.y);
+						ImVec2 vend(lineStartScreenPos.x + (mCharAdvance.x) * (selectionEnd + cTextStart), lineStartScreenPos.y + mCharAdvance.y);
+						drawList->AddRectFilled(vstart, vend, mPalette[(int)PaletteIndex::Selection]);
+					}
+				}
 
-			if (mBreakpoints.find(lineNo + 1) != mBreakpoints.end())
-			{
-				auto end = ImVec2(lineStartScreenPos.x + contentSize.x + 2.0f * scrollX, lineStartScreenPos.y + mCharAdvance.y);
-				drawList->AddRectFilled(start, end, mPalette[(int)PaletteIndex::Breakpoint]);
-			}
+				for (auto found = foundBegin; found != foundEnd; ++found)
+				{
+					auto fstart = std::max(rowStart, TextDistanceToLineStart(found->mStart));
+					auto fend = std::min(rowEnd, TextDistanceToLineStart(found->mEnd));
+					if (fstart < fend)
+					{
+						ImVec2 vstart(lineStartScreenPos.x + mCharAdvance.x * (fstart + cTextStart), lineStartScreenPos.y);
+						ImVec2 vend(lineStartScreenPos.x + mCharAdvance.x * (fend + cTextStart), lineStartScreenPos.y + mCharAdvance.y);
+						drawList->AddRectFilled(vstart, vend, mPalette[(int)PaletteIndex::FindHighlight]);
+					}
+				}
 
-			auto errorIt = mErrorMarkers.find(lineNo + 1);
-			if (errorIt != mErrorMarkers.end())
-			{
-				auto end = ImVec2(lineStartScreenPos.x + contentSize.x + 2.0f * scrollX, lineStartScreenPos.y + mCharAdvance.y);
-				drawList->AddRectFilled(start, end, mPalette[(int)PaletteIndex::ErrorMarker]);
+				for (int i = 0; bracketsShown && i < 2; ++i)
+				{
+					auto bx = brackets[i].mLine == lineNo ? TextDistanceToLineStart(brackets[i]) : -1;
+					if (bx >= rowStart && bx < rowEnd)
+					{
+						ImVec2 bstart(lineStartScreenPos.x + mCharAdvance.x * (bx + cTextStart), lineStartScreenPos.y);
+						ImVec2 bend(bstart.x + mCharAdvance.x, bstart.y + mCharAdvance.y);
+						drawList->AddRect(bstart, bend, mPalette[(int)PaletteIndex::MatchingBracket]);
+					}
+				}
+
+				auto rowScreenPos = ImVec2(cursorScreenPos.x, lineStartScreenPos.y);
+				auto start = ImVec2(rowScreenPos.x + scrollX, rowScreenPos.y);
 
-				if (ImGui::IsMouseHoveringRect(lineStartScreenPos, end))
+				if (mBreakpoints.find(lineNo + 1) != mBreakpoints.end())
 				{
-					ImGui::BeginTooltip();
-					ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.2f, 0.2f, 1.0f));
-					ImGui::Text("Error at line %d:", errorIt->first);
-					ImGui::PopStyleColor();
-					ImGui::Separator();
-					ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 1.0f, 0.2f, 1.0f));
-					ImGui::Text("%s", errorIt->second.c_str());
-					ImGui::PopStyleColor();
-					ImGui::EndTooltip();
+					auto end = ImVec2(rowScreenPos.x + contentSize.x + 2.0f * scrollX, rowScreenPos.y + mCharAdvance.y);
+					drawList->AddRectFilled(start, end, mPalette[(int)PaletteIndex::Breakpoint]);
 				}
-			}
 
-			snprintf(buf, 16, "%6d", lineNo + 1);
-			drawList->AddText(ImVec2(lineStartScreenPos.x /*+ mCharAdvance.x * 1*/, lineStartScreenPos.y), mPalette[(int)PaletteIndex::LineNumber], buf);
+				auto errorIt = mErrorMarkers.find(lineNo + 1);
+				if (errorIt != mErrorMarkers.end())
+				{
+					auto end = ImVec2(rowScreenPos.x + contentSize.x + 2.0f * scrollX, rowScreenPos.y + mCharAdvance.y);
+					drawList->AddRectFilled(start, end, mPalette[(int)PaletteIndex::ErrorMarker]);
 
-			if (mState.mCursorPosition.mLine == lineNo)
-			{
-				auto focused = ImGui::IsWindowFocused();
+					if (ImGui::IsMouseHoveringRect(rowScreenPos, end))
+					{
+						ImGui::BeginTooltip();
+						ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.2f, 0.2f, 1.0f));
+						ImGui::Text("Error at line %d:", errorIt->first);
+						ImGui::PopStyleColor();
+						ImGui::Separator();
+						ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 1.0f, 0.2f, 1.0f));
+						ImGui::Text("%s", errorIt->second.c_str());
+						ImGui::PopStyleColor();
+						ImGui::EndTooltip();
+					}
+				}
 
-				if (!HasSelection())
+				if (cursorLine && !HasSelection())
 				{
 					auto end = ImVec2(start.x + contentSize.x + scrollX, start.y + mCharAdvance.y);
-					drawList->AddRectFilled(start, end, mPalette[(int)(focused ? PaletteIndex::CurrentLineFill : PaletteIndex::CurrentLineFillInactive)]);
+					drawList->AddRectFilled(start, end, mPalette[(int)(ImGui::IsWindowFocused() ? PaletteIndex::CurrentLineFill : PaletteIndex::CurrentLineFillInactive)]);
 					drawList->AddRect(start, end, mPalette[(int)PaletteIndex::CurrentLineEdge], 1.0f);
 				}
 
-				int cx = TextDistanceToLineStart(mState.mCursorPosition);
-
-				if (focused)
+				// At a wrap point a cursor shows at the start of the next row
+				for (auto cx : lineCursors)
 				{
-					static auto timeStart = std::chrono::system_clock::now();
-					auto timeEnd = std::chrono::system_clock::now();
-					auto diff = timeEnd - timeStart;
-					auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(diff).count();
-					if (elapsed > 400)
+					if (cursorShown && cx >= rowStart && (cx < rowEnd || row + 1 == rowCount))
 					{
 						ImVec2 cstart(lineStartScreenPos.x + mCharAdvance.x * (cx + cTextStart), lineStartScreenPos.y);
 						ImVec2 cend(lineStartScreenPos.x + mCharAdvance.x * (cx + cTextStart) + (mOverwrite ? mCharAdvance.x : 1.0f), lineStartScreenPos.y + mCharAdvance.y);
 						drawList->AddRectFilled(cstart, cend, mPalette[(int)PaletteIndex::Cursor]);
-						if (elapsed > 800)
-							timeStart = timeEnd;
 					}
 				}
-			}
 
-			appendIndex = 0;
-			auto prevColor = line.empty() ? PaletteIndex::Default : (line[0].mMultiLineComment ? PaletteIndex::MultiLineComment : line[0].mColorIndex);
-
-			for (auto& glyph : line)
-			{
-				auto color = glyph.mMultiLineComment ? PaletteIndex::MultiLineComment : glyph.mColorIndex;
+				// Line number and text, culled to the horizontal extent of the clip rect and to the row. Only the first
+				// row of a line has the line number.
+				auto origin = ImVec2((float)(int)lineStartScreenPos.x, (float)(int)lineStartScreenPos.y);
+				auto& clipRect = drawList->_ClipRectStack.back();
+				auto minX = clipRect.x - origin.x - mCharAdvance.x;
+				auto maxX = clipRect.z - origin.x + mCharAdvance.x;
+				if (row > 0)
+					minX = std::max(minX, mCharAdvance.x * (rowStart + cTextStart - 0.5f));
+				if (rowEnd != std::numeric_limits<int>::max())
+					maxX = std::min(maxX, mCharAdvance.x * (rowEnd + cTextStart - 0.5f));
+				auto first = std::lower_bound(cache.mQuads.begin(), cache.mQuads.end(), minX,
+					[](const RenderQuad& aQuad, float aX) { return aQuad.mCellX < aX; });
+				auto last = std::upper_bound(first, cache.mQuads.end(), maxX,
+					[](float aX, const RenderQuad& aQuad) { return aX < aQuad.mCellX; });
+				if (first != last)
+				{
+					IM_ASSERT(font->ContainerAtlas->TexID == drawList->_TextureIdStack.back());
+					auto count = (int)(last - first);
+					drawList->PrimReserve(count * 6, count * 4);
+					for (auto it = first; it != last; ++it)
+						drawList->PrimRectUV(ImVec2(origin.x + it->mMin.x, origin.y + it->mMin.y), ImVec2(origin.x + it->mMax.x, origin.y + it->mMax.y), it->mUVMin, it->mUVMax, it->mColor);
+				}
 
-				if (color != prevColor && !buffer.empty())
+				// Fold marker between the line number and the text, and an ellipsis after a folded line
+				auto foldColor = mPalette[(int)PaletteIndex::LineNumber];
+				if (foldable && row == 0)
+					drawList->AddText(ImVec2(rowScreenPos.x + (cTextStart - 1) * mCharAdvance.x, rowScreenPos.y), foldColor, folded ? "+" : "-");
+				if (folded && row + 1 == rowCount)
 				{
-					drawList->AddText(textScreenPos, mPalette[(uint8_t)prevColor], buffer.c_str());
-					textScreenPos.x += mCharAdvance.x * buffer.length();
-					buffer.clear();
-					prevColor = color;
+					ImVec2 estart(origin.x + mCharAdvance.x * (cTextStart + cache.mWidth + 1), origin.y);
+					ImVec2 eend(estart.x + mCharAdvance.x * 3, estart.y + mCharAdvance.y);
+					drawList->AddRect(estart, eend, foldColor);
+					drawList->AddText(estart, foldColor, "...");
 				}
-				appendIndex = AppendBuffer(buffer, glyph.mChar, appendIndex);
-				++columnNo;
 			}
 
-			if (!buffer.empty())
-			{
-				drawList->AddText(textScreenPos, mPalette[(uint8_t)prevColor], buffer.c_str());
-				buffer.clear();
-			}
-			appendIndex = 0;
-			lineStartScreenPos.y += mCharAdvance.y;
-			textScreenPos.x = lineStartScreenPos.x + mCharAdvance.x * cTextStart;
-			textScreenPos.y = lineStartScreenPos.y;
-			++lineNo;
+			// Hidden lines are stepped over
+			auto next = rows ? NextVisibleLine(lineNo) : lineNo + 1;
+			if (next == lineNo)
+				break;
+			lineNo = next;
 		}
 
-		auto id = GetWordAt(ScreenPosToCoordinates(ImGui::GetMousePos()));
-		if (!id.empty())
+		// The word under the mouse is looked up every frame, it is copied into a buffer that is kept around
+		auto hovered = ScreenPosToCoordinates(ImGui::GetMousePos());
+		auto wordEnd = FindWordEnd(hovered);
+		mWordBuffer.clear();
+		for (auto it = FindWordStart(hovered); it < wordEnd; Advance(it))
+			mWordBuffer.push_back(mLines[it.mLine][it.mColumn].mChar);
+		const auto& id = mWordBuffer;
+		if (!id.empty() && mCompletions.empty())
 		{
 			auto it = mLanguageDefinition.mIdentifiers.find(id);
 			if (it != mLanguageDefinition.mIdentifiers.end())
@@ -665,10 +1563,31 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 				}
 			}
 		}
+
+		// Completions go below the start of the word, in a window of their own so they do not share a tooltip
+		if (!mCompletions.empty())
+		{
+			int row, distance;
+			GetRowPosition(mCompletionStart, row, distance);
+			ImGui::SetNextWindowPos(ImVec2(cursorScreenPos.x + (cTextStart + distance) * mCharAdvance.x, cursorScreenPos.y + (row + 1) * mCharAdvance.y));
+			ImGui::Begin("##TextEditorCompletions", nullptr, ImGuiWindowFlags_Tooltip | ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoTitleBar |
+				ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoNav);
+			for (int i = 0; i < (int)mCompletions.size(); ++i)
+				ImGui::Selectable(mCompletions[i].c_str(), i == mCompletionIndex);
+			ImGui::End();
+		}
 	}
 
 
-	ImGui::Dummy(ImVec2((longest + 2) * mCharAdvance.x, mLines.size() * mCharAdvance.y));
+	if (mWordWrap)
+		ImGui::Dummy(ImVec2((cTextStart + mWrapColumns + 1) * mCharAdvance.x, GetRowCount() * mCharAdvance.y));
+	else
+		ImGui::Dummy(ImVec2((longest + 2) * mCharAdvance.x, (rows ? GetRowCount() : mLines.size()) * mCharAdvance.y));
+
+	// Text added at the end while the view was at the bottom keeps it there
+	if (mFollowEnd && atEnd)
+		ImGui::SetScrollY(ImGui::GetCursorPosY());
+	mFollowEnd = false;
 
 	if (mScrollToCursor)
 	{
@@ -682,36 +1601,197 @@ void TextEditor::Render(const char* aTitle, const ImVec2& aSize, bool aBorder)
 	ImGui::PopStyleVar();
 	ImGui::PopStyleColor();
 
+	// Nothing holds on to lines past this point, a file view can drop what went out of sight
+	mLines.Trim(lineMin, lineMax);
+
 	mWithinRender = false;
 }
 
 void TextEditor::SetText(const std::string & aText)
 {
 	mLines.clear();
-	for (auto chr : aText)
+	if (!aText.empty())
 	{
-		if (mLines.empty())
-			mLines.push_back(Line());
-		if (chr == '\n')
-			mLines.push_back(Line());
-		else
+		Line line;
+		AppendLines(aText.data(), aText.data() + aText.size(), line);
+		mLines.push_back(std::move(line));
+	}
+
+	mState.mCursors.clear();
+	ClearUndo();
+	ClearFolds();
+
+	Colorize();
+}
+
+void TextEditor::AppendLines(const char* aFirst, const char* aLast, Line& aOpenLine)
+{
+	// Every line is built from its whole run of characters, so a line that does not straddle two calls is allocated
+	// exactly once at its final size. The last line stays open for the next call.
+	for (;;)
+	{
+		auto newline = (const char*)memchr(aFirst, '\n', aLast - aFirst);
+		auto last = newline != nullptr ? newline : aLast;
+		if (aOpenLine.empty())
+			aOpenLine.reserve(last - aFirst);
+		for (auto p = aFirst; p != last; ++p)
+			aOpenLine.push_back(Glyph(*p, PaletteIndex::Default));
+		if (newline == nullptr)
+			return;
+		mLines.push_back(std::move(aOpenLine));
+		aOpenLine = Line();
+		aFirst = newline + 1;
+	}
+}
+
+void TextEditor::ReadText(ReadCallback aRead, void* aUserData)
+{
+	mLines.clear();
+	std::vector<char> buffer(cTextStreamBuffer);
+	Line line;
+	bool empty = true;
+	for (size_t size; (size = aRead(aUserData, buffer.data(), buffer.size())) > 0; empty = false)
+		AppendLines(buffer.data(), buffer.data() + size, line);
+	if (!empty)
+		mLines.push_back(std::move(line));
+
+	mState.mCursors.clear();
+	ClearUndo();
+	ClearFolds();
+
+	Colorize();
+}
+
+bool TextEditor::WriteText(WriteCallback aWrite, void* aUserData) const
+{
+	// A file view cannot have been edited, so it is written straight from the mapping
+	if (mLines.IsMapped())
+	{
+		size_t size = 0;
+		auto text = mLines.GetMappedText(size);
+		return size == 0 || aWrite(aUserData, text, size);
+	}
+
+	std::vector<char> buffer(cTextStreamBuffer);
+	size_t used = 0;
+	auto flush = [&]()
+	{
+		auto ok = used == 0 || aWrite(aUserData, buffer.data(), used);
+		used = 0;
+		return ok;
+	};
+
+	for (size_t i = 0; i < mLines.size(); ++i)
+	{
+		auto& line = mLines[i];
+		for (size_t j = 0; j < line.size();)
+		{
+			auto count = std::min(line.size() - j, buffer.size() - used);
+			for (size_t k = 0; k < count; ++k)
+				buffer[used + k] = line[j + k].mChar;
+			used += count;
+			j += count;
+			if (used == buffer.size() && !flush())
+				return false;
+		}
+
+		if (i + 1 < mLines.size())
 		{
-			mLines.back().push_back(Glyph(chr, PaletteIndex::Default));
+			buffer[used++] = '\n';
+			if (used == buffer.size() && !flush())
+				return false;
 		}
 	}
+	return flush();
+}
 
-	mUndoBuffer.clear();
+// Paths are UTF-8, like everything else ImGui hands out
+static FILE* OpenTextFile(const char* aPath, bool aWrite)
+{
+#ifdef _WIN32
+	wchar_t path[MAX_PATH];
+	if (MultiByteToWideChar(CP_UTF8, 0, aPath, -1, path, MAX_PATH) == 0)
+		return nullptr;
+	FILE* file = nullptr;
+	return _wfopen_s(&file, path, aWrite ? L"wb" : L"rb") == 0 ? file : nullptr;
+#else
+	return fopen(aPath, aWrite ? "wb" : "rb");
+#endif
+}
 
-	Colorize();
+bool TextEditor::LoadFile(const char* aPath)
+{
+	auto file = OpenTextFile(aPath, false);
+	if (file == nullptr)
+		return false;
+
+	ReadText([](void* aFile, char* aBuffer, size_t aSize) { return fread(aBuffer, 1, aSize, (FILE*)aFile); }, file);
+	auto ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
+
+bool TextEditor::SaveFile(const char* aPath) const
+{
+	auto file = OpenTextFile(aPath, true);
+	if (file == nullptr)
+		return false;
+
+	auto ok = WriteText([](void* aFile, const char* aData, size_t aSize) { return fwrite(aData, 1, aSize, (FILE*)aFile) == aSize; }, file);
+	return fclose(file) == 0 && ok;
+}
+
+bool TextEditor::OpenFileView(const char* aPath)
+{
+	if (!mLines.Map(aPath, this))
+		return false;
+
+	ClearUndo();
+	mState = EditorState();
+	mScrollToCursor = true;
+
+	// Mapped lines are colorized as they load, the regular colorizer never looks at them
+	++mTextVersion;
+	mColorRangeMin = std::numeric_limits<int>::max();
+	mColorRangeMax = 0;
+	mColorizedLines = std::numeric_limits<int>::max();
+	mLastLineCount = (int)mLines.size();
+	ClearFolds();
+	ClearSemanticTokens();
+
+	// A search goes on in the file
+	mFindResults.clear();
+	mFindDirtyMin = 0;
+	mFindDirtyMax = mLastLineCount;
+	return true;
 }
 
 void TextEditor::EnterCharacter(Char aChar)
 {
 	assert(!mReadOnly);
 
+	if (!mState.mCursors.empty())
+	{
+		int primary;
+		auto cursors = GetCursors(primary);
+		std::vector<CursorEdit> edits;
+		edits.reserve(cursors.size());
+		for (auto& cursor : cursors)
+		{
+			auto end = cursor.mSelectionEnd;
+			if (mOverwrite && aChar != '\n' && cursor.mSelectionStart == end && !mLines.empty() && end.mColumn < (int)mLines[end.mLine].size())
+				++end.mColumn;
+			edits.push_back(CursorEdit{ cursor.mSelectionStart, end, std::string(1, aChar) });
+		}
+		EditCursors(edits);
+		return;
+	}
+
 	UndoRecord u;
 
 	u.mBefore = mState;
+	bool hadSelection = HasSelection();
+	bool mergeable = aChar != '\n' && !hadSelection;
 
 	if (HasSelection())
 	{
@@ -739,8 +1819,15 @@ void TextEditor::EnterCharacter(Char aChar)
 	else
 	{
 		auto& line = mLines[coord.mLine];
-		if (mOverwrite && (int)line.size() > coord.mColumn)
+		// Typing over a selection replaces just the selection, also in overwrite mode
+		if (mOverwrite && !hadSelection && (int)line.size() > coord.mColumn)
+		{
+			u.mRemoved = line[coord.mColumn].mChar;
+			u.mRemovedStart = coord;
+			u.mRemovedEnd = Coordinates(coord.mLine, coord.mColumn + 1);
+			mergeable = false;
 			line[coord.mColumn] = Glyph(aChar, PaletteIndex::Default);
+		}
 		else
 			line.insert(line.begin() + coord.mColumn, Glyph(aChar, PaletteIndex::Default));
 		mState.mCursorPosition = coord;
@@ -751,7 +1838,7 @@ void TextEditor::EnterCharacter(Char aChar)
 	u.mAddedEnd = GetActualCursorCoordinates();
 	u.mAfter = mState;
 
-	AddUndo(u);
+	AddUndo(u, mergeable);
 
 	Colorize(coord.mLine - 1, 3);
 	EnsureCursorVisible();
@@ -762,6 +1849,14 @@ void TextEditor::SetReadOnly(bool aValue)
 	mReadOnly = aValue;
 }
 
+void TextEditor::SetWordWrap(bool aValue)
+{
+	// The row index is only kept up to date while wrapping or folding, it is counted again when needed again
+	mWordWrap = aValue;
+	mLineRows.clear();
+	EnsureCursorVisible();
+}
+
 void TextEditor::SetCursorPosition(const Coordinates & aPosition)
 {
 	if (mState.mCursorPosition != aPosition)
@@ -837,8 +1932,18 @@ void TextEditor::DeleteSelection()
 
 void TextEditor::MoveUp(int aAmount, bool aSelect)
 {
+	if (ForEachCursor([&]() { MoveUp(aAmount, aSelect); }))
+		return;
+
 	auto oldPos = mState.mCursorPosition;
-	mState.mCursorPosition.mLine = std::max(0, mState.mCursorPosition.mLine - aAmount);
+	if (HasRowIndex())
+	{
+		int row, distance;
+		GetRowPosition(GetActualCursorCoordinates(), row, distance);
+		mState.mCursorPosition = RowPositionToCoordinates(std::max(0, row - aAmount), distance);
+	}
+	else
+		mState.mCursorPosition.mLine = std::max(0, mState.mCursorPosition.mLine - aAmount);
 	if (oldPos != mState.mCursorPosition)
 	{
 		if (aSelect)
@@ -863,9 +1968,19 @@ void TextEditor::MoveUp(int aAmount, bool aSelect)
 
 void TextEditor::MoveDown(int aAmount, bool aSelect)
 {
+	if (ForEachCursor([&]() { MoveDown(aAmount, aSelect); }))
+		return;
+
 	assert(mState.mCursorPosition.mColumn >= 0);
 	auto oldPos = mState.mCursorPosition;
-	mState.mCursorPosition.mLine = std::max(0, std::min((int)mLines.size() - 1, mState.mCursorPosition.mLine + aAmount));
+	if (HasRowIndex())
+	{
+		int row, distance;
+		GetRowPosition(GetActualCursorCoordinates(), row, distance);
+		mState.mCursorPosition = RowPositionToCoordinates(std::min(GetRowCount() - 1, row + aAmount), distance);
+	}
+	else
+		mState.mCursorPosition.mLine = std::max(0, std::min((int)mLines.size() - 1, mState.mCursorPosition.mLine + aAmount));
 
 	if (mState.mCursorPosition != oldPos)
 	{
@@ -891,6 +2006,9 @@ void TextEditor::MoveDown(int aAmount, bool aSelect)
 
 void TextEditor::MoveLeft(int aAmount, bool aSelect, bool aWordMode)
 {
+	if (ForEachCursor([&]() { MoveLeft(aAmount, aSelect, aWordMode); }))
+		return;
+
 	if (mLines.empty())
 		return;
 
@@ -903,7 +2021,7 @@ void TextEditor::MoveLeft(int aAmount, bool aSelect, bool aWordMode)
 		{
 			if (mState.mCursorPosition.mLine > 0)
 			{
-				--mState.mCursorPosition.mLine;
+				mState.mCursorPosition.mLine = PreviousVisibleLine(mState.mCursorPosition.mLine);
 				mState.mCursorPosition.mColumn = (int)mLines[mState.mCursorPosition.mLine].size();
 			}
 		}
@@ -937,6 +2055,9 @@ void TextEditor::MoveLeft(int aAmount, bool aSelect, bool aWordMode)
 
 void TextEditor::MoveRight(int aAmount, bool aSelect, bool aWordMode)
 {
+	if (ForEachCursor([&]() { MoveRight(aAmount, aSelect, aWordMode); }))
+		return;
+
 	auto oldPos = mState.mCursorPosition;
 
 	if (mLines.empty())
@@ -947,7 +2068,7 @@ void TextEditor::MoveRight(int aAmount, bool aSelect, bool aWordMode)
 		auto& line = mLines[mState.mCursorPosition.mLine];
 		if (mState.mCursorPosition.mColumn >= (int)line.size())
 		{
-			mState.mCursorPosition.mLine = std::max(0, std::min((int)mLines.size() - 1, mState.mCursorPosition.mLine + 1));
+			mState.mCursorPosition.mLine = NextVisibleLine(mState.mCursorPosition.mLine);
 			mState.mCursorPosition.mColumn = 0;
 		}
 		else
@@ -979,6 +2100,9 @@ void TextEditor::MoveRight(int aAmount, bool aSelect, bool aWordMode)
 
 void TextEditor::MoveTop(bool aSelect)
 {
+	if (ForEachCursor([&]() { MoveTop(aSelect); }))
+		return;
+
 	auto oldPos = mState.mCursorPosition;
 	SetCursorPosition(Coordinates(0, 0));
 
@@ -997,6 +2121,9 @@ void TextEditor::MoveTop(bool aSelect)
 
 void TextEditor::TextEditor::MoveBottom(bool aSelect)
 {
+	if (ForEachCursor([&]() { MoveBottom(aSelect); }))
+		return;
+
 	auto oldPos = GetCursorPosition();
 	auto newPos = Coordinates((int)mLines.size() - 1, 0);
 	SetCursorPosition(newPos);
@@ -1012,6 +2139,9 @@ void TextEditor::TextEditor::MoveBottom(bool aSelect)
 
 void TextEditor::MoveHome(bool aSelect)
 {
+	if (ForEachCursor([&]() { MoveHome(aSelect); }))
+		return;
+
 	auto oldPos = mState.mCursorPosition;
 	SetCursorPosition(Coordinates(mState.mCursorPosition.mLine, 0));
 
@@ -1037,6 +2167,9 @@ void TextEditor::MoveHome(bool aSelect)
 
 void TextEditor::MoveEnd(bool aSelect)
 {
+	if (ForEachCursor([&]() { MoveEnd(aSelect); }))
+		return;
+
 	auto oldPos = mState.mCursorPosition;
 	SetCursorPosition(Coordinates(mState.mCursorPosition.mLine, (int)mLines[oldPos.mLine].size()));
 
@@ -1067,8 +2200,31 @@ void TextEditor::Delete()
 	if (mLines.empty())
 		return;
 
+	if (!mState.mCursors.empty())
+	{
+		int primary;
+		auto cursors = GetCursors(primary);
+		std::vector<CursorEdit> edits;
+		edits.reserve(cursors.size());
+		for (auto& cursor : cursors)
+		{
+			auto end = SanitizeCoordinates(cursor.mSelectionEnd);
+			if (cursor.mSelectionStart == cursor.mSelectionEnd)
+			{
+				if (end.mColumn < (int)mLines[end.mLine].size())
+					++end.mColumn;
+				else if (end.mLine + 1 < (int)mLines.size())
+					end = Coordinates(end.mLine + 1, 0);
+			}
+			edits.push_back(CursorEdit{ cursor.mSelectionStart, end, std::string() });
+		}
+		EditCursors(edits);
+		return;
+	}
+
 	UndoRecord u;
 	u.mBefore = mState;
+	bool mergeable = false;
 
 	if (HasSelection())
 	{
@@ -1102,6 +2258,7 @@ void TextEditor::Delete()
 			u.mRemoved = line[pos.mColumn].mChar;
 			u.mRemovedStart = u.mRemovedEnd = GetActualCursorCoordinates();
 			u.mRemovedEnd.mColumn++;
+			mergeable = true;
 
 			line.erase(line.begin() + pos.mColumn);
 		}
@@ -1110,7 +2267,7 @@ void TextEditor::Delete()
 	}
 
 	u.mAfter = mState;
-	AddUndo(u);
+	AddUndo(u, mergeable);
 }
 
 void TextEditor::BackSpace()
@@ -1120,9 +2277,31 @@ void TextEditor::BackSpace()
 	if (mLines.empty())
 		return;
 
+	if (!mState.mCursors.empty())
+	{
+		int primary;
+		auto cursors = GetCursors(primary);
+		std::vector<CursorEdit> edits;
+		edits.reserve(cursors.size());
+		for (auto& cursor : cursors)
+		{
+			auto start = SanitizeCoordinates(cursor.mSelectionStart);
+			if (cursor.mSelectionStart == cursor.mSelectionEnd)
+			{
+				if (start.mColumn > 0)
+					--start.mColumn;
+				else if (start.mLine > 0)
+					start = Coordinates(start.mLine - 1, (int)mLines[start.mLine - 1].size());
+			}
+			edits.push_back(CursorEdit{ start, cursor.mSelectionEnd, std::string() });
+		}
+		EditCursors(edits);
+		return;
+	}
 
 	UndoRecord u;
 	u.mBefore = mState;
+	bool mergeable = false;
 
 	if (HasSelection())
 	{
@@ -1142,13 +2321,14 @@ void TextEditor::BackSpace()
 			if (mState.mCursorPosition.mLine == 0)
 				return;
 
-			u.mRemoved = '\n';
-			u.mRemovedStart = u.mRemovedEnd = GetActualCursorCoordinates();
-			Advance(u.mRemovedEnd);
-
 			auto& line = mLines[mState.mCursorPosition.mLine];
 			auto& prevLine = mLines[mState.mCursorPosition.mLine - 1];
 			auto prevSize = (int)prevLine.size();
+
+			// The newline removed is the one at the end of the previous line
+			u.mRemoved = '\n';
+			u.mRemovedStart = Coordinates(mState.mCursorPosition.mLine - 1, prevSize);
+			u.mRemovedEnd = Coordinates(mState.mCursorPosition.mLine, 0);
 			prevLine.insert(prevLine.end(), line.begin(), line.end());
 			RemoveLine(mState.mCursorPosition.mLine);
 			--mState.mCursorPosition.mLine;
@@ -1161,17 +2341,18 @@ void TextEditor::BackSpace()
 			u.mRemoved = line[pos.mColumn - 1].mChar;
 			u.mRemovedStart = u.mRemovedEnd = GetActualCursorCoordinates();
 			--u.mRemovedStart.mColumn;
+			mergeable = true;
 
 			--mState.mCursorPosition.mColumn;
 			if (mState.mCursorPosition.mColumn < (int)line.size())
 				line.erase(line.begin() + mState.mCursorPosition.mColumn);
 		}
-		EnsureCursorVisible();
 		Colorize(mState.mCursorPosition.mLine, 1);
+		EnsureCursorVisible();
 	}
 
 	u.mAfter = mState;
-	AddUndo(u);
+	AddUndo(u, mergeable);
 }
 
 void TextEditor::SelectWordUnderCursor()
@@ -1182,6 +2363,7 @@ void TextEditor::SelectWordUnderCursor()
 
 void TextEditor::SelectAll()
 {
+	mState.mCursors.clear();
 	SetSelection(Coordinates(0, 0), Coordinates((int)mLines.size(), 0));
 }
 
@@ -1190,9 +2372,292 @@ bool TextEditor::HasSelection() const
 	return mState.mSelectionEnd > mState.mSelectionStart;
 }
 
+void TextEditor::AddCursor(const Coordinates& aPosition)
+{
+	if (mLines.empty())
+		return;
+	int primary;
+	auto cursors = GetCursors(primary);
+	auto position = SanitizeCoordinates(aPosition);
+	cursors.push_back(Cursor{ position, position, position });
+	SetCursors(cursors, (int)cursors.size() - 1);
+}
+
+void TextEditor::SetColumnSelection(const Coordinates& aStart, const Coordinates& aEnd)
+{
+	if (mLines.empty())
+		return;
+	auto start = SanitizeCoordinates(aStart);
+	auto end = SanitizeCoordinates(aEnd);
+	SelectColumns(start.mLine, TextDistanceToLineStart(start), end.mLine, TextDistanceToLineStart(end));
+}
+
+void TextEditor::ClearExtraCursors()
+{
+	mState.mCursors.clear();
+}
+
+std::vector<TextEditor::Cursor> TextEditor::GetCursors(int& aPrimary) const
+{
+	// A cursor without a selection has an empty one where it is, the others are kept that way
+	Cursor first = mState;
+	if (!(first.mSelectionStart < first.mSelectionEnd))
+		first.mSelectionStart = first.mSelectionEnd = first.mCursorPosition;
+
+	auto cursors = mState.mCursors;
+	auto primary = std::lower_bound(cursors.begin(), cursors.end(), first.mSelectionStart,
+		[](const Cursor& aCursor, const Coordinates& aPosition) { return aCursor.mSelectionStart < aPosition; });
+	aPrimary = (int)(primary - cursors.begin());
+	cursors.insert(primary, first);
+	return cursors;
+}
+
+void TextEditor::SetCursors(std::vector<Cursor>& aCursors, int aPrimary)
+{
+	for (auto& cursor : aCursors)
+	{
+		cursor.mCursorPosition = SanitizeCoordinates(cursor.mCursorPosition);
+		cursor.mSelectionStart = SanitizeCoordinates(cursor.mSelectionStart);
+		cursor.mSelectionEnd = SanitizeCoordinates(cursor.mSelectionEnd);
+		if (!(cursor.mSelectionStart < cursor.mSelectionEnd))
+			cursor.mSelectionStart = cursor.mSelectionEnd = cursor.mCursorPosition;
+	}
+
+	std::vector<int> order(aCursors.size());
+	for (int i = 0; i < (int)order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return aCursors[a].mSelectionStart < aCursors[b].mSelectionStart; });
+
+	// Cursors that overlap, or meet where one of them selects nothing or both are, become one. The cursor stays at the end of the
+	// selection it was at, the primary cursor's place is kept over the others'.
+	std::vector<Cursor> merged;
+	int primary = 0;
+	bool mergedPrimary = false;
+	for (auto i : order)
+	{
+		auto& cursor = aCursors[i];
+		auto& last = merged.empty() ? cursor : merged.back();
+		auto empty = cursor.mSelectionStart == cursor.mSelectionEnd || last.mSelectionStart == last.mSelectionEnd;
+		if (merged.empty() || cursor.mSelectionStart > last.mSelectionEnd ||
+			(cursor.mSelectionStart == last.mSelectionEnd && !empty && cursor.mCursorPosition != last.mCursorPosition))
+		{
+			merged.push_back(cursor);
+			mergedPrimary = i == aPrimary;
+			if (mergedPrimary)
+				primary = (int)merged.size() - 1;
+			continue;
+		}
+
+		auto atStart = cursor.mCursorPosition == cursor.mSelectionStart && cursor.mSelectionStart < cursor.mSelectionEnd;
+		if (mergedPrimary)
+			atStart = last.mCursorPosition == last.mSelectionStart && last.mSelectionStart < last.mSelectionEnd;
+		last.mSelectionEnd = std::max(last.mSelectionEnd, cursor.mSelectionEnd);
+		last.mCursorPosition = atStart ? last.mSelectionStart : last.mSelectionEnd;
+		if (i == aPrimary)
+		{
+			primary = (int)merged.size() - 1;
+			mergedPrimary = true;
+		}
+
+		// Moving to the start of the selection can land on the cursor before it
+		while (merged.size() > 1 && merged.back().mCursorPosition == merged[merged.size() - 2].mCursorPosition)
+		{
+			auto& previous = merged[merged.size() - 2];
+			previous.mSelectionEnd = merged.back().mSelectionEnd;
+			previous.mCursorPosition = previous.mSelectionEnd;
+			if (primary == (int)merged.size() - 1)
+				primary = (int)merged.size() - 2;
+			merged.pop_back();
+		}
+	}
+
+	mState.mCursors.clear();
+	for (int i = 0; i < (int)merged.size(); ++i)
+	{
+		if (i == primary)
+			static_cast<Cursor&>(mState) = merged[i];
+		else
+			mState.mCursors.push_back(merged[i]);
+	}
+}
+
+// Runs a single cursor action at every cursor in turn, the first cursor last so it is the one scrolled to. Returns
+// false without running it if there is only the one cursor.
+bool TextEditor::ForEachCursor(const std::function<void()>& aAction)
+{
+	if (mState.mCursors.empty())
+		return false;
+
+	int primary;
+	auto cursors = GetCursors(primary);
+	mState.mCursors.clear();
+	auto run = [&](Cursor& aCursor)
+	{
+		static_cast<Cursor&>(mState) = aCursor;
+		mInteractiveStart = aCursor.mSelectionStart;
+		mInteractiveEnd = aCursor.mSelectionEnd;
+		aAction();
+		aCursor = mState;
+	};
+	for (int i = 0; i < (int)cursors.size(); ++i)
+	{
+		if (i != primary)
+			run(cursors[i]);
+	}
+	run(cursors[primary]);
+
+	auto interactiveStart = mInteractiveStart;
+	auto interactiveEnd = mInteractiveEnd;
+	SetCursors(cursors, primary);
+	mInteractiveStart = interactiveStart;
+	mInteractiveEnd = interactiveEnd;
+	return true;
+}
+
+// Makes one edit per cursor, in the order of GetCursors, as a single change: back to front, so none moves the text
+// of the ones still to be made, then one colorize over the lines from the first to the last and one undo record.
+// Every cursor ends up after its text.
+void TextEditor::EditCursors(std::vector<CursorEdit>& aEdits)
+{
+	assert(!mReadOnly);
+
+	int primary;
+	auto cursors = GetCursors(primary);
+	assert(aEdits.size() == cursors.size());
+
+	// Edits may not overlap: where a selection and the character next to another cursor meet, the selection wins
+	for (size_t i = 0; i < aEdits.size(); ++i)
+	{
+		auto& edit = aEdits[i];
+		edit.mStart = SanitizeCoordinates(edit.mStart);
+		edit.mEnd = SanitizeCoordinates(edit.mEnd);
+		if (i > 0 && edit.mStart < aEdits[i - 1].mEnd)
+			edit.mStart = aEdits[i - 1].mEnd;
+		if (edit.mEnd < edit.mStart)
+			edit.mEnd = edit.mStart;
+	}
+
+	UndoRecord u;
+	u.mBefore = mState;
+	std::vector<UndoEdit> done;
+	std::vector<Coordinates> ends(aEdits.size());
+	for (int i = (int)aEdits.size() - 1; i >= 0; --i)
+	{
+		auto& edit = aEdits[i];
+		ends[i] = edit.mStart;
+		if (edit.mStart == edit.mEnd && edit.mText.empty())
+			continue;
+
+		UndoEdit undo;
+		undo.mRemoved = GetText(edit.mStart, edit.mEnd);
+		undo.mRemovedStart = edit.mStart;
+		undo.mRemovedEnd = edit.mEnd;
+		DeleteRange(edit.mStart, edit.mEnd);
+
+		undo.mAdded = std::move(edit.mText);
+		undo.mAddedStart = edit.mStart;
+		InsertTextAt(ends[i], undo.mAdded.c_str());
+		undo.mAddedEnd = ends[i];
+		done.push_back(std::move(undo));
+	}
+	if (done.empty())
+		return;
+
+	// Each end is where it was once the edits behind it were made, the ones ahead of it move it along: by columns if
+	// it is on the line the previous edit ended on, otherwise by lines
+	for (size_t i = 1; i < aEdits.size(); ++i)
+	{
+		auto& previousEnd = aEdits[i - 1].mEnd;
+		auto& moved = ends[i - 1];
+		if (ends[i].mLine == previousEnd.mLine)
+			ends[i] = Coordinates(moved.mLine, moved.mColumn + ends[i].mColumn - previousEnd.mColumn);
+		else
+			ends[i].mLine += moved.mLine - previousEnd.mLine;
+	}
+
+	std::reverse(done.begin(), done.end());
+	static_cast<UndoEdit&>(u) = std::move(done.front());
+	u.mMoreEdits.assign(std::make_move_iterator(done.begin() + 1), std::make_move_iterator(done.end()));
+
+	for (size_t i = 0; i < cursors.size(); ++i)
+		cursors[i].mSelectionStart = cursors[i].mSelectionEnd = cursors[i].mCursorPosition = ends[i];
+	SetCursors(cursors, primary);
+
+	auto firstLine = aEdits.front().mStart.mLine;
+	Colorize(firstLine - 1, ends.back().mLine - firstLine + 2);
+
+	u.mAfter = mState;
+	AddUndo(u);
+	EnsureCursorVisible();
+}
+
+// A cursor on every visible line from aStartLine to aEndLine, selecting from aStartDistance to aEndDistance (tabs
+// expanded) where the line is long enough and placed at aEndDistance. The one on aEndLine is the first cursor.
+void TextEditor::SelectColumns(int aStartLine, int aStartDistance, int aEndLine, int aEndDistance)
+{
+	if (mLines.empty())
+		return;
+
+	aStartLine = std::max(0, std::min((int)mLines.size() - 1, aStartLine));
+	aEndLine = std::max(0, std::min((int)mLines.size() - 1, aEndLine));
+	std::vector<Cursor> cursors;
+	int primary = -1;
+	for (int line = std::min(aStartLine, aEndLine); line <= std::max(aStartLine, aEndLine); ++line)
+	{
+		if (IsLineHidden(line))
+			continue;
+		Coordinates start(line, GlyphIndexAtDistance(line, aStartDistance));
+		Coordinates end(line, GlyphIndexAtDistance(line, aEndDistance));
+		if (line == aEndLine)
+			primary = (int)cursors.size();
+		cursors.push_back(Cursor{ std::min(start, end), std::max(start, end), end });
+	}
+	if (cursors.empty())
+		return;
+
+	SetCursors(cursors, primary < 0 ? (int)cursors.size() - 1 : primary);
+	EnsureCursorVisible();
+}
+
+// Adds a cursor on the row above the first cursor, or below the last one
+void TextEditor::AddCursorRow(int aDirection)
+{
+	if (mLines.empty())
+		return;
+
+	int primary;
+	auto cursors = GetCursors(primary);
+	int row, distance;
+	GetRowPosition(SanitizeCoordinates(aDirection < 0 ? cursors.front().mCursorPosition : cursors.back().mCursorPosition), row, distance);
+	row += aDirection;
+	if (row < 0 || row >= (HasRowIndex() ? GetRowCount() : (int)mLines.size()))
+		return;
+
+	auto position = RowPositionToCoordinates(row, distance);
+	cursors.push_back(Cursor{ position, position, position });
+	SetCursors(cursors, (int)cursors.size() - 1);
+	EnsureCursorVisible();
+}
+
 void TextEditor::Copy()
 {
-	if (HasSelection())
+	if (!mState.mCursors.empty())
+	{
+		// One line per cursor: its selection, or its whole line if no cursor selects anything
+		int primary;
+		auto cursors = GetCursors(primary);
+		auto selecting = std::any_of(cursors.begin(), cursors.end(), [](const Cursor& aCursor) { return aCursor.mSelectionStart < aCursor.mSelectionEnd; });
+		std::string text;
+		for (auto& cursor : cursors)
+		{
+			if (&cursor != &cursors.front())
+				text.push_back('\n');
+			auto line = SanitizeCoordinates(cursor.mCursorPosition).mLine;
+			text += selecting ? GetText(cursor.mSelectionStart, cursor.mSelectionEnd) : GetText(Coordinates(line, 0), Coordinates(line, (int)mLines[line].size()));
+		}
+		ImGui::SetClipboardText(text.c_str());
+	}
+	else if (HasSelection())
 	{
 		ImGui::SetClipboardText(GetSelectedText().c_str());
 	}
@@ -1215,6 +2680,20 @@ void TextEditor::Cut()
 	{
 		Copy();
 	}
+	else if (!mState.mCursors.empty())
+	{
+		int primary;
+		auto cursors = GetCursors(primary);
+		if (std::none_of(cursors.begin(), cursors.end(), [](const Cursor& aCursor) { return aCursor.mSelectionStart < aCursor.mSelectionEnd; }))
+			return;
+
+		Copy();
+		std::vector<CursorEdit> edits;
+		edits.reserve(cursors.size());
+		for (auto& cursor : cursors)
+			edits.push_back(CursorEdit{ cursor.mSelectionStart, cursor.mSelectionEnd, std::string() });
+		EditCursors(edits);
+	}
 	else
 	{
 		if (HasSelection())
@@ -1237,7 +2716,32 @@ void TextEditor::Cut()
 void TextEditor::Paste()
 {
 	auto clipText = ImGui::GetClipboardText();
-	if (clipText != nullptr && strlen(clipText) > 0)
+	if (clipText != nullptr && strlen(clipText) > 0 && !mState.mCursors.empty())
+	{
+		// As many lines as cursors go one to each, anything else is pasted whole at every cursor
+		int primary;
+		auto cursors = GetCursors(primary);
+		std::vector<CursorEdit> edits;
+		edits.reserve(cursors.size());
+		for (auto& cursor : cursors)
+			edits.push_back(CursorEdit{ cursor.mSelectionStart, cursor.mSelectionEnd, clipText });
+
+		size_t lines = 1;
+		for (auto p = clipText; (p = strchr(p, '\n')) != nullptr; ++p)
+			++lines;
+		if (lines == edits.size())
+		{
+			auto first = clipText;
+			for (auto& edit : edits)
+			{
+				auto last = first + strcspn(first, "\n");
+				edit.mText.assign(first, last);
+				first = last + (*last != '\0' ? 1 : 0);
+			}
+		}
+		EditCursors(edits);
+	}
+	else if (clipText != nullptr && strlen(clipText) > 0)
 	{
 		UndoRecord u;
 		u.mBefore = mState;
@@ -1275,20 +2779,549 @@ void TextEditor::Undo(int aSteps)
 {
 	while (CanUndo() && aSteps-- > 0)
 		mUndoBuffer[--mUndoIndex].Undo(this);
+	mUndoMergeable = false;
 }
 
 void TextEditor::Redo(int aSteps)
 {
 	while (CanRedo() && aSteps-- > 0)
 		mUndoBuffer[mUndoIndex++].Redo(this);
+	mUndoMergeable = false;
 }
 
-const TextEditor::Palette & TextEditor::GetDarkPalette()
+// ASCII only, like the case insensitive keyword lookup
+static inline char ToLower(char c) { return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c; }
+
+TextEditor::FindMatcher::FindMatcher(const FindQuery& aQuery)
+	: mQuery(aQuery)
+	, mValid(!aQuery.mWhat.empty())
 {
-	static Palette p = { 
-		0xffffffff,	// None
-		0xffd69c56,	// Keyword	
-		0xff00ff00,	// Number
+	if (mValid && mQuery.mRegex)
+	{
+		auto flags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+		if (!mQuery.mCaseSensitive)
+			flags |= std::regex_constants::icase;
+		try
+		{
+			mRegex = std::regex(mQuery.mWhat, flags);
+		}
+		catch (const std::regex_error&)
+		{
+			mValid = false;
+		}
+	}
+	else if (!mQuery.mCaseSensitive)
+	{
+		for (auto& c : mQuery.mWhat)
+			c = ToLower(c);
+	}
+}
+
+void TextEditor::FindMatcher::Match(const char* aText, size_t aSize, std::vector<std::pair<int, int>>& aOut) const
+{
+	if (!mValid)
+		return;
+
+	if (mQuery.mRegex)
+	{
+		for (std::cregex_iterator it(aText, aText + aSize, mRegex), end; it != end; ++it)
+		{
+			if (it->length() > 0)
+				aOut.push_back(std::make_pair((int)it->position(), (int)(it->position() + it->length())));
+		}
+		return;
+	}
+
+	// Case insensitive matching lower cases the line first, so both run the same scan
+	auto& what = mQuery.mWhat;
+	auto size = what.size();
+	if (aSize < size)
+		return;
+	if (!mQuery.mCaseSensitive)
+	{
+		mLowerCase.assign(aText, aSize);
+		for (auto& c : mLowerCase)
+			c = ToLower(c);
+		aText = mLowerCase.data();
+	}
+
+	// Candidates are found by their first byte, and with SSE2 also by their last one 16 starting points at a time, so
+	// only a few are compared in full. Matches do not overlap.
+	auto end = aText + aSize - size + 1;	// past the last place a match can start
+	auto next = aText;
+	auto verify = [&](const char* p)
+	{
+		if (p >= next && memcmp(p + 1, what.data() + 1, size - 1) == 0)
+		{
+			aOut.push_back(std::make_pair((int)(p - aText), (int)(p - aText + size)));
+			next = p + size;
+		}
+	};
+
+	auto p = aText;
+#ifdef TEXTEDITOR_SSE2
+	const __m128i first = _mm_set1_epi8(what[0]);
+	const __m128i last = _mm_set1_epi8(what[size - 1]);
+	for (; end - p >= 16; p += 16)
+	{
+		auto firstEqual = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), first);
+		auto lastEqual = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + size - 1)), last);
+		for (auto mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(firstEqual, lastEqual)); mask != 0; mask &= mask - 1)
+			verify(p + CountTrailingZeros(mask));
+	}
+#endif
+	for (; p < end; ++p)
+	{
+		p = (const char*)memchr(p, what[0], end - p);
+		if (p == nullptr)
+			break;
+		verify(p);
+	}
+}
+
+// The replacement for the match at aBegin, with $1 style references expanded for regular expressions
+std::string TextEditor::FindMatcher::Format(const char* aText, size_t aSize, int aBegin, const std::string& aWith) const
+{
+	if (!mQuery.mRegex)
+		return aWith;
+
+	std::cmatch match;
+	auto flags = std::regex_constants::match_continuous;
+	if (aBegin > 0)
+		flags |= std::regex_constants::match_prev_avail;
+	if (!std::regex_search(aText + aBegin, aText + aSize, match, mRegex, flags))
+		return aWith;
+	return match.format(aWith);
+}
+
+// Runs FindAll for a regular expression over a snapshot of the lines to search, so the UI thread only pays for the copy.
+// Only the newest job is of interest: submitting another one or cancelling makes the current one stop early.
+class TextEditor::FindWorker
+{
+public:
+	struct Job
+	{
+		uint32_t mId;
+		FindQuery mQuery;
+		std::shared_ptr<const char> mText;	// lines [mFirstLine, mLastLine), each ended by a newline but the last of the document
+		size_t mSize;
+		int mFirstLine;
+		int mLastLine;
+		uint32_t mTextVersion;
+		std::vector<FindResult> mResults;
+	};
+
+	FindWorker()
+		: mQuit(false)
+		, mLatest(0)
+	{
+		mThread = std::thread([this]() { Run(); });
+	}
+
+	~FindWorker()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQuit = true;
+		}
+		mWakeUp.notify_one();
+		mThread.join();
+	}
+
+	void Submit(std::shared_ptr<Job> aJob)
+	{
+		aJob->mId = ++mLatest;
+		mSubmitted = aJob;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mPending = std::move(aJob);
+		}
+		mWakeUp.notify_one();
+	}
+
+	void Cancel()
+	{
+		++mLatest;
+		mSubmitted.reset();
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPending.reset();
+	}
+
+	// The last submitted job once it is done
+	std::shared_ptr<Job> TakeResult()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mDone == nullptr || mDone != mSubmitted)
+			return nullptr;
+		mDone.reset();
+		return std::move(mSubmitted);
+	}
+
+	bool IsPending() const { return mSubmitted != nullptr; }
+	const Job* GetSubmitted() const { return mSubmitted.get(); }
+
+private:
+	void Run()
+	{
+		std::vector<std::pair<int, int>> matches;
+		for (;;)
+		{
+			std::shared_ptr<Job> job;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mWakeUp.wait(lock, [this]() { return mQuit || mPending != nullptr; });
+				if (mQuit)
+					return;
+				job = std::move(mPending);
+			}
+
+			FindMatcher matcher(job->mQuery);
+			auto text = job->mText.get();
+			auto end = text + job->mSize;
+			bool stopped = false;
+			for (int line = job->mFirstLine; text < end && !stopped; ++line)
+			{
+				auto newline = (const char*)memchr(text, '\n', end - text);
+				auto last = newline != nullptr ? newline : end;
+				matches.clear();
+				matcher.Match(text, last - text, matches);
+				for (auto& m : matches)
+					job->mResults.push_back(FindResult{ Coordinates(line, m.first), Coordinates(line, m.second) });
+				text = last + 1;
+				stopped = mQuit || mLatest != job->mId;
+			}
+
+			if (!stopped)
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mDone = std::move(job);
+			}
+		}
+	}
+
+	std::thread mThread;
+	std::mutex mMutex;
+	std::condition_variable mWakeUp;
+	std::shared_ptr<Job> mPending;
+	std::shared_ptr<Job> mDone;
+	std::shared_ptr<Job> mSubmitted;	// UI thread only
+	std::atomic<bool> mQuit;
+	std::atomic<uint32_t> mLatest;
+};
+
+const char* TextEditor::GetLineText(int aLineNo, std::string& aBuffer, size_t& aSize) const
+{
+	// A file view is searched straight in the mapping, without loading its lines
+	if (mLines.IsMapped())
+		return mLines.GetMappedLine(aLineNo, aSize);
+
+	auto& line = mLines[aLineNo];
+	aSize = line.size();
+	if (aBuffer.size() < aSize)
+		aBuffer.resize(aSize);
+	auto glyphs = line.data();
+	auto out = &aBuffer[0];
+	for (size_t i = 0; i < aSize; ++i)
+		out[i] = glyphs[i].mChar;
+	return out;
+}
+
+bool TextEditor::FindNext(const std::string& aWhat, bool aRegex, bool aCaseSensitive, bool aBackwards)
+{
+	FindMatcher matcher(FindQuery(aWhat, aRegex, aCaseSensitive));
+	if (!matcher.IsValid() || mLines.empty())
+		return false;
+
+	// Search on from the selection or the cursor, wrapping around back to the line it started on
+	auto from = HasSelection() ? (aBackwards ? mState.mSelectionStart : mState.mSelectionEnd) : GetActualCursorCoordinates();
+	auto count = (int)mLines.size();
+	std::vector<std::pair<int, int>> matches;
+	for (int i = 0; i <= count; ++i)
+	{
+		auto lineNo = aBackwards ? (from.mLine - i % count + count) % count : (from.mLine + i) % count;
+		size_t size;
+		auto text = GetLineText(lineNo, mFindBuffer, size);
+		matches.clear();
+		matcher.Match(text, size, matches);
+
+		// The starting line is searched twice: past the starting point first, before it after wrapping around
+		const std::pair<int, int>* found = nullptr;
+		for (auto& m : matches)
+		{
+			auto ahead = aBackwards ? m.first < from.mColumn : m.first >= from.mColumn;
+			if ((i > 0 && i < count) || ahead == (i == 0))
+			{
+				found = &m;
+				if (!aBackwards)
+					break;
+			}
+		}
+
+		if (found != nullptr)
+		{
+			mInteractiveStart = Coordinates(lineNo, found->first);
+			mInteractiveEnd = Coordinates(lineNo, found->second);
+			SetSelection(mInteractiveStart, mInteractiveEnd);
+			SetCursorPosition(mInteractiveEnd);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool TextEditor::FindAll(const std::string& aWhat, bool aRegex, bool aCaseSensitive)
+{
+	ClearFind();
+	FindQuery query(aWhat, aRegex, aCaseSensitive);
+	if (!FindMatcher(query).IsValid())
+		return false;
+
+	mFindQuery = query;
+	mFindDirtyMin = 0;
+	mFindDirtyMax = (int)mLines.size();
+	UpdateFindResults();
+	return true;
+}
+
+void TextEditor::ClearFind()
+{
+	mFindQuery = FindQuery();
+	mFindResults.clear();
+	mFindDirtyMin = std::numeric_limits<int>::max();
+	mFindDirtyMax = 0;
+	if (mFindWorker)
+		mFindWorker->Cancel();
+}
+
+bool TextEditor::IsFindPending() const
+{
+	return mFindWorker && mFindWorker->IsPending();
+}
+
+// Searches the lines changed since they were last searched, all of them after FindAll. A regular expression is matched
+// on the worker, its results are taken if no edit came in the meantime, else the lines are submitted again.
+void TextEditor::UpdateFindResults()
+{
+	if (mFindWorker)
+	{
+		if (auto job = mFindWorker->TakeResult())
+		{
+			if (job->mTextVersion == mTextVersion)
+			{
+				SetFindResults(job->mFirstLine, job->mLastLine, job->mResults);
+				mFindDirtyMin = std::numeric_limits<int>::max();
+				mFindDirtyMax = 0;
+			}
+		}
+	}
+
+	if (mFindQuery.mWhat.empty() || mFindDirtyMin >= mFindDirtyMax)
+		return;
+
+	auto firstLine = mFindDirtyMin;
+	auto lastLine = std::min(mFindDirtyMax, (int)mLines.size());
+	if (mFindQuery.mRegex)
+	{
+		if (!mFindWorker)
+			mFindWorker.reset(new FindWorker());
+		auto submitted = mFindWorker->GetSubmitted();
+		if (submitted != nullptr && submitted->mTextVersion == mTextVersion)
+			return;
+
+		auto job = std::make_shared<FindWorker::Job>();
+		job->mQuery = mFindQuery;
+		job->mFirstLine = firstLine;
+		job->mLastLine = lastLine;
+		job->mTextVersion = mTextVersion;
+		job->mSize = 0;
+		if (firstLine < lastLine && mLines.IsMapped())
+		{
+			size_t size, lastSize;
+			auto text = mLines.ShareMappedText(size);
+			auto begin = mLines.GetMappedLine(firstLine, size);
+			auto end = mLines.GetMappedLine(lastLine - 1, lastSize) + lastSize;
+			job->mText = std::shared_ptr<const char>(text, begin);
+			job->mSize = end - begin;
+		}
+		else if (firstLine < lastLine)
+		{
+			auto text = std::make_shared<std::string>(GetText(Coordinates(firstLine, 0), Coordinates(lastLine, 0)));
+			job->mSize = text->size();
+			job->mText = std::shared_ptr<const char>(text, text->data());
+		}
+		mFindWorker->Submit(std::move(job));
+		return;
+	}
+
+	if (mFindWorker)
+		mFindWorker->Cancel();
+
+	FindMatcher matcher(mFindQuery);
+	std::vector<std::pair<int, int>> matches;
+	std::vector<FindResult> found;
+	for (int i = firstLine; i < lastLine; ++i)
+	{
+		size_t size;
+		auto text = GetLineText(i, mFindBuffer, size);
+		matches.clear();
+		matcher.Match(text, size, matches);
+		for (auto& m : matches)
+			found.push_back(FindResult{ Coordinates(i, m.first), Coordinates(i, m.second) });
+	}
+	SetFindResults(firstLine, lastLine, found);
+	mFindDirtyMin = std::numeric_limits<int>::max();
+	mFindDirtyMax = 0;
+}
+
+// Replaces the matches on lines [aFirstLine, aLastLine) with aResults, which are the matches of those lines in order
+void TextEditor::SetFindResults(int aFirstLine, int aLastLine, std::vector<FindResult>& aResults)
+{
+	auto byLine = [](const FindResult& aResult, int aLine) { return aResult.mStart.mLine < aLine; };
+	auto first = std::lower_bound(mFindResults.begin(), mFindResults.end(), aFirstLine, byLine);
+	auto last = std::lower_bound(first, mFindResults.end(), aLastLine, byLine);
+	if (first == mFindResults.begin() && last == mFindResults.end())
+	{
+		mFindResults.swap(aResults);
+		return;
+	}
+	first = mFindResults.erase(first, last);
+	mFindResults.insert(first, aResults.begin(), aResults.end());
+}
+
+// Lines [aFirstLine, aLastLine) replaced [aFirstLine, oldLast): their matches are dropped until UpdateFindResults has
+// searched them again, the matches below move along with their lines
+void TextEditor::InvalidateFindResults(int aFirstLine, int aLastLine, int aLineDelta)
+{
+	if (mFindQuery.mWhat.empty())
+		return;
+
+	auto oldLast = std::max(aFirstLine, aLastLine - aLineDelta);
+	auto byLine = [](const FindResult& aResult, int aLine) { return aResult.mStart.mLine < aLine; };
+	auto first = std::lower_bound(mFindResults.begin(), mFindResults.end(), aFirstLine, byLine);
+	auto last = std::lower_bound(first, mFindResults.end(), oldLast, byLine);
+	auto below = mFindResults.erase(first, last);
+	if (aLineDelta != 0)
+	{
+		for (; below != mFindResults.end(); ++below)
+		{
+			below->mStart.mLine += aLineDelta;
+			below->mEnd.mLine += aLineDelta;
+		}
+	}
+
+	if (mFindDirtyMax > aFirstLine)
+		mFindDirtyMax = std::max(aFirstLine, mFindDirtyMax + aLineDelta);
+	mFindDirtyMin = std::min(mFindDirtyMin, aFirstLine);
+	mFindDirtyMax = std::max(mFindDirtyMax, aLastLine);
+}
+
+bool TextEditor::Replace(const std::string& aWhat, const std::string& aWith, bool aRegex, bool aCaseSensitive)
+{
+	FindMatcher matcher(FindQuery(aWhat, aRegex, aCaseSensitive));
+	if (!matcher.IsValid() || IsReadOnly())
+		return false;
+
+	// Replace the selection if it is a match, then select the next one
+	bool replaced = false;
+	auto start = mState.mSelectionStart;
+	auto end = mState.mSelectionEnd;
+	if (HasSelection() && start.mLine == end.mLine)
+	{
+		size_t size;
+		auto text = GetLineText(start.mLine, mFindBuffer, size);
+		std::vector<std::pair<int, int>> matches;
+		matcher.Match(text, size, matches);
+		for (auto& m : matches)
+		{
+			if (m.first != start.mColumn || m.second != end.mColumn)
+				continue;
+
+			UndoRecord u;
+			u.mBefore = mState;
+			u.mRemoved = GetSelectedText();
+			u.mRemovedStart = start;
+			u.mRemovedEnd = end;
+			u.mAdded = matcher.Format(text, size, m.first, aWith);
+			DeleteSelection();
+
+			u.mAddedStart = GetActualCursorCoordinates();
+			InsertText(u.mAdded);
+			u.mAddedEnd = GetActualCursorCoordinates();
+			u.mAfter = mState;
+			AddUndo(u);
+			replaced = true;
+			break;
+		}
+	}
+
+	FindNext(aWhat, aRegex, aCaseSensitive);
+	return replaced;
+}
+
+int TextEditor::ReplaceAll(const std::string& aWhat, const std::string& aWith, bool aRegex, bool aCaseSensitive)
+{
+	FindMatcher matcher(FindQuery(aWhat, aRegex, aCaseSensitive));
+	if (!matcher.IsValid() || IsReadOnly())
+		return 0;
+
+	std::vector<FindResult> found;
+	std::vector<std::pair<int, int>> matches;
+	for (int i = 0; i < (int)mLines.size(); ++i)
+	{
+		size_t size;
+		auto text = GetLineText(i, mFindBuffer, size);
+		matches.clear();
+		matcher.Match(text, size, matches);
+		for (auto& m : matches)
+			found.push_back(FindResult{ Coordinates(i, m.first), Coordinates(i, m.second) });
+	}
+	if (found.empty())
+		return 0;
+
+	// The lines from the first match to the last are rebuilt as one text which replaces them, so it is a single undo record
+	UndoRecord u;
+	u.mBefore = mState;
+	auto firstLine = found.front().mStart.mLine;
+	auto lastLine = found.back().mStart.mLine;
+	auto match = found.begin();
+	for (int i = firstLine; i <= lastLine; ++i)
+	{
+		size_t size;
+		auto text = GetLineText(i, mFindBuffer, size);
+		size_t column = 0;
+		for (; match != found.end() && match->mStart.mLine == i; ++match)
+		{
+			u.mAdded.append(text + column, match->mStart.mColumn - column);
+			u.mAdded += matcher.Format(text, size, match->mStart.mColumn, aWith);
+			column = match->mEnd.mColumn;
+		}
+		u.mAdded.append(text + column, size - column);
+		if (i < lastLine)
+			u.mAdded.push_back('\n');
+	}
+
+	u.mRemovedStart = Coordinates(firstLine, 0);
+	u.mRemovedEnd = Coordinates(lastLine, (int)mLines[lastLine].size());
+	u.mRemoved = GetText(u.mRemovedStart, u.mRemovedEnd);
+	DeleteRange(u.mRemovedStart, u.mRemovedEnd);
+
+	u.mAddedStart = u.mAddedEnd = u.mRemovedStart;
+	InsertTextAt(u.mAddedEnd, u.mAdded.c_str());
+	SetSelection(u.mAddedEnd, u.mAddedEnd);
+	SetCursorPosition(u.mAddedEnd);
+	Colorize(firstLine - 1, u.mAddedEnd.mLine - firstLine + 2);
+
+	u.mAfter = mState;
+	AddUndo(u);
+	return (int)found.size();
+}
+
+const TextEditor::Palette & TextEditor::GetDarkPalette()
+{
+	static Palette p = { 
+		0xffffffff,	// None
+		0xffd69c56,	// Keyword	
+		0xff00ff00,	// Number
 		0xff7070e0,	// String
 		0xff70a0e0, // Char literal
 		0xffffffff, // Punctuation
@@ -1307,6 +3340,8 @@ const TextEditor::Palette & TextEditor::GetDarkPalette()
 		0x40000000, // Current line fill
 		0x40808080, // Current line fill (inactive)
 		0x40a0a0a0, // Current line edge
+		0x4000a0ff, // Find highlight
+		0xc0c0c0c0, // Matching bracket
 	};
 	return p;
 }
@@ -1335,6 +3370,8 @@ const TextEditor::Palette & TextEditor::GetLightPalette()
 		0x40000000, // Current line fill
 		0x40808080, // Current line fill (inactive)
 		0x40000000, // Current line edge
+		0x4000a0ff, // Find highlight
+		0xc0404040, // Matching bracket
 	};
 	return p;
 }
@@ -1363,6 +3400,8 @@ const TextEditor::Palette & TextEditor::GetRetroBluePalette()
 		0x40000000, // Current line fill
 		0x40808080, // Current line fill (inactive)
 		0x40000000, // Current line edge
+		0x4000a0ff, // Find highlight
+		0xc0404040, // Matching bracket
 	};
 	return p;
 }
@@ -1370,6 +3409,12 @@ const TextEditor::Palette & TextEditor::GetRetroBluePalette()
 
 std::string TextEditor::GetText() const
 {
+	if (mLines.IsMapped())
+	{
+		size_t size = 0;
+		auto text = mLines.GetMappedText(size);
+		return std::string(text, size);
+	}
 	return GetText(Coordinates(), Coordinates((int)mLines.size(), 0));
 }
 
@@ -1385,180 +3430,2094 @@ void TextEditor::ProcessInputs()
 void TextEditor::Colorize(int aFromLine, int aLines)
 {
 	int toLine = aLines == -1 ? (int)mLines.size() : std::min((int)mLines.size(), aFromLine + aLines);
+
+	// Lines added or removed above the end of a range not colorized yet move its end along
+	if (mColorRangeMin < mColorRangeMax && aFromLine < mColorRangeMax)
+		mColorRangeMax = std::max(aFromLine, mColorRangeMax + (int)mLines.size() - mLastLineCount);
 	mColorRangeMin = std::min(mColorRangeMin, aFromLine);
 	mColorRangeMax = std::max(mColorRangeMax, toLine);
 	mColorRangeMin = std::max(0, mColorRangeMin);
 	mColorRangeMax = std::max(mColorRangeMin, mColorRangeMax);
-	mCheckMultilineComments = true;
+
+	// The edited lines may not be re-lexed for a while (see ColorizeInternal), their text changed already
+	for (int i = std::max(0, aFromLine); i < toLine; ++i)
+		mLines.Touch(mLines[i]);
+
+	// Every edit goes through here, and invalidates any background work
+	InvalidateLines(std::max(0, aFromLine), toLine);
+	mEditVersion = mTextVersion;
 }
 
-void TextEditor::ColorizeRange(int aFromLine, int aToLine)
+// Lines [aFromLine, aToLine) changed and the lines inserted or removed since the last call (always at or below
+// aFromLine) were. Shifts everything kept per line, and the background watermark, by the difference.
+void TextEditor::InvalidateLines(int aFromLine, int aToLine)
 {
-	if (mLines.empty() || aFromLine >= aToLine)
-		return;
+	auto delta = (int)mLines.size() - mLastLineCount;
+	++mTextVersion;
+	if (HasRowIndex())
+		InvalidateRows(aFromLine, aToLine, delta);
+	InvalidateFolds(aFromLine, aToLine, delta);
+	InvalidateIdentifiers(aFromLine, aToLine, delta);
+	InvalidateBrackets(aFromLine, aToLine, delta);
+	InvalidateSemanticTokens(aFromLine, aToLine, delta);
+	InvalidateFindResults(aFromLine, aToLine, delta);
+	if (mColorizedLines != std::numeric_limits<int>::max() && aFromLine < mColorizedLines)
+		mColorizedLines = std::max(aFromLine, mColorizedLines + delta);
+	mLastLineCount = (int)mLines.size();
+}
 
-	std::string buffer;
-	int endLine = std::max(0, std::min((int)mLines.size(), aToLine));
-	for (int i = aFromLine; i < endLine; ++i)
-	{
-		bool preproc = false;
-		auto& line = mLines[i];
-		buffer.clear();
-		for (auto g : mLines[i])
-		{
-			buffer.push_back(g.mChar);
-			g.mColorIndex = PaletteIndex::Default;
-		}
+bool TextEditor::MatchToken(const char* aFirst, const char* aLast, const char*& aOutBegin, const char*& aOutEnd, PaletteIndex& aOutColor) const
+{
+	if (mLanguageDefinition.mTokenize != nullptr)
+		return mLanguageDefinition.mTokenize(aFirst, aLast, aOutBegin, aOutEnd, aOutColor) && aOutEnd > aFirst;
 
-		std::match_results<std::string::const_iterator> results;
-		auto last = buffer.cend();
-		for (auto first = buffer.cbegin(); first != last; ++first)
+	std::cmatch results;
+	for (auto& p : mRegexList)
+	{
+		if (std::regex_search(aFirst, aLast, results, p.first, std::regex_constants::match_continuous) && results[0].second > aFirst)
 		{
-			for (auto& p : mRegexList)
-			{
-				if (std::regex_search<std::string::const_iterator>(first, last, results, p.first, std::regex_constants::match_continuous))
-				{
-					auto v = *results.begin();
-					auto start = v.first - buffer.begin();
-					auto end = v.second - buffer.begin();
-					auto id = buffer.substr(start, end - start);
-					auto color = p.second;
-					if (color == PaletteIndex::Identifier)
-					{
-						if (!mLanguageDefinition.mCaseSensitive)
-							std::transform(id.begin(), id.end(), id.begin(), ::toupper);
-
-						if (!preproc)
-						{
-							if (mLanguageDefinition.mKeywords.find(id) != mLanguageDefinition.mKeywords.end())
-								color = PaletteIndex::Keyword;
-							else if (mLanguageDefinition.mIdentifiers.find(id) != mLanguageDefinition.mIdentifiers.end())
-								color = PaletteIndex::KnownIdentifier;
-							else if (mLanguageDefinition.mPreprocIdentifiers.find(id) != mLanguageDefinition.mPreprocIdentifiers.end())
-								color = PaletteIndex::PreprocIdentifier;
-						}
-						else
-						{
-							if (mLanguageDefinition.mPreprocIdentifiers.find(id) != mLanguageDefinition.mPreprocIdentifiers.end())
-								color = PaletteIndex::PreprocIdentifier;
-							else
-								color = PaletteIndex::Identifier;
-						}
-					}
-					else if (color == PaletteIndex::Preprocessor)
-					{
-						preproc = true;
-					}
-					for (int j = (int)start; j < (int)end; ++j)
-						line[j].mColorIndex = color;
-					first += end - start - 1;
-					break;
-				}
-			}
+			aOutBegin = results[0].first;
+			aOutEnd = results[0].second;
+			aOutColor = p.second;
+			return true;
 		}
 	}
+	return false;
 }
 
-void TextEditor::ColorizeInternal()
+TextEditor::LexerState TextEditor::ColorizeGlyphs(Glyph* aGlyphs, size_t aCount, LexerState aState, std::string& aBuffer) const
 {
-	if (mLines.empty())
-		return;
-	
-	if (mCheckMultilineComments)
+	if (aCount == 0)
+		return aState;
+
+	aBuffer.resize(aCount);
+	for (size_t j = 0; j < aCount; ++j)
+	{
+		aBuffer[j] = aGlyphs[j].mChar;
+		aGlyphs[j].mColorIndex = PaletteIndex::Default;
+		aGlyphs[j].mMultiLineComment = false;
+	}
+
+	auto& commentStart = mLanguageDefinition.mCommentStart;
+	auto& commentEnd = mLanguageDefinition.mCommentEnd;
+	const char* bufferBegin = aBuffer.c_str();
+	const char* bufferEnd = bufferBegin + aBuffer.size();
+	const char* first = bufferBegin;
+	bool preproc = false;
+
+	while (first < bufferEnd)
 	{
-		auto end = Coordinates((int)mLines.size(), 0);
-		auto commentStart = end;
-		auto withinString = false;
-		for (auto i = Coordinates(0, 0); i < end; Advance(i))
+		// Tokenize up to the end of the current multi-line comment, or to the end of the line. Comment bodies are still
+		// tokenized so word navigation keeps working inside them, but cannot open another comment or a preprocessor line.
+		const char* last = bufferEnd;
+		const bool inComment = aState == LexerState::MultiLineComment;
+		if (inComment)
+		{
+			last = commentEnd.empty() ? bufferEnd : std::search(first, bufferEnd, commentEnd.begin(), commentEnd.end());
+			auto commentLast = last == bufferEnd ? bufferEnd : last + commentEnd.size();
+			for (auto j = first - bufferBegin; j < commentLast - bufferBegin; ++j)
+				aGlyphs[j].mMultiLineComment = true;
+			if (last != bufferEnd)
+				aState = LexerState::Default;
+		}
+
+		while (first < last)
 		{
-			auto& line = mLines[i.mLine];
-			if (!line.empty())
+			if (!inComment && !commentStart.empty() && *first == commentStart[0] && (size_t)(last - first) >= commentStart.size() &&
+				memcmp(first, commentStart.data(), commentStart.size()) == 0)
 			{
-				auto g = line[i.mColumn];
-				auto c = g.mChar;
+				for (size_t j = 0; j < commentStart.size(); ++j)
+					aGlyphs[first - bufferBegin + j].mMultiLineComment = true;
+				first += commentStart.size();
+				aState = LexerState::MultiLineComment;
+				break;
+			}
 
-				bool inComment = commentStart <= i;
+			const char* tokenBegin = nullptr;
+			const char* tokenEnd = nullptr;
+			PaletteIndex tokenColor = PaletteIndex::Default;
+			if (!MatchToken(first, last, tokenBegin, tokenEnd, tokenColor))
+			{
+				++first;
+				continue;
+			}
 
-				if (withinString)
+			if (tokenColor == PaletteIndex::Identifier)
+			{
+				auto flags = mKeywordTable.Find(tokenBegin, tokenEnd);
+				if (!preproc)
 				{
-					line[i.mColumn].mMultiLineComment = inComment;
-
-					if (c == '\"')
-					{
-						if (i.mColumn + 1 < (int)line.size() && line[i.mColumn + 1].mChar == '\"')
-						{
-							Advance(i);
-							if (i.mColumn < (int)line.size())
-								line[i.mColumn].mMultiLineComment = inComment;
-						}
-						else
-							withinString = false;
-					}
-					else if (c == '\\')
-					{
-						Advance(i);
-						if (i.mColumn < (int)line.size())
-							line[i.mColumn].mMultiLineComment = inComment;
-					}
+					if (flags & KeywordTable::IsKeyword)
+						tokenColor = PaletteIndex::Keyword;
+					else if (flags & KeywordTable::IsKnownIdentifier)
+						tokenColor = PaletteIndex::KnownIdentifier;
+					else if (flags & KeywordTable::IsPreprocIdentifier)
+						tokenColor = PaletteIndex::PreprocIdentifier;
 				}
-				else
-				{
-					if (c == '\"')
-					{
-						withinString = true;
-						line[i.mColumn].mMultiLineComment = inComment;
-					}
-					else
-					{
-						auto pred = [](const char& a, const Glyph& b) { return a == b.mChar; };
-						auto from = line.begin() + i.mColumn;
-						auto& startStr = mLanguageDefinition.mCommentStart;
-						if (i.mColumn + startStr.size() <= line.size() &&
-							std::equal(startStr.begin(), startStr.end(), from, from + startStr.size(), pred))
-							commentStart = i;
+				else if (flags & KeywordTable::IsPreprocIdentifier)
+					tokenColor = PaletteIndex::PreprocIdentifier;
+			}
+			else if (tokenColor == PaletteIndex::Preprocessor && !inComment)
+			{
+				preproc = true;
+			}
 
-						inComment = commentStart <= i;
+			for (auto j = tokenBegin - bufferBegin; j < tokenEnd - bufferBegin; ++j)
+				aGlyphs[j].mColorIndex = tokenColor;
+			first = tokenEnd;
+		}
 
-						line[i.mColumn].mMultiLineComment = inComment;
+		if (inComment)
+			first = last == bufferEnd ? bufferEnd : last + commentEnd.size();
+	}
+	return aState;
+}
 
-						auto& endStr = mLanguageDefinition.mCommentEnd;
-						if (i.mColumn + 1 >= (int)endStr.size() &&
-							std::equal(endStr.begin(), endStr.end(), from + 1 - endStr.size(), from + 1, pred))
-							commentStart = end;
-					}
-				}
-			}
-		}
-		mCheckMultilineComments = false;
+void TextEditor::ColorizeRange(int aFromLine, int aToLine)
+{
+	if (mLines.empty() || aFromLine >= aToLine)
 		return;
-	}
 
-	if (mColorRangeMin < mColorRangeMax)
+	int endLine = std::max(0, std::min((int)mLines.size(), aToLine));
+	auto state = aFromLine > 0 ? mLines[aFromLine - 1].mEndState : LexerState::Default;
+	for (int i = aFromLine; i < endLine; ++i)
 	{
-		int to = std::min(mColorRangeMin + 10, mColorRangeMax);
-		ColorizeRange(mColorRangeMin, to);
-		mColorRangeMin = to;
-
-		if (mColorRangeMax == mColorRangeMin)
-		{
-			mColorRangeMin = std::numeric_limits<int>::max();
-			mColorRangeMax = 0;
-		}
-		return;
+		state = ColorizeGlyphs(mLines[i].data(), mLines[i].size(), state, mColorizeBuffer);
+		mLines[i].mEndState = state;
+		mLines.Touch(mLines[i]);
 	}
+	InvalidateColors(aFromLine, endLine);
 }
 
-int TextEditor::TextDistanceToLineStart(const Coordinates& aFrom) const
+// Lexes snapshots of the not yet colorized part of the document on a worker thread. Results are handed back in chunks
+// through a lock-free stack and only applied by the UI thread if the document version they were lexed from is current.
+class TextEditor::ColorizeWorker
 {
-	auto& line = mLines[aFrom.mLine];
-	auto len = 0;
-	for (size_t it = 0u; it < line.size() && it < (unsigned)aFrom.mColumn; ++it)
-		len = line[it].mChar == '\t' ? (len / mTabSize) * mTabSize + mTabSize : len + 1;
+public:
+	struct Job
+	{
+		uint32_t mVersion;
+		int mFirstLine;
+		LexerState mState;
+		std::vector<Glyph> mGlyphs;
+		std::vector<size_t> mLineStarts;	// one entry per line plus the end
+		std::vector<LexerState> mEndStates;
+	};
+
+	// Lines [mBegin, mEnd) of a job, relative to its first line, which the worker will not touch again
+	struct Result
+	{
+		std::shared_ptr<Job> mJob;
+		int mBegin;
+		int mEnd;
+		Result* mNext;
+	};
+
+	ColorizeWorker(const TextEditor* aEditor)
+		: mSubmittedJob(nullptr)
+		, mSubmittedVersion(0)
+		, mSubmittedEnd(0)
+		, mSubmittedShift(0)
+		, mEditor(aEditor)
+		, mQuit(false)
+		, mVersion(0)
+		, mResults(nullptr)
+	{
+		mThread = std::thread([this]() { Run(); });
+	}
+
+	~ColorizeWorker()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQuit = true;
+		}
+		mWakeUp.notify_one();
+		mThread.join();
+
+		for (auto result = mResults.exchange(nullptr); result != nullptr;)
+		{
+			auto next = result->mNext;
+			delete result;
+			result = next;
+		}
+	}
+
+	void Submit(std::shared_ptr<Job> aJob)
+	{
+		mSubmittedJob = aJob.get();
+		mSubmittedVersion = aJob->mVersion;
+		mSubmittedEnd = aJob->mFirstLine + (int)aJob->mEndStates.size();
+		mSubmittedShift = 0;
+		mVersion = aJob->mVersion;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mPending = std::move(aJob);
+		}
+		mWakeUp.notify_one();
+	}
+
+	// Returns the published results oldest first, the caller owns them
+	Result* TakeResults()
+	{
+		Result* reversed = nullptr;
+		for (auto result = mResults.exchange(nullptr, std::memory_order_acquire); result != nullptr;)
+		{
+			auto next = result->mNext;
+			result->mNext = reversed;
+			reversed = result;
+			result = next;
+		}
+		return reversed;
+	}
+
+	// UI thread only. Text added at the end and lines dropped from the front leave the newest job valid: its results
+	// are used up to mSubmittedEnd, the line text was added to, with its lines moved up by mSubmittedShift.
+	const Job* mSubmittedJob;
+	uint32_t mSubmittedVersion;
+	int mSubmittedEnd;
+	int mSubmittedShift;
+
+private:
+	void Run()
+	{
+		std::string buffer;
+		for (;;)
+		{
+			std::shared_ptr<Job> job;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mWakeUp.wait(lock, [this]() { return mQuit || mPending != nullptr; });
+				if (mQuit)
+					return;
+				job = std::move(mPending);
+			}
+
+			auto state = job->mState;
+			int lineCount = (int)job->mLineStarts.size() - 1;
+			for (int begin = 0; begin < lineCount && !mQuit && mVersion == job->mVersion;)
+			{
+				int end = std::min(lineCount, begin + cColorizeLinesPerResult);
+				for (int i = begin; i < end; ++i)
+				{
+					auto start = job->mLineStarts[i];
+					state = mEditor->ColorizeGlyphs(job->mGlyphs.data() + start, job->mLineStarts[i + 1] - start, state, buffer);
+					job->mEndStates[i] = state;
+				}
+
+				auto result = new Result{ job, begin, end, mResults.load(std::memory_order_relaxed) };
+				while (!mResults.compare_exchange_weak(result->mNext, result, std::memory_order_release, std::memory_order_relaxed))
+					;
+				begin = end;
+			}
+		}
+	}
+
+	const TextEditor* mEditor;
+	std::thread mThread;
+	std::mutex mMutex;
+	std::condition_variable mWakeUp;
+	std::shared_ptr<Job> mPending;
+	std::atomic<bool> mQuit;
+	std::atomic<uint32_t> mVersion;	// version of the newest job, older ones stop early
+	std::atomic<Result*> mResults;
+};
+
+void TextEditor::ApplyColorizeResults()
+{
+	if (!mColorizeWorker)
+		return;
+
+	for (auto result = mColorizeWorker->TakeResults(); result != nullptr;)
+	{
+		auto& job = *result->mJob;
+		int jobFirstLine = job.mFirstLine - mColorizeWorker->mSubmittedShift;
+		int firstLine = jobFirstLine + result->mBegin;
+		int lastLine = std::min(jobFirstLine + result->mEnd, mColorizeWorker->mSubmittedEnd);
+		if (&job == mColorizeWorker->mSubmittedJob && job.mVersion == mEditVersion && firstLine == mColorizedLines && firstLine < lastLine)
+		{
+			for (int i = firstLine; i < lastLine; ++i)
+			{
+				auto& line = mLines[i];
+				auto index = i - jobFirstLine;
+				std::copy(job.mGlyphs.begin() + job.mLineStarts[index], job.mGlyphs.begin() + job.mLineStarts[index + 1], line.begin());
+				line.mEndState = job.mEndStates[index];
+				mLines.Touch(line);
+			}
+			mColorizedLines = lastLine;
+			InvalidateColors(firstLine, mColorizedLines);
+			if (mColorizedLines >= (int)mLines.size())
+				mColorizedLines = std::numeric_limits<int>::max();
+		}
+
+		auto next = result->mNext;
+		delete result;
+		result = next;
+	}
+}
+
+void TextEditor::UpdateColors()
+{
+	ApplyColorizeResults();
+	ColorizeInternal();
+}
+
+void TextEditor::ColorizeInternal()
+{
+	if (mLines.empty() || mLines.IsMapped())
+		return;
+
+	// The UI thread never colorizes past the background watermark, the worker owns those lines
+	int end = std::min((int)mLines.size(), mColorizedLines);
+	if (mColorRangeMin < mColorRangeMax)
+	{
+		if (mColorRangeMin >= end)
+		{
+			// Already queued for the worker
+		}
+		else if (std::min(mColorRangeMax, end) - mColorRangeMin > cMaxColorizeLinesPerFrame)
+		{
+			mColorizedLines = mColorRangeMin;
+		}
+		else
+		{
+			// Re-lex from the first dirty line. Past the dirty range keep going only while line end states differ from
+			// what they were before the edit: once one matches, nothing below can have changed.
+			int line = mColorRangeMin;
+			auto state = line > 0 ? mLines[line - 1].mEndState : LexerState::Default;
+			bool done = false;
+			for (int count = 0; !done && count < cMaxColorizeLinesPerFrame; ++count)
+			{
+				auto& current = mLines[line];
+				auto previousState = current.mEndState;
+				state = ColorizeGlyphs(current.data(), current.size(), state, mColorizeBuffer);
+				current.mEndState = state;
+				mLines.Touch(current);
+				++line;
+				done = line >= end || (line >= mColorRangeMax && state == previousState);
+			}
+			InvalidateColors(mColorRangeMin, line);
+
+			// An edit that changed the state of everything below (e.g. opening a comment) continues in the background
+			if (!done)
+				mColorizedLines = line;
+		}
+
+		mColorRangeMin = std::numeric_limits<int>::max();
+		mColorRangeMax = 0;
+	}
+
+	if (mColorizedLines >= (int)mLines.size())
+	{
+		mColorizedLines = std::numeric_limits<int>::max();
+		return;
+	}
+
+	if (!mColorizeWorker)
+		mColorizeWorker.reset(new ColorizeWorker(this));
+	if (mColorizeWorker->mSubmittedVersion == mEditVersion && mColorizedLines < mColorizeWorker->mSubmittedEnd)
+		return;
+
+	auto job = std::make_shared<ColorizeWorker::Job>();
+	job->mVersion = mEditVersion;
+	job->mFirstLine = mColorizedLines;
+	job->mState = mColorizedLines > 0 ? mLines[mColorizedLines - 1].mEndState : LexerState::Default;
+
+	int lastLine = std::min((int)mLines.size(), mColorizedLines + cColorizeLinesPerJob);
+	size_t glyphCount = 0;
+	for (int i = mColorizedLines; i < lastLine; ++i)
+		glyphCount += mLines[i].size();
+	job->mGlyphs.reserve(glyphCount);
+	job->mLineStarts.reserve(lastLine - mColorizedLines + 1);
+	for (int i = mColorizedLines; i < lastLine; ++i)
+	{
+		job->mLineStarts.push_back(job->mGlyphs.size());
+		job->mGlyphs.insert(job->mGlyphs.end(), mLines[i].begin(), mLines[i].end());
+	}
+	job->mLineStarts.push_back(job->mGlyphs.size());
+	job->mEndStates.resize(lastLine - mColorizedLines);
+	mColorizeWorker->Submit(std::move(job));
+}
+
+void TextEditor::AppendText(const char* aBegin, const char* aEnd)
+{
+	if (mLines.IsMapped() || aBegin == aEnd)
+		return;
+
+	auto firstLine = std::max(0, (int)mLines.size() - 1);
+	AppendGlyphs(aBegin, aEnd);
+	EndAppend(firstLine);
+}
+
+void TextEditor::PostText(std::string aText)
+{
+	mPostedText->Push(std::move(aText));
+}
+
+void TextEditor::AppendPostedText()
+{
+	auto posted = mPostedText->Take();
+	if (posted == nullptr)
+		return;
+
+	auto firstLine = std::max(0, (int)mLines.size() - 1);
+	while (posted != nullptr)
+	{
+		if (!mLines.IsMapped())
+			AppendGlyphs(posted->mText.data(), posted->mText.data() + posted->mText.size());
+		auto next = posted->mNext;
+		delete posted;
+		posted = next;
+	}
+	if (!mLines.IsMapped())
+		EndAppend(firstLine);
+}
+
+void TextEditor::AppendGlyphs(const char* aFirst, const char* aLast)
+{
+	// Like AppendLines, except that the text continues the last line
+	if (mLines.empty())
+		mLines.push_back(Line());
+	for (;;)
+	{
+		auto newline = (const char*)memchr(aFirst, '\n', aLast - aFirst);
+		auto last = newline != nullptr ? newline : aLast;
+		auto& line = mLines.back();
+		if (line.empty())
+			line.reserve(last - aFirst);
+		for (auto p = aFirst; p != last; ++p)
+			line.push_back(Glyph(*p, PaletteIndex::Default));
+		if (newline == nullptr)
+			return;
+		mLines.push_back(Line());
+		aFirst = newline + 1;
+	}
+}
+
+// Lines from aFirstLine down were added or added to
+void TextEditor::EndAppend(int aFirstLine)
+{
+	auto lineCount = (int)mLines.size();
+	if (mColorizedLines == std::numeric_limits<int>::max())
+	{
+		// Everything above is colorized already, so only the new lines are lexed, without going through the worker
+		auto state = aFirstLine > 0 ? mLines[aFirstLine - 1].mEndState : LexerState::Default;
+		for (int i = aFirstLine; i < lineCount; ++i)
+		{
+			auto& line = mLines[i];
+			state = ColorizeGlyphs(line.data(), line.size(), state, mColorizeBuffer);
+			line.mEndState = state;
+			mLines.Touch(line);
+		}
+	}
+	else
+	{
+		// The worker gets to the new lines after the ones it is busy with. A copy it has of the line the text was
+		// added to is out of date.
+		for (int i = aFirstLine; i < lineCount; ++i)
+			mLines.Touch(mLines[i]);
+		if (mColorizeWorker)
+			mColorizeWorker->mSubmittedEnd = std::min(mColorizeWorker->mSubmittedEnd, aFirstLine);
+	}
+	InvalidateLines(aFirstLine, lineCount);
+
+	// Dropping lines moves everything kept per line, so it is done a checkpoint's worth at a time
+	auto excess = lineCount - mLineLimit;
+	if (mLineLimit > 0 && excess >= cFoldCheckpointLines)
+		DropLines(excess - excess % cFoldCheckpointLines);
+	mFollowEnd = true;
+}
+
+// Removes the first aCount lines. Whole chunks of lines are let go without moving the others.
+void TextEditor::DropLines(int aCount)
+{
+	ErrorMarkers etmp;
+	for (auto& i : mErrorMarkers)
+	{
+		if (i.first > aCount)
+			etmp.insert(ErrorMarkers::value_type(i.first - aCount, i.second));
+	}
+	mErrorMarkers = std::move(etmp);
+
+	Breakpoints btmp;
+	for (auto i : mBreakpoints)
+	{
+		if (i > aCount)
+			btmp.insert(i - aCount);
+	}
+	mBreakpoints = std::move(btmp);
+
+	DropFolds(aCount);
+	mLines.erase(0, aCount);
+
+	// As InvalidateLines, except for the folds which were moved up already. A background job is still good for the
+	// lines that are left, unless some it had not got to were dropped.
+	++mTextVersion;
+	if (HasRowIndex())
+		InvalidateRows(0, 1, -aCount);
+	InvalidateIdentifiers(0, 1, -aCount);
+	InvalidateBrackets(0, 1, -aCount);
+	InvalidateSemanticTokens(0, 1, -aCount);
+	InvalidateFindResults(0, 1, -aCount);
+	if (mColorizedLines != std::numeric_limits<int>::max())
+	{
+		if (mColorizedLines < aCount)
+			mEditVersion = mTextVersion;
+		else if (mColorizeWorker)
+		{
+			mColorizeWorker->mSubmittedEnd -= aCount;
+			mColorizeWorker->mSubmittedShift += aCount;
+		}
+		mColorizedLines = std::max(0, mColorizedLines - aCount);
+	}
+	mLastLineCount = (int)mLines.size();
+	if (!mFoldedLines.empty() || !mHiddenLines.empty())
+		UpdateHiddenLines();
+
+	auto moveUp = [aCount](Coordinates& aWhere)
+	{
+		aWhere = aWhere.mLine >= aCount ? Coordinates(aWhere.mLine - aCount, aWhere.mColumn) : Coordinates();
+	};
+	moveUp(mState.mCursorPosition);
+	moveUp(mState.mSelectionStart);
+	moveUp(mState.mSelectionEnd);
+	moveUp(mInteractiveStart);
+	moveUp(mInteractiveEnd);
+	if (!mState.mCursors.empty())
+	{
+		for (auto& cursor : mState.mCursors)
+		{
+			moveUp(cursor.mCursorPosition);
+			moveUp(cursor.mSelectionStart);
+			moveUp(cursor.mSelectionEnd);
+		}
+		int primary;
+		auto cursors = GetCursors(primary);
+		SetCursors(cursors, primary);
+	}
+
+	// Undo records refer to lines by number
+	ClearUndo();
+	mCompletions.clear();
+}
+
+const TextEditor::ColumnIndex* TextEditor::GetColumnIndex(int aLineNo, const Line& aLine) const
+{
+	if (aLine.size() <= cColumnBlock)
+		return nullptr;
+
+	auto& index = mColumnIndex[aLineNo & (cColumnIndexLines - 1)];
+	if (index.mLine == aLineNo && index.mLineVersion == aLine.mVersion)
+		return &index;
+
+	index.mLine = aLineNo;
+	index.mLineVersion = aLine.mVersion;
+	index.mBlockDistances.clear();
+	auto len = 0;
+	for (size_t it = 0u; it < aLine.size(); ++it)
+	{
+		if (it % cColumnBlock == 0)
+			index.mBlockDistances.push_back(len);
+		len = aLine[it].mChar == '\t' ? (len / mTabSize) * mTabSize + mTabSize : len + 1;
+	}
+	return &index;
+}
+
+int TextEditor::TextDistanceToLineStart(const Coordinates& aFrom) const
+{
+	auto& line = mLines[aFrom.mLine];
+	auto end = std::min(line.size(), (size_t)std::max(0, aFrom.mColumn));
+	auto it = (size_t)0u;
+	auto len = 0;
+	if (auto index = GetColumnIndex(aFrom.mLine, line))
+	{
+		auto block = std::min(end / cColumnBlock, index->mBlockDistances.size() - 1);
+		it = block * cColumnBlock;
+		len = index->mBlockDistances[block];
+	}
+	for (; it < end; ++it)
+		len = line[it].mChar == '\t' ? (len / mTabSize) * mTabSize + mTabSize : len + 1;
 	return len;
 }
 
+// The first glyph at or past aDistance from the line start, or the end of the line
+int TextEditor::GlyphIndexAtDistance(int aLineNo, int aDistance) const
+{
+	auto& line = mLines[aLineNo];
+	auto it = (size_t)0u;
+	auto len = 0;
+	if (auto index = GetColumnIndex(aLineNo, line))
+	{
+		auto& distances = index->mBlockDistances;
+		auto block = std::lower_bound(distances.begin(), distances.end(), aDistance) - distances.begin();
+		if (block > 0)
+		{
+			it = (block - 1) * cColumnBlock;
+			len = distances[block - 1];
+		}
+	}
+	for (; len < aDistance && it < line.size(); ++it)
+		len = line[it].mChar == '\t' ? (len / mTabSize) * mTabSize + mTabSize : len + 1;
+	return (int)it;
+}
+
+// Breaks a line into rows of at most aColumns columns, after the last blank that fits where there is one and wherever
+// the row is full otherwise. Blanks never start a new row, they hang off the end. Returns the number of rows and adds
+// where every row after the first starts to aGlyphs and aDistances, if given.
+static int WrapLine(const char* aText, size_t aSize, int aTabSize, int aColumns, std::vector<int>* aGlyphs, std::vector<int>* aDistances)
+{
+	int rows = 1;
+	auto isBlank = [](char c) { return c == ' ' || c == '\t'; };
+	auto isContinuation = [](char c) { return ((unsigned char)c & 0xC0) == 0x80; };
+
+	// A tab is at most aTabSize columns wide, most lines are seen to fit without measuring them
+	if (aSize <= (size_t)aColumns && aSize + std::count(aText, aText + aSize, '\t') * (aTabSize - 1) <= (size_t)aColumns)
+		return 1;
+
+	// Without tabs every byte is a column, so a row can be ended by looking around where it is full instead of
+	// measuring every character on the way there
+	if (memchr(aText, '\t', aSize) == nullptr)
+	{
+		for (size_t start = 0; start + aColumns < aSize;)
+		{
+			// The first character that does not fit, either cut by the row end or the first non-blank after it
+			auto i = start + aColumns;
+			while (i > start && isContinuation(aText[i]))
+				--i;
+			if (i == start)
+			{
+				for (++i; i < aSize && isContinuation(aText[i]); ++i)
+					;
+			}
+			while (i < aSize && isBlank(aText[i]))
+				++i;
+			if (i == aSize)
+				break;
+
+			auto next = i;
+			for (auto j = i; j > start; --j)
+			{
+				if (isBlank(aText[j - 1]))
+				{
+					next = j;
+					break;
+				}
+			}
+			++rows;
+			if (aGlyphs != nullptr)
+			{
+				aGlyphs->push_back((int)next);
+				aDistances->push_back((int)next);
+			}
+			start = next;
+		}
+		return rows;
+	}
+
+	int rowStart = 0;
+	int breakGlyph = -1, breakDistance = 0;	// after the last blank of the row
+	int distance = 0;
+	for (size_t i = 0; i < aSize;)
+	{
+		auto c = aText[i];
+		auto blank = isBlank(c);
+		int length = 1;
+		int next;
+		if (c == '\t')
+			next = (distance / aTabSize) * aTabSize + aTabSize;
+		else
+		{
+			// A UTF-8 sequence takes a column per byte (see GetRenderCache) and is never split
+			while (i + length < aSize && isContinuation(aText[i + length]))
+				++length;
+			next = distance + length;
+		}
+
+		if (!blank && next - rowStart > aColumns && distance > rowStart)
+		{
+			auto glyph = breakGlyph >= 0 ? breakGlyph : (int)i;
+			rowStart = breakGlyph >= 0 ? breakDistance : distance;
+			breakGlyph = -1;
+			++rows;
+			if (aGlyphs != nullptr)
+			{
+				aGlyphs->push_back(glyph);
+				aDistances->push_back(rowStart);
+			}
+		}
+
+		i += length;
+		distance = next;
+		if (blank)
+		{
+			breakGlyph = (int)i;
+			breakDistance = distance;
+		}
+	}
+	return rows;
+}
+
+void TextEditor::SetWrapColumns(int aColumns)
+{
+	if (aColumns != mWrapColumns)
+	{
+		mWrapColumns = aColumns;
+		mRowsRecounted = 0;
+	}
+}
+
+// Lines [aFirstLine, aLastLine) changed, and aLineDelta lines were inserted (or removed) among them
+void TextEditor::InvalidateRows(int aFirstLine, int aLastLine, int aLineDelta) const
+{
+	if ((int)mLineRows.size() != mLastLineCount || aFirstLine - std::min(0, aLineDelta) > mLastLineCount)
+	{
+		mLineRows.clear();
+		return;
+	}
+
+	// Where exactly lines came or went does not matter, all of them are counted again
+	if (aLineDelta > 0)
+		mLineRows.insert(mLineRows.begin() + aFirstLine, aLineDelta, 1);
+	else if (aLineDelta < 0)
+		mLineRows.erase(mLineRows.begin() + aFirstLine, mLineRows.begin() + aFirstLine - aLineDelta);
+	if (aLineDelta != 0)
+		mRowStartsDirty = std::min(mRowStartsDirty, aFirstLine);
+	if (mRowsRecounted > aFirstLine)
+		mRowsRecounted = std::max(aFirstLine, mRowsRecounted + aLineDelta);
+
+	if (mRowsDirtyMax > aFirstLine)
+		mRowsDirtyMax = std::max(aFirstLine, mRowsDirtyMax + aLineDelta);
+	mRowsDirtyMin = std::min(mRowsDirtyMin, aFirstLine);
+	mRowsDirtyMax = std::max(mRowsDirtyMax, aLastLine);
+}
+
+void TextEditor::UpdateRows() const
+{
+	UpdateFolds();
+
+	auto lineCount = (int)mLines.size();
+	if ((int)mLineRows.size() != lineCount)
+	{
+		mLineRows.assign(lineCount, 1);
+		mRowStartsDirty = 0;
+		mRowsDirtyMin = 0;
+		mRowsDirtyMax = lineCount;
+		mRowsRecounted = lineCount;
+	}
+	if (mRowsDirtyMin == std::numeric_limits<int>::max())
+		return;
+
+	// Hidden lines take no rows. Lines that did not move are updated in the sums one by one, the rest are summed
+	// again once they are all counted.
+	auto hidden = std::partition_point(mHiddenLines.begin(), mHiddenLines.end(),
+		[this](const std::pair<int, int>& aRun) { return aRun.second < mRowsDirtyMin; });
+	for (int i = mRowsDirtyMin; i < std::min(mRowsDirtyMax, lineCount); ++i)
+	{
+		while (hidden != mHiddenLines.end() && hidden->second < i)
+			++hidden;
+		auto rows = hidden != mHiddenLines.end() && hidden->first <= i ? 0 : CountRows(i);
+		if (i < mRowStartsDirty && rows != mLineRows[i])
+			mRowStarts.Add(i, rows - mLineRows[i]);
+		mLineRows[i] = rows;
+	}
+	if (mRowStartsDirty < lineCount || mRowStarts.Count() != lineCount)
+		mRowStarts.Build(mLineRows.data(), lineCount, mRowStartsDirty);
+
+	mRowStartsDirty = std::numeric_limits<int>::max();
+	mRowsDirtyMin = std::numeric_limits<int>::max();
+	mRowsDirtyMax = 0;
+}
+
+// Counts lines [aFirstLine, aLastLine) at the current wrap width again. The rows of the others keep the count
+// from an earlier width until they are reached, so a change of width costs a batch of lines per frame.
+void TextEditor::RecountRows(int aFirstLine, int aLastLine) const
+{
+	UpdateRows();
+	for (int i = std::max(0, aFirstLine); i < std::min(aLastLine, (int)mLineRows.size()); ++i)
+	{
+		// Hidden lines take no rows at any width
+		if (mLineRows[i] == 0)
+			continue;
+		auto rows = CountRows(i);
+		if (rows != mLineRows[i])
+		{
+			mRowStarts.Add(i, rows - mLineRows[i]);
+			mLineRows[i] = rows;
+		}
+	}
+}
+
+// The rows a line that is not hidden takes. A file view is counted straight from the mapping, without loading the
+// lines. Most lines fit a row, which is seen without copying their text out.
+int TextEditor::CountRows(int aLineNo) const
+{
+	if (!mWordWrap)
+		return 1;
+
+	if (!mLines.IsMapped())
+	{
+		// A tab is at most mTabSize columns wide
+		auto& line = mLines[aLineNo];
+		if ((int)line.size() <= mWrapColumns)
+		{
+			auto tabs = std::count_if(line.begin(), line.end(), [](const Glyph& aGlyph) { return aGlyph.mChar == '\t'; });
+			if ((int)line.size() + (int)tabs * (mTabSize - 1) <= mWrapColumns)
+				return 1;
+		}
+	}
+
+	size_t size = 0;
+	auto text = GetLineText(aLineNo, mWrapBuffer, size);
+	return WrapLine(text, size, mTabSize, mWrapColumns, nullptr, nullptr);
+}
+
+int TextEditor::LineToRow(int aLineNo) const
+{
+	UpdateRows();
+	return mRowStarts.GetSum(std::max(0, std::min((int)mLines.size() - 1, aLineNo)));
+}
+
+int TextEditor::RowToLine(int aRow) const
+{
+	UpdateRows();
+	return mRowStarts.Find(aRow);
+}
+
+int TextEditor::GetRowCount() const
+{
+	UpdateRows();
+	return mRowStarts.GetSum((int)mLines.size());
+}
+
+const TextEditor::LineWrap& TextEditor::GetLineWrap(int aLineNo) const
+{
+	auto& line = mLines[aLineNo];
+	auto& wrap = mLineWraps[aLineNo & (cWrapCacheLines - 1)];
+	if (wrap.mLine == aLineNo && wrap.mLineVersion == line.mVersion && wrap.mColumns == mWrapColumns)
+		return wrap;
+
+	wrap.mLine = aLineNo;
+	wrap.mLineVersion = line.mVersion;
+	wrap.mColumns = mWrapColumns;
+	wrap.mGlyphs.assign(1, 0);
+	wrap.mDistances.assign(1, 0);
+	size_t size = 0;
+	auto text = GetLineText(aLineNo, mWrapBuffer, size);
+	WrapLine(text, size, mTabSize, mWrapColumns, &wrap.mGlyphs, &wrap.mDistances);
+	return wrap;
+}
+
+// The screen row a position is on and its distance from the start of that row
+void TextEditor::GetRowPosition(const Coordinates& aPosition, int& aRow, int& aDistance) const
+{
+	aDistance = TextDistanceToLineStart(aPosition);
+	if (!mWordWrap)
+	{
+		aRow = HasRowIndex() ? LineToRow(aPosition.mLine) : aPosition.mLine;
+		return;
+	}
+
+	auto& wrap = GetLineWrap(aPosition.mLine);
+	auto row = (int)(std::upper_bound(wrap.mGlyphs.begin(), wrap.mGlyphs.end(), aPosition.mColumn) - wrap.mGlyphs.begin()) - 1;
+	aRow = LineToRow(aPosition.mLine) + row;
+	aDistance -= wrap.mDistances[row];
+}
+
+// The glyph at aDistance into a screen row, or the last one of the row if it is shorter
+TextEditor::Coordinates TextEditor::RowPositionToCoordinates(int aRow, int aDistance) const
+{
+	if (!mWordWrap)
+	{
+		auto line = HasRowIndex() ? RowToLine(aRow) : std::max(0, std::min((int)mLines.size() - 1, aRow));
+		return Coordinates(line, GlyphIndexAtDistance(line, aDistance));
+	}
+
+	auto line = RowToLine(aRow);
+	auto& wrap = GetLineWrap(line);
+	auto row = std::max(0, std::min((int)wrap.mGlyphs.size() - 1, aRow - LineToRow(line)));
+	auto column = GlyphIndexAtDistance(line, wrap.mDistances[row] + aDistance);
+	if (row + 1 < (int)wrap.mGlyphs.size())
+		column = std::min(column, wrap.mGlyphs[row + 1] - 1);
+	return Coordinates(line, column);
+}
+
+void TextEditor::FoldTree::Build()
+{
+	mMaxEnds.resize(mRanges.size());
+	Build(0, (int)mRanges.size());
+}
+
+int TextEditor::FoldTree::Build(int aFirst, int aLast)
+{
+	if (aFirst >= aLast)
+		return -1;
+
+	auto middle = (aFirst + aLast) / 2;
+	mMaxEnds[middle] = std::max(mRanges[middle].mEnd, std::max(Build(aFirst, middle), Build(middle + 1, aLast)));
+	return mMaxEnds[middle];
+}
+
+void TextEditor::FoldTree::Update(int aRange)
+{
+	Update(0, (int)mRanges.size(), aRange);
+}
+
+int TextEditor::FoldTree::Update(int aFirst, int aLast, int aRange)
+{
+	// Only the nodes on the way down to the range change
+	auto middle = (aFirst + aLast) / 2;
+	auto left = aRange < middle ? Update(aFirst, middle, aRange) : MaxEnd(aFirst, middle);
+	auto right = aRange > middle ? Update(middle + 1, aLast, aRange) : MaxEnd(middle + 1, aLast);
+	mMaxEnds[middle] = std::max(mRanges[middle].mEnd, std::max(left, right));
+	return mMaxEnds[middle];
+}
+
+// Lines below the changed ones move, and lines within them are taken to the first. That never changes the order of two
+// lines, so the largest end under every node is still the largest after moving it too.
+void TextEditor::FoldTree::MoveLines(int aFirstLine, int aLastLine, int aLineDelta)
+{
+	auto oldLastLine = aLastLine - aLineDelta;
+	auto move = [=](int aLine) { return aLine >= oldLastLine ? aLine + aLineDelta : std::min(aLine, aFirstLine); };
+	for (auto& range : mRanges)
+	{
+		range.mStart = move(range.mStart);
+		range.mEnd = move(range.mEnd);
+	}
+	for (auto& end : mMaxEnds)
+		end = move(end);
+}
+
+int TextEditor::FoldTree::Find(int aStart) const
+{
+	// Ranges opened on the same line are ordered outermost first, an inner one may be closed while the outer is not
+	auto it = std::lower_bound(mRanges.begin(), mRanges.end(), aStart,
+		[](const FoldRange& aRange, int aLine) { return aRange.mStart < aLine; });
+	for (; it != mRanges.end() && it->mStart == aStart; ++it)
+	{
+		if (it->mEnd > aStart)
+			return (int)(it - mRanges.begin());
+	}
+	return -1;
+}
+
+void TextEditor::FoldTree::Stab(int aLine, std::vector<int>& aOut) const
+{
+	Stab(0, (int)mRanges.size(), aLine, aOut);
+}
+
+void TextEditor::FoldTree::Stab(int aFirst, int aLast, int aLine, std::vector<int>& aOut) const
+{
+	if (aFirst >= aLast)
+		return;
+
+	// Nothing under here ends at or below aLine, and nothing right of a range starting at or below aLine starts above it
+	auto middle = (aFirst + aLast) / 2;
+	if (mMaxEnds[middle] < aLine)
+		return;
+	Stab(aFirst, middle, aLine, aOut);
+	if (mRanges[middle].mStart < aLine)
+	{
+		if (mRanges[middle].mEnd >= aLine)
+			aOut.push_back(middle);
+		Stab(middle + 1, aLast, aLine, aOut);
+	}
+}
+
+// Same as InvalidateRows, for the line summaries fold ranges are found from
+void TextEditor::InvalidateFolds(int aFirstLine, int aLastLine, int aLineDelta)
+{
+	// Folds below the edit move with their lines, ones on lines that were removed are dropped
+	if (aLineDelta != 0 && !mFoldedLines.empty())
+	{
+		size_t count = 0;
+		for (auto line : mFoldedLines)
+		{
+			if (line >= aLastLine - aLineDelta)
+				mFoldedLines[count++] = line + aLineDelta;
+			else if (aLineDelta > 0 || line <= aFirstLine)
+				mFoldedLines[count++] = line;
+		}
+		mFoldedLines.erase(std::unique(mFoldedLines.begin(), mFoldedLines.begin() + count), mFoldedLines.end());
+	}
+
+	if (mLanguageDefinition.mFoldMode == LanguageDefinition::FoldMode::None)
+		return;
+	if ((int)mFoldLines.size() != mLastLineCount || aFirstLine - std::min(0, aLineDelta) > mLastLineCount)
+	{
+		mFoldLines.clear();
+		return;
+	}
+
+	if (aLineDelta > 0)
+		mFoldLines.insert(mFoldLines.begin() + aFirstLine, aLineDelta, FoldLine{ 0, 0, -1 });
+	else if (aLineDelta < 0)
+		mFoldLines.erase(mFoldLines.begin() + aFirstLine, mFoldLines.begin() + aFirstLine - aLineDelta);
+
+	// Ranges and checkpoints below the changed lines move with them. Ranges within them are found again by UpdateFolds,
+	// and checkpoints there are dropped.
+	if (aLineDelta != 0)
+	{
+		mFolds.MoveLines(aFirstLine, aLastLine, aLineDelta);
+		auto oldLastLine = aLastLine - aLineDelta;
+		mFoldCheckpoints.erase(std::remove_if(mFoldCheckpoints.begin(), mFoldCheckpoints.end(),
+			[=](const FoldCheckpoint& aCheckpoint) { return aCheckpoint.mLine > aFirstLine && aCheckpoint.mLine < oldLastLine; }),
+			mFoldCheckpoints.end());
+		for (auto& checkpoint : mFoldCheckpoints)
+		{
+			if (checkpoint.mLine >= oldLastLine)
+				checkpoint.mLine += aLineDelta;
+		}
+	}
+
+	if (mFoldDirtyMax > aFirstLine)
+		mFoldDirtyMax = std::max(aFirstLine, mFoldDirtyMax + aLineDelta);
+	mFoldDirtyMin = std::min(mFoldDirtyMin, aFirstLine);
+	mFoldDirtyMax = std::max(mFoldDirtyMax, aLastLine);
+}
+
+// Braces and brackets only count outside comments and strings, and identifiers are found by color, which is not known
+// until the lines are colorized
+void TextEditor::InvalidateColors(int aFirstLine, int aLastLine)
+{
+	if (aFirstLine >= aLastLine)
+		return;
+
+	if (mLanguageDefinition.mFoldMode == LanguageDefinition::FoldMode::Braces)
+	{
+		mFoldDirtyMin = std::min(mFoldDirtyMin, aFirstLine);
+		mFoldDirtyMax = std::max(mFoldDirtyMax, aLastLine);
+	}
+	mIdentifiersDirtyMin = std::min(mIdentifiersDirtyMin, aFirstLine);
+	mIdentifiersDirtyMax = std::max(mIdentifiersDirtyMax, aLastLine);
+	mBracketsDirtyMin = std::min(mBracketsDirtyMin, aFirstLine);
+	mBracketsDirtyMax = std::max(mBracketsDirtyMax, aLastLine);
+}
+
+void TextEditor::UpdateFolds() const
+{
+	auto mode = mLanguageDefinition.mFoldMode;
+	auto lineCount = (int)mLines.size();
+	if (mode == LanguageDefinition::FoldMode::None || mLines.IsMapped())
+		return;
+
+	if ((int)mFoldLines.size() != lineCount)
+	{
+		mFoldLines.resize(lineCount);
+		mFolds.mRanges.clear();
+		mFolds.Build();
+		mFoldCheckpoints.clear();
+		mFoldDirtyMin = 0;
+		mFoldDirtyMax = lineCount;
+	}
+	if (mFoldDirtyMin == std::numeric_limits<int>::max())
+		return;
+
+	for (int i = mFoldDirtyMin; i < std::min(mFoldDirtyMax, lineCount); ++i)
+	{
+		auto& line = mLines[i];
+		auto& summary = mFoldLines[i];
+		summary = FoldLine{ 0, 0, -1 };
+		if (mode == LanguageDefinition::FoldMode::Braces)
+		{
+			// Lines not colorized yet count every brace, they are summarized again once they are
+			for (auto& glyph : line)
+			{
+				if (glyph.mMultiLineComment || (glyph.mColorIndex != PaletteIndex::Punctuation && glyph.mColorIndex != PaletteIndex::Default))
+					continue;
+				if (glyph.mChar == '{')
+					++summary.mOpens;
+				else if (glyph.mChar == '}')
+				{
+					if (summary.mOpens > 0)
+						--summary.mOpens;
+					else
+						++summary.mCloses;
+				}
+			}
+		}
+		else
+		{
+			int indent = 0;
+			for (auto& glyph : line)
+			{
+				if (glyph.mChar == '\t')
+					indent = (indent / mTabSize + 1) * mTabSize;
+				else if (glyph.mChar == ' ')
+					++indent;
+				else if (!isspace((unsigned char)glyph.mChar))
+				{
+					summary.mIndent = indent;
+					break;
+				}
+			}
+		}
+	}
+
+	// Ranges that started above the last checkpoint at or before the first changed line are kept, and the ones open
+	// there are closed again by the scan from it. Ranges are added as they open, so they stay ordered by start.
+	auto& ranges = mFolds.mRanges;
+	auto checkpoint = (int)(std::upper_bound(mFoldCheckpoints.begin(), mFoldCheckpoints.end(), mFoldDirtyMin,
+		[](int aLine, const FoldCheckpoint& aCheckpoint) { return aLine < aCheckpoint.mLine; }) - mFoldCheckpoints.begin());
+	if (checkpoint == 0)
+		mFoldCheckpoints.insert(mFoldCheckpoints.begin(), FoldCheckpoint{ 0, {} });
+	else
+		--checkpoint;
+	auto firstLine = mFoldCheckpoints[checkpoint].mLine;
+	auto open = mFoldCheckpoints[checkpoint].mOpen;
+	std::vector<int> openEnds;
+	for (auto& o : open)
+	{
+		openEnds.push_back(ranges[o.mRange].mEnd);
+		ranges[o.mRange].mEnd = -1;
+	}
+	auto firstRange = (int)(std::lower_bound(ranges.begin(), ranges.end(), firstLine,
+		[](const FoldRange& aRange, int aLine) { return aRange.mStart < aLine; }) - ranges.begin());
+
+	// Ranges found by the scan go to 'found' until it stops, in place of the ones that started on the lines scanned.
+	// Past the changed lines, once the ranges open are as many as were open at a checkpoint there before, with the same
+	// indentation and after the same line for indented blocks, every range below is as before and the scan stops.
+	std::vector<FoldRange> found;
+	std::vector<FoldCheckpoint> checkpoints;
+	auto range = [&](int aRange) -> FoldRange& { return aRange < firstRange ? ranges[aRange] : found[aRange - firstRange]; };
+	auto nextCheckpoint = checkpoint + 1;
+	auto stopLine = lineCount;
+	auto lastLine = firstLine - 1;	// not blank
+	while (lastLine >= 0 && mFoldLines[lastLine].mIndent < 0)
+		--lastLine;
+	for (int i = firstLine; i < lineCount; ++i)
+	{
+		while (nextCheckpoint < (int)mFoldCheckpoints.size() && mFoldCheckpoints[nextCheckpoint].mLine < i)
+			++nextCheckpoint;
+		if (i >= mFoldDirtyMax && nextCheckpoint < (int)mFoldCheckpoints.size() && mFoldCheckpoints[nextCheckpoint].mLine == i &&
+			(mode == LanguageDefinition::FoldMode::Braces || lastLine >= mFoldDirtyMax))
+		{
+			auto& before = mFoldCheckpoints[nextCheckpoint].mOpen;
+			if (before.size() == open.size() && std::equal(open.begin(), open.end(), before.begin(),
+				[](const FoldOpen& aLeft, const FoldOpen& aRight) { return aLeft.mIndent == aRight.mIndent; }))
+			{
+				stopLine = i;
+				break;
+			}
+		}
+		if (i - (checkpoints.empty() ? firstLine : checkpoints.back().mLine) >= cFoldCheckpointLines)
+			checkpoints.push_back(FoldCheckpoint{ i, open });
+
+		auto& summary = mFoldLines[i];
+		if (mode == LanguageDefinition::FoldMode::Braces)
+		{
+			for (int j = 0; j < summary.mCloses && !open.empty(); ++j)
+			{
+				range(open.back().mRange).mEnd = i - 1;
+				open.pop_back();
+			}
+			for (int j = 0; j < summary.mOpens; ++j)
+			{
+				open.push_back(FoldOpen{ firstRange + (int)found.size(), 0 });
+				found.push_back(FoldRange{ i, -1 });
+			}
+		}
+		else if (summary.mIndent >= 0)
+		{
+			while (!open.empty() && open.back().mIndent >= summary.mIndent)
+			{
+				range(open.back().mRange).mEnd = lastLine;
+				open.pop_back();
+			}
+			open.push_back(FoldOpen{ firstRange + (int)found.size(), summary.mIndent });
+			found.push_back(FoldRange{ i, -1 });
+			lastLine = i;
+		}
+	}
+
+	auto stopRange = (int)ranges.size();
+	if (stopLine < lineCount)
+	{
+		// The ranges open end where the ones open before did, and the checkpoints below refer to ranges that moved
+		stopRange = (int)(std::lower_bound(ranges.begin() + firstRange, ranges.end(), stopLine,
+			[](const FoldRange& aRange, int aLine) { return aRange.mStart < aLine; }) - ranges.begin());
+		auto& before = mFoldCheckpoints[nextCheckpoint].mOpen;
+		for (size_t j = 0; j < open.size(); ++j)
+		{
+			auto o = std::find_if(mFoldCheckpoints[checkpoint].mOpen.begin(), mFoldCheckpoints[checkpoint].mOpen.end(),
+				[&](const FoldOpen& aOpen) { return aOpen.mRange == before[j].mRange; });
+			range(open[j].mRange).mEnd = o != mFoldCheckpoints[checkpoint].mOpen.end() ?
+				openEnds[o - mFoldCheckpoints[checkpoint].mOpen.begin()] : ranges[before[j].mRange].mEnd;
+		}
+		auto shift = firstRange + (int)found.size() - stopRange;
+		for (auto c = mFoldCheckpoints.begin() + nextCheckpoint + 1; c != mFoldCheckpoints.end(); ++c)
+		{
+			for (size_t j = 0; j < c->mOpen.size(); ++j)
+				c->mOpen[j].mRange = c->mOpen[j].mRange >= stopRange ? c->mOpen[j].mRange + shift : open[j].mRange;
+		}
+		mFoldCheckpoints[nextCheckpoint].mOpen = open;
+	}
+	else
+	{
+		// Braces left open never close, indented blocks end with the text
+		if (mode == LanguageDefinition::FoldMode::Indentation)
+		{
+			for (auto& o : open)
+				range(o.mRange).mEnd = lastLine;
+		}
+		nextCheckpoint = (int)mFoldCheckpoints.size();
+	}
+	mFoldCheckpoints.erase(mFoldCheckpoints.begin() + checkpoint + 1, mFoldCheckpoints.begin() + nextCheckpoint);
+	mFoldCheckpoints.insert(mFoldCheckpoints.begin() + checkpoint + 1,
+		std::make_move_iterator(checkpoints.begin()), std::make_move_iterator(checkpoints.end()));
+
+	// As many ranges as before only need the largest ends above them updated, unless so many changed that building
+	// the whole tree again is quicker than a walk down from the top for each
+	if ((int)found.size() == stopRange - firstRange && (int)found.size() * 16 < (int)ranges.size())
+	{
+		std::copy(found.begin(), found.end(), ranges.begin() + firstRange);
+		for (auto& o : mFoldCheckpoints[checkpoint].mOpen)
+			mFolds.Update(o.mRange);
+		for (int i = firstRange; i < stopRange; ++i)
+			mFolds.Update(i);
+	}
+	else
+	{
+		ranges.erase(ranges.begin() + firstRange, ranges.begin() + stopRange);
+		ranges.insert(ranges.begin() + firstRange, found.begin(), found.end());
+		mFolds.Build();
+	}
+	mFoldDirtyMin = std::numeric_limits<int>::max();
+	mFoldDirtyMax = 0;
+	UpdateHiddenLines();
+}
+
+void TextEditor::UpdateHiddenLines() const
+{
+	// Folds whose region went away are dropped, ones inside another folded region are hidden along with it. Both
+	// folds and ranges are ordered by start, each fold is looked for past the one before in steps that double.
+	std::vector<std::pair<int, int>> hidden;
+	auto& ranges = mFolds.mRanges;
+	auto range = ranges.begin();
+	size_t count = 0;
+	for (auto line : mFoldedLines)
+	{
+		ptrdiff_t step = 1;
+		while (step < ranges.end() - range && range[step].mStart < line)
+			step *= 2;
+		range = std::lower_bound(range + step / 2, range + std::min(step, ranges.end() - range), line,
+			[](const FoldRange& aRange, int aLine) { return aRange.mStart < aLine; });
+		while (range != ranges.end() && range->mStart == line && range->mEnd <= line)
+			++range;
+		if (range == ranges.end() || range->mStart != line)
+			continue;
+
+		mFoldedLines[count++] = line;
+		if (!hidden.empty() && line <= hidden.back().second)
+			hidden.back().second = std::max(hidden.back().second, range->mEnd);
+		else
+			hidden.emplace_back(line + 1, range->mEnd);
+	}
+	mFoldedLines.resize(count);
+
+	if (!HasRowIndex())
+	{
+		mLineRows.clear();
+		mHiddenLines.swap(hidden);
+		return;
+	}
+
+	// Only the lines of runs that changed are counted again
+	size_t front = 0;
+	while (front < hidden.size() && front < mHiddenLines.size() && hidden[front] == mHiddenLines[front])
+		++front;
+	size_t back = 0;
+	while (back < hidden.size() - front && back < mHiddenLines.size() - front &&
+		hidden[hidden.size() - 1 - back] == mHiddenLines[mHiddenLines.size() - 1 - back])
+		++back;
+	int firstLine = std::numeric_limits<int>::max();
+	int lastLine = 0;
+	for (size_t i = front; i < hidden.size() - back; ++i)
+	{
+		firstLine = std::min(firstLine, hidden[i].first);
+		lastLine = std::max(lastLine, hidden[i].second + 1);
+	}
+	for (size_t i = front; i < mHiddenLines.size() - back; ++i)
+	{
+		firstLine = std::min(firstLine, mHiddenLines[i].first);
+		lastLine = std::max(lastLine, mHiddenLines[i].second + 1);
+	}
+	mHiddenLines.swap(hidden);
+	if (firstLine < lastLine)
+		InvalidateRows(firstLine, std::min(lastLine, (int)mLines.size()), 0);
+}
+
+// Before the first aCount lines are dropped. Ranges that start on the dropped lines go and the others move up, as do the
+// checkpoints: scanning again from the first line left would find the same ones, the closing braces it would not match
+// are the ones that closed the dropped ranges.
+void TextEditor::DropFolds(int aCount)
+{
+	auto folded = std::lower_bound(mFoldedLines.begin(), mFoldedLines.end(), aCount);
+	mFoldedLines.erase(mFoldedLines.begin(), folded);
+	for (auto& line : mFoldedLines)
+		line -= aCount;
+
+	// Hidden lines move up too, UpdateHiddenLines then finds what changed once the lines are gone
+	auto hidden = std::partition_point(mHiddenLines.begin(), mHiddenLines.end(),
+		[aCount](const std::pair<int, int>& aRun) { return aRun.second < aCount; });
+	mHiddenLines.erase(mHiddenLines.begin(), hidden);
+	for (auto& run : mHiddenLines)
+		run = std::make_pair(std::max(0, run.first - aCount), run.second - aCount);
+
+	if (mLanguageDefinition.mFoldMode == LanguageDefinition::FoldMode::None || mLines.IsMapped())
+		return;
+	if ((int)mFoldLines.size() != mLastLineCount)
+	{
+		mFoldLines.clear();
+		return;
+	}
+
+	UpdateFolds();
+	auto& ranges = mFolds.mRanges;
+	auto dropped = (int)(std::lower_bound(ranges.begin(), ranges.end(), aCount,
+		[](const FoldRange& aRange, int aLine) { return aRange.mStart < aLine; }) - ranges.begin());
+	ranges.erase(ranges.begin(), ranges.begin() + dropped);
+	for (auto& range : ranges)
+	{
+		range.mStart -= aCount;
+		range.mEnd = range.mEnd >= 0 ? range.mEnd - aCount : range.mEnd;
+	}
+
+	mFoldCheckpoints.erase(mFoldCheckpoints.begin(), std::lower_bound(mFoldCheckpoints.begin(), mFoldCheckpoints.end(), aCount,
+		[](const FoldCheckpoint& aCheckpoint, int aLine) { return aCheckpoint.mLine < aLine; }));
+	for (auto& checkpoint : mFoldCheckpoints)
+	{
+		checkpoint.mLine -= aCount;
+		auto& open = checkpoint.mOpen;
+		open.erase(open.begin(), std::find_if(open.begin(), open.end(), [dropped](const FoldOpen& aOpen) { return aOpen.mRange >= dropped; }));
+		for (auto& o : open)
+			o.mRange -= dropped;
+	}
+
+	mFoldLines.erase(mFoldLines.begin(), mFoldLines.begin() + aCount);
+	mFolds.Build();
+}
+
+void TextEditor::ClearFolds()
+{
+	mFolds.mRanges.clear();
+	mFolds.Build();
+	mFoldLines.clear();
+	mFoldCheckpoints.clear();
+	mFoldedLines.clear();
+	mHiddenLines.clear();
+	mLineRows.clear();
+}
+
+int TextEditor::NextVisibleLine(int aLineNo) const
+{
+	auto line = aLineNo + 1;
+	if (!mFoldedLines.empty())
+	{
+		UpdateFolds();
+		auto hidden = std::partition_point(mHiddenLines.begin(), mHiddenLines.end(),
+			[line](const std::pair<int, int>& aRun) { return aRun.second < line; });
+		if (hidden != mHiddenLines.end() && hidden->first <= line)
+			line = hidden->second + 1;
+	}
+	return line < (int)mLines.size() ? line : aLineNo;
+}
+
+int TextEditor::PreviousVisibleLine(int aLineNo) const
+{
+	auto line = aLineNo - 1;
+	if (!mFoldedLines.empty())
+	{
+		UpdateFolds();
+		auto hidden = std::partition_point(mHiddenLines.begin(), mHiddenLines.end(),
+			[line](const std::pair<int, int>& aRun) { return aRun.second < line; });
+		if (hidden != mHiddenLines.end() && hidden->first <= line)
+			line = hidden->first - 1;
+	}
+	return std::max(0, line);
+}
+
+// Unfolds every region aLineNo is hidden in
+void TextEditor::RevealLine(int aLineNo)
+{
+	if (mFoldedLines.empty())
+		return;
+
+	UpdateFolds();
+	std::vector<int> ranges;
+	mFolds.Stab(aLineNo, ranges);
+	auto count = mFoldedLines.size();
+	for (auto range : ranges)
+	{
+		auto it = std::lower_bound(mFoldedLines.begin(), mFoldedLines.end(), mFolds.mRanges[range].mStart);
+		if (it != mFoldedLines.end() && *it == mFolds.mRanges[range].mStart)
+			mFoldedLines.erase(it);
+	}
+	if (mFoldedLines.size() != count)
+		UpdateHiddenLines();
+}
+
+void TextEditor::MoveCursorOutOfFolds()
+{
+	auto pos = GetActualCursorCoordinates();
+	if (!IsLineHidden(pos.mLine))
+		return;
+
+	auto line = PreviousVisibleLine(pos.mLine + 1);
+	pos = Coordinates(line, (int)mLines[line].size());
+	mInteractiveStart = mInteractiveEnd = pos;
+	SetSelection(pos, pos);
+	SetCursorPosition(pos);
+}
+
+std::vector<TextEditor::FoldRegion> TextEditor::GetFoldRegions() const
+{
+	UpdateFolds();
+	std::vector<FoldRegion> regions;
+	for (auto& range : mFolds.mRanges)
+	{
+		if (range.mEnd > range.mStart && (regions.empty() || regions.back().mStart != range.mStart))
+			regions.push_back(FoldRegion{ range.mStart, range.mEnd, IsFolded(range.mStart) });
+	}
+	return regions;
+}
+
+bool TextEditor::Fold(int aLine, bool aFolded)
+{
+	UpdateFolds();
+	if (mFolds.Find(aLine) < 0)
+		return false;
+
+	// Rows are not counted while nothing is folded or wrapped, they are counted again from scratch
+	if (!HasRowIndex())
+		mLineRows.clear();
+	auto it = std::lower_bound(mFoldedLines.begin(), mFoldedLines.end(), aLine);
+	if (aFolded && (it == mFoldedLines.end() || *it != aLine))
+		mFoldedLines.insert(it, aLine);
+	else if (!aFolded && it != mFoldedLines.end() && *it == aLine)
+		mFoldedLines.erase(it);
+	UpdateHiddenLines();
+	MoveCursorOutOfFolds();
+	return true;
+}
+
+bool TextEditor::ToggleFold(int aLine)
+{
+	UpdateFolds();
+	return Fold(aLine, !IsFolded(aLine));
+}
+
+void TextEditor::FoldAll(bool aFolded)
+{
+	UpdateFolds();
+	if (!HasRowIndex())
+		mLineRows.clear();
+	mFoldedLines.clear();
+	if (aFolded)
+	{
+		for (auto& range : mFolds.mRanges)
+		{
+			if (range.mEnd > range.mStart && (mFoldedLines.empty() || mFoldedLines.back() != range.mStart))
+				mFoldedLines.push_back(range.mStart);
+		}
+	}
+	UpdateHiddenLines();
+	MoveCursorOutOfFolds();
+}
+
+bool TextEditor::IsLineHidden(int aLine) const
+{
+	UpdateFolds();
+	auto hidden = std::partition_point(mHiddenLines.begin(), mHiddenLines.end(),
+		[aLine](const std::pair<int, int>& aRun) { return aRun.second < aLine; });
+	return hidden != mHiddenLines.end() && hidden->first <= aLine;
+}
+
+uint32_t TextEditor::IdentifierIndex::Hash(const char* aBegin, const char* aEnd)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (auto p = aBegin; p != aEnd; ++p)
+		hash = (hash ^ (uint8_t)*p) * 16777619u;
+	return hash;
+}
+
+size_t TextEditor::IdentifierIndex::Probe(uint32_t aHash, const char* aBegin, const char* aEnd) const
+{
+	auto length = (size_t)(aEnd - aBegin);
+	auto mask = mSlots.size() - 1;
+	auto slot = aHash & mask;
+	for (; mSlots[slot] >= 0; slot = (slot + 1) & mask)
+	{
+		auto& entry = mEntries[mSlots[slot]];
+		if (entry.mHash == aHash && entry.mWord.size() == length && memcmp(entry.mWord.data(), aBegin, length) == 0)
+			break;
+	}
+	return slot;
+}
+
+int TextEditor::IdentifierIndex::Add(const char* aBegin, const char* aEnd)
+{
+	if ((mEntries.size() + 1) * 2 > mSlots.size())
+	{
+		mSlots.assign(std::max<size_t>(256, mSlots.size() * 2), -1);
+		for (int i = 0; i < (int)mEntries.size(); ++i)
+		{
+			auto& word = mEntries[i].mWord;
+			mSlots[Probe(mEntries[i].mHash, word.data(), word.data() + word.size())] = i;
+		}
+	}
+
+	auto hash = Hash(aBegin, aEnd);
+	auto slot = Probe(hash, aBegin, aEnd);
+	if (mSlots[slot] < 0)
+	{
+		mSlots[slot] = (int)mEntries.size();
+		mUnsorted.push_back((int)mEntries.size());
+		mEntries.push_back(Entry{ std::string(aBegin, aEnd), hash, 0 });
+	}
+
+	auto id = mSlots[slot];
+	++mEntries[id].mCount;
+	return id;
+}
+
+int TextEditor::IdentifierIndex::Find(const char* aBegin, const char* aEnd) const
+{
+	return mSlots.empty() ? -1 : mSlots[Probe(Hash(aBegin, aEnd), aBegin, aEnd)];
+}
+
+void TextEditor::IdentifierIndex::Merge() const
+{
+	auto less = [this](int aLeft, int aRight) { return mEntries[aLeft].mWord < mEntries[aRight].mWord; };
+	std::sort(mUnsorted.begin(), mUnsorted.end(), less);
+	auto middle = mSorted.size();
+	mSorted.insert(mSorted.end(), mUnsorted.begin(), mUnsorted.end());
+	std::inplace_merge(mSorted.begin(), mSorted.begin() + middle, mSorted.end(), less);
+	mUnsorted.clear();
+}
+
+void TextEditor::IdentifierIndex::FindPrefix(const char* aBegin, const char* aEnd, size_t aMax, std::vector<int>& aOut) const
+{
+	if (mUnsorted.size() > cMaxUnsortedIdentifiers)
+		Merge();
+
+	auto first = aOut.size();
+	auto length = (size_t)(aEnd - aBegin);
+	auto it = std::lower_bound(mSorted.begin(), mSorted.end(), aBegin,
+		[this, length](int aId, const char* aPrefix) { return mEntries[aId].mWord.compare(0, std::string::npos, aPrefix, length) < 0; });
+	for (; it != mSorted.end() && aOut.size() - first < aMax; ++it)
+	{
+		auto& entry = mEntries[*it];
+		if (entry.mWord.compare(0, length, aBegin, length) != 0)
+			break;
+		if (entry.mCount > 0)
+			aOut.push_back(*it);
+	}
+
+	// The first aMax of the ordered ones and all of the new ones include the first aMax overall
+	auto found = aOut.size();
+	for (auto id : mUnsorted)
+	{
+		auto& entry = mEntries[id];
+		if (entry.mCount > 0 && entry.mWord.compare(0, length, aBegin, length) == 0)
+			aOut.push_back(id);
+	}
+	if (aOut.size() > found)
+	{
+		std::sort(aOut.begin() + first, aOut.end(), [this](int aLeft, int aRight) { return mEntries[aLeft].mWord < mEntries[aRight].mWord; });
+		aOut.resize(std::min(aOut.size(), first + aMax));
+	}
+}
+
+void TextEditor::IdentifierIndex::Clear()
+{
+	mEntries.clear();
+	mSlots.clear();
+	mSorted.clear();
+	mUnsorted.clear();
+}
+
+// Same as InvalidateRows. The index is only built once completions are asked for, until then this does nothing.
+void TextEditor::InvalidateIdentifiers(int aFirstLine, int aLastLine, int aLineDelta)
+{
+	if (mLineIdentifiers.empty() || (int)mLineIdentifiers.size() != mLastLineCount || aFirstLine - std::min(0, aLineDelta) > mLastLineCount)
+	{
+		mLineIdentifiers.clear();
+		mIdentifierIndex.Clear();
+		return;
+	}
+
+	if (aLineDelta > 0)
+		mLineIdentifiers.insert(mLineIdentifiers.begin() + aFirstLine, aLineDelta, std::vector<int>());
+	else if (aLineDelta < 0)
+	{
+		for (int i = aFirstLine; i < aFirstLine - aLineDelta; ++i)
+			for (auto id : mLineIdentifiers[i])
+				mIdentifierIndex.Release(id);
+		mLineIdentifiers.erase(mLineIdentifiers.begin() + aFirstLine, mLineIdentifiers.begin() + aFirstLine - aLineDelta);
+	}
+
+	if (mIdentifiersDirtyMax > aFirstLine)
+		mIdentifiersDirtyMax = std::max(aFirstLine, mIdentifiersDirtyMax + aLineDelta);
+	mIdentifiersDirtyMin = std::min(mIdentifiersDirtyMin, aFirstLine);
+	mIdentifiersDirtyMax = std::max(mIdentifiersDirtyMax, aLastLine);
+}
+
+void TextEditor::UpdateIdentifiers() const
+{
+	auto lineCount = (int)mLines.size();
+	if (mLines.IsMapped())
+		return;
+
+	if ((int)mLineIdentifiers.size() != lineCount)
+	{
+		mIdentifierIndex.Clear();
+		mLineIdentifiers.assign(lineCount, std::vector<int>());
+		mIdentifiersDirtyMin = 0;
+		mIdentifiersDirtyMax = lineCount;
+	}
+	if (mIdentifiersDirtyMin == std::numeric_limits<int>::max())
+		return;
+
+	for (int i = mIdentifiersDirtyMin; i < std::min(mIdentifiersDirtyMax, lineCount); ++i)
+	{
+		auto& ids = mLineIdentifiers[i];
+		for (auto id : ids)
+			mIdentifierIndex.Release(id);
+		ids.clear();
+
+		// Lines the worker has not colorized yet are indexed when it has
+		if (i >= mColorizedLines)
+			continue;
+
+		auto& line = mLines[i];
+		for (size_t j = 0; j < line.size();)
+		{
+			auto color = line[j].mColorIndex;
+			if (line[j].mMultiLineComment || (color != PaletteIndex::Identifier && color != PaletteIndex::KnownIdentifier && color != PaletteIndex::PreprocIdentifier))
+			{
+				++j;
+				continue;
+			}
+
+			mWordBuffer.clear();
+			for (; j < line.size() && line[j].mColorIndex == color && !line[j].mMultiLineComment; ++j)
+				mWordBuffer.push_back(line[j].mChar);
+			ids.push_back(mIdentifierIndex.Add(mWordBuffer.data(), mWordBuffer.data() + mWordBuffer.size()));
+		}
+	}
+
+	mIdentifiersDirtyMin = std::numeric_limits<int>::max();
+	mIdentifiersDirtyMax = 0;
+}
+
+std::vector<std::string> TextEditor::GetCompletions(const std::string& aPrefix, size_t aMax) const
+{
+	UpdateIdentifiers();
+	std::vector<int> ids;
+	mIdentifierIndex.FindPrefix(aPrefix.data(), aPrefix.data() + aPrefix.size(), aMax, ids);
+
+	std::vector<std::string> completions;
+	completions.reserve(ids.size());
+	for (auto id : ids)
+		completions.push_back(mIdentifierIndex.GetWord(id));
+	return completions;
+}
+
+void TextEditor::SetAutoComplete(bool aValue)
+{
+	mAutoComplete = aValue;
+	mCompletions.clear();
+}
+
+// Offers completions for the word in front of the cursor once something is typed, and keeps them up to date until the
+// cursor leaves the word
+void TextEditor::UpdateCompletions(bool aTyped)
+{
+	if (!mAutoComplete || mLines.IsMapped() || (!aTyped && mCompletions.empty()))
+		return;
+
+	auto end = GetActualCursorCoordinates();
+	auto start = end;
+	if (start.mLine < (int)mLines.size())
+	{
+		auto& line = mLines[start.mLine];
+		while (start.mColumn > 0 && (isalnum((unsigned char)line[start.mColumn - 1].mChar) || line[start.mColumn - 1].mChar == '_'))
+			--start.mColumn;
+	}
+
+	if (start == end || HasSelection() || !mState.mCursors.empty() || isdigit((unsigned char)mLines[start.mLine][start.mColumn].mChar) || (!aTyped && start != mCompletionStart))
+	{
+		mCompletions.clear();
+		return;
+	}
+	if (!aTyped && end == mCompletionEnd && mCompletionVersion == mTextVersion)
+		return;
+
+	// The word being typed is in the index itself, it is not offered
+	auto& line = mLines[start.mLine];
+	std::string prefix;
+	for (int i = start.mColumn; i < end.mColumn; ++i)
+		prefix.push_back(line[i].mChar);
+	mCompletions = GetCompletions(prefix, cMaxCompletions + 1);
+	mCompletions.erase(std::remove(mCompletions.begin(), mCompletions.end(), prefix), mCompletions.end());
+	if (mCompletions.size() > cMaxCompletions)
+		mCompletions.pop_back();
+
+	mCompletionIndex = 0;
+	mCompletionStart = start;
+	mCompletionEnd = end;
+	mCompletionVersion = mTextVersion;
+}
+
+void TextEditor::AcceptCompletion()
+{
+	auto& word = mCompletions[mCompletionIndex];
+	auto typed = (size_t)(mCompletionEnd.mColumn - mCompletionStart.mColumn);
+	if (!IsReadOnly() && GetActualCursorCoordinates() == mCompletionEnd && typed < word.size())
+	{
+		UndoRecord u;
+		u.mBefore = mState;
+		u.mAdded = word.substr(typed);
+		u.mAddedStart = mCompletionEnd;
+		InsertText(u.mAdded);
+		u.mAddedEnd = GetActualCursorCoordinates();
+		u.mAfter = mState;
+		AddUndo(u);
+	}
+	mCompletions.clear();
+}
+
+// +1 for an opening bracket and -1 for a closing one outside comments and strings. Lines not colorized yet count every
+// bracket, they are summarized again once they are.
+static int BracketDelta(const TextEditor::Glyph& aGlyph)
+{
+	if (aGlyph.mMultiLineComment || (aGlyph.mColorIndex != TextEditor::PaletteIndex::Punctuation && aGlyph.mColorIndex != TextEditor::PaletteIndex::Default))
+		return 0;
+	switch (aGlyph.mChar)
+	{
+	case '(': case '[': case '{':
+		return 1;
+	case ')': case ']': case '}':
+		return -1;
+	default:
+		return 0;
+	}
+}
+
+static bool IsBracketPair(char aOpen, char aClose)
+{
+	return (aOpen == '(' && aClose == ')') || (aOpen == '[' && aClose == ']') || (aOpen == '{' && aClose == '}');
+}
+
+// Same as InvalidateRows. The index is only built once a bracket is looked up, until then this does nothing.
+void TextEditor::InvalidateBrackets(int aFirstLine, int aLastLine, int aLineDelta)
+{
+	if (mBracketLines.empty() || (int)mBracketLines.size() != mLastLineCount || aFirstLine - std::min(0, aLineDelta) > mLastLineCount)
+	{
+		mBracketLines.clear();
+		return;
+	}
+
+	if (aLineDelta > 0)
+		mBracketLines.insert(mBracketLines.begin() + aFirstLine, aLineDelta, BracketDepth{ 0, 0 });
+	else if (aLineDelta < 0)
+		mBracketLines.erase(mBracketLines.begin() + aFirstLine, mBracketLines.begin() + aFirstLine - aLineDelta);
+	if (aLineDelta != 0)
+		mBracketsMoved = std::min(mBracketsMoved, aFirstLine);
+
+	if (mBracketsDirtyMax > aFirstLine)
+		mBracketsDirtyMax = std::max(aFirstLine, mBracketsDirtyMax + aLineDelta);
+	mBracketsDirtyMin = std::min(mBracketsDirtyMin, aFirstLine);
+	mBracketsDirtyMax = std::max(mBracketsDirtyMax, aLastLine);
+}
+
+void TextEditor::UpdateBrackets() const
+{
+	auto lineCount = (int)mLines.size();
+	if (mLines.IsMapped())
+		return;
+
+	if ((int)mBracketLines.size() != lineCount)
+	{
+		mBracketLines.assign(lineCount, BracketDepth{ 0, 0 });
+		mBracketLeaves = 0;
+		mBracketsDirtyMin = 0;
+		mBracketsDirtyMax = lineCount;
+		mBracketsMoved = std::numeric_limits<int>::max();
+	}
+	if (mBracketsDirtyMin == std::numeric_limits<int>::max() && mBracketsMoved == std::numeric_limits<int>::max())
+		return;
+
+	auto lastLine = std::min(mBracketsDirtyMax, lineCount);
+	for (int i = mBracketsDirtyMin; i < lastLine; ++i)
+	{
+		BracketDepth depth{ 0, 0 };
+		for (auto& glyph : mLines[i])
+		{
+			depth.mDelta += BracketDelta(glyph);
+			depth.mMin = std::min(depth.mMin, depth.mDelta);
+		}
+		mBracketLines[i] = depth;
+	}
+
+	// Sums are added up again above the lines that changed, and above every line from the first that moved up to the
+	// end of the text before or after, whichever is longer
+	auto leaves = 1;
+	while (leaves < lineCount)
+		leaves *= 2;
+	auto first = std::min(mBracketsDirtyMin, mBracketsMoved);
+	auto last = mBracketsMoved != std::numeric_limits<int>::max() ? std::max(lineCount, mBracketTreeLines) : lastLine;
+	if (leaves != mBracketLeaves)
+	{
+		mBracketLeaves = leaves;
+		mBracketTree.assign(2 * leaves, BracketDepth{ 0, 0 });
+		first = 0;
+		last = lineCount;
+	}
+	mBracketTreeLines = lineCount;
+
+	if (first < last)
+	{
+		for (int i = first; i < last; ++i)
+			mBracketTree[leaves + i] = i < lineCount ? mBracketLines[i] : BracketDepth{ 0, 0 };
+		for (int low = (leaves + first) / 2, high = (leaves + last - 1) / 2; low > 0; low /= 2, high /= 2)
+		{
+			for (int node = low; node <= high; ++node)
+			{
+				auto& left = mBracketTree[2 * node];
+				auto& right = mBracketTree[2 * node + 1];
+				mBracketTree[node] = BracketDepth{ left.mDelta + right.mDelta, std::min(left.mMin, left.mDelta + right.mMin) };
+			}
+		}
+	}
+
+	mBracketsDirtyMin = std::numeric_limits<int>::max();
+	mBracketsDirtyMax = 0;
+	mBracketsMoved = std::numeric_limits<int>::max();
+}
+
+// The first line from aLine on where the depth, aDepth at the start of aLine, goes below 0, or -1 if it never does.
+// aDepth is left at the start of that line. Subtrees that do not get that low are stepped over whole.
+int TextEditor::FindBracketLineForward(int aLine, int& aDepth) const
+{
+	if (aLine >= mBracketLeaves)
+		return -1;
+
+	auto node = mBracketLeaves + aLine;
+	do
+	{
+		while (node % 2 == 0)
+			node /= 2;
+		if (aDepth + mBracketTree[node].mMin < 0)
+		{
+			while (node < mBracketLeaves)
+			{
+				node *= 2;
+				if (aDepth + mBracketTree[node].mMin >= 0)
+					aDepth += mBracketTree[node++].mDelta;
+			}
+			return node - mBracketLeaves;
+		}
+		aDepth += mBracketTree[node++].mDelta;
+	} while ((node & -node) != node);
+	return -1;
+}
+
+// Same going up from the end of aLine, where closing brackets add to aDepth and opening ones take from it. What a run
+// of lines can take from the depth at its end is mDelta - mMin.
+int TextEditor::FindBracketLineBackward(int aLine, int& aDepth) const
+{
+	if (aLine < 0)
+		return -1;
+
+	auto node = mBracketLeaves + aLine + 1;
+	do
+	{
+		--node;
+		while (node > 1 && node % 2 == 1)
+			node /= 2;
+		if (aDepth - (mBracketTree[node].mDelta - mBracketTree[node].mMin) < 0)
+		{
+			while (node < mBracketLeaves)
+			{
+				node = 2 * node + 1;
+				if (aDepth - (mBracketTree[node].mDelta - mBracketTree[node].mMin) >= 0)
+					aDepth -= mBracketTree[node--].mDelta;
+			}
+			return node - mBracketLeaves;
+		}
+		aDepth -= mBracketTree[node].mDelta;
+	} while ((node & -node) != node);
+	return -1;
+}
+
+bool TextEditor::FindMatchingBracket(const Coordinates& aPosition, Coordinates& aOutBracket, Coordinates& aOutMatch) const
+{
+	if (mLines.IsMapped() || aPosition.mLine < 0 || aPosition.mLine >= (int)mLines.size())
+		return false;
+
+	// The index is only brought up to date once there is a bracket to match
+	auto lineNo = aPosition.mLine;
+	auto column = aPosition.mColumn;
+	auto* line = &mLines[lineNo];
+	if (column >= (int)line->size() || BracketDelta((*line)[column]) == 0)
+		--column;
+	if (column < 0 || column >= (int)line->size())
+		return false;
+	auto bracket = (*line)[column].mChar;
+	auto direction = BracketDelta((*line)[column]);
+	if (direction == 0)
+		return false;
+	aOutBracket = Coordinates(lineNo, column);
+	UpdateBrackets();
+
+	// Within the line first, then the line the depth gets back down on is found from the index and searched the same way
+	auto depth = 0;
+	for (;;)
+	{
+		if (direction > 0)
+		{
+			for (++column; column < (int)line->size(); ++column)
+			{
+				depth += BracketDelta((*line)[column]);
+				if (depth < 0)
+					break;
+			}
+		}
+		else
+		{
+			for (--column; column >= 0; --column)
+			{
+				depth -= BracketDelta((*line)[column]);
+				if (depth < 0)
+					break;
+			}
+		}
+		if (depth < 0)
+			break;
+
+		lineNo = direction > 0 ? FindBracketLineForward(lineNo + 1, depth) : FindBracketLineBackward(lineNo - 1, depth);
+		if (lineNo < 0 || lineNo >= (int)mLines.size())
+			return false;
+		line = &mLines[lineNo];
+		column = direction > 0 ? -1 : (int)line->size();
+	}
+
+	aOutMatch = Coordinates(lineNo, column);
+	auto match = (*line)[column].mChar;
+	return direction > 0 ? IsBracketPair(bracket, match) : IsBracketPair(match, bracket);
+}
+
+bool TextEditor::JumpToMatchingBracket(bool aSelect)
+{
+	auto jumped = false;
+	if (ForEachCursor([&]() { jumped = JumpToMatchingBracket(aSelect) || jumped; }))
+		return jumped;
+
+	Coordinates bracket, match;
+	auto oldPos = mState.mCursorPosition;
+	if (!FindMatchingBracket(oldPos, bracket, match))
+		return false;
+
+	// The cursor keeps its side: on the bracket, or just after it
+	if (bracket < oldPos)
+		++match.mColumn;
+	RevealLine(match.mLine);
+	SetCursorPosition(match);
+	if (aSelect)
+	{
+		if (oldPos == mInteractiveStart)
+			mInteractiveStart = mState.mCursorPosition;
+		else if (oldPos == mInteractiveEnd)
+			mInteractiveEnd = mState.mCursorPosition;
+		else
+		{
+			mInteractiveStart = oldPos;
+			mInteractiveEnd = mState.mCursorPosition;
+		}
+		if (mInteractiveStart > mInteractiveEnd)
+			std::swap(mInteractiveStart, mInteractiveEnd);
+	}
+	else
+		mInteractiveStart = mInteractiveEnd = mState.mCursorPosition;
+	SetSelection(mInteractiveStart, mInteractiveEnd);
+	return true;
+}
+
+bool TextEditor::SetSemanticTokens(const SemanticToken* aTokens, size_t aCount, uint32_t aTextVersion)
+{
+	if (aTextVersion != mTextVersion || mLines.IsMapped())
+		return false;
+
+	// Tokens are copied in one pass into spans and the start of every line. Out of order or overlapping tokens, and
+	// tokens on lines the text does not have, are skipped rather than trusted.
+	auto lineCount = (int)mLines.size();
+	mSemanticSpans.clear();
+	mSemanticSpans.reserve(aCount);
+	mSemanticLineStarts.assign(lineCount + 1, 0);
+	int line = 0, end = 0;
+	for (size_t i = 0; i < aCount; ++i)
+	{
+		auto& token = aTokens[i];
+		if (token.mLine < line || token.mLine >= lineCount || token.mLength <= 0 ||
+			token.mColorIndex < 0 || token.mColorIndex >= (int)PaletteIndex::Max)
+			continue;
+		if (token.mLine > line)
+		{
+			while (line < token.mLine)
+				mSemanticLineStarts[++line] = (int)mSemanticSpans.size();
+			end = 0;
+		}
+		if (token.mColumn < end)
+			continue;
+		mSemanticSpans.push_back(SemanticSpan{ token.mColumn, token.mLength, (PaletteIndex)token.mColorIndex });
+		end = token.mColumn + token.mLength;
+	}
+	while (line < lineCount)
+		mSemanticLineStarts[++line] = (int)mSemanticSpans.size();
+
+	++mStyleVersion;
+	return true;
+}
+
+void TextEditor::ClearSemanticTokens()
+{
+	if (mSemanticLineStarts.empty())
+		return;
+	mSemanticSpans.clear();
+	mSemanticLineStarts.clear();
+	++mStyleVersion;
+}
+
+void TextEditor::InvalidateSemanticTokens(int aFirstLine, int aLastLine, int aLineDelta)
+{
+	if (mSemanticLineStarts.empty())
+		return;
+	if ((int)mSemanticLineStarts.size() != mLastLineCount + 1 || aFirstLine - std::min(0, aLineDelta) > mLastLineCount)
+	{
+		ClearSemanticTokens();
+		return;
+	}
+
+	// Lines [aFirstLine, aLastLine) replaced [aFirstLine, oldLast) and start out without tokens, the spans of the lines
+	// below stay where they are relative to each other
+	auto oldLast = std::max(aFirstLine, std::min(mLastLineCount, aLastLine - aLineDelta));
+	auto newLast = std::max(aFirstLine, oldLast + aLineDelta);
+	auto first = mSemanticLineStarts[aFirstLine];
+	auto removed = mSemanticLineStarts[oldLast] - first;
+	mSemanticSpans.erase(mSemanticSpans.begin() + first, mSemanticSpans.begin() + first + removed);
+	mSemanticLineStarts.erase(mSemanticLineStarts.begin() + aFirstLine + 1, mSemanticLineStarts.begin() + oldLast + 1);
+	mSemanticLineStarts.insert(mSemanticLineStarts.begin() + aFirstLine + 1, newLast - aFirstLine, first);
+	if (removed > 0)
+		for (auto it = mSemanticLineStarts.begin() + newLast + 1; it != mSemanticLineStarts.end(); ++it)
+			*it -= removed;
+}
+
 void TextEditor::EnsureCursorVisible()
 {
+	RevealLine(GetActualCursorCoordinates().mLine);
+
 	if (!mWithinRender)
 	{
 		mScrollToCursor = true;
@@ -1578,12 +5537,15 @@ void TextEditor::EnsureCursorVisible()
 	auto right = (int)ceil((scrollX + width) / mCharAdvance.x);
 
 	auto pos = GetActualCursorCoordinates();
-	auto len = TextDistanceToLineStart(pos);
-
-	if (pos.mLine < top)
-		ImGui::SetScrollY(std::max(0.0f, (pos.mLine - 1) * mCharAdvance.y));
-	if (pos.mLine > bottom - 4)
-		ImGui::SetScrollY(std::max(0.0f, (pos.mLine + 4) * mCharAdvance.y - height));
+	int row, len;
+	GetRowPosition(pos, row, len);
+
+	if (row < top)
+		ImGui::SetScrollY(std::max(0.0f, (row - 1) * mCharAdvance.y));
+	if (row > bottom - 4)
+		ImGui::SetScrollY(std::max(0.0f, (row + 4) * mCharAdvance.y - height));
+	if (mWordWrap)
+		return;
 	if (len + cTextStart < left + 4)
 		ImGui::SetScrollX(std::max(0.0f, (len + cTextStart - 4) * mCharAdvance.x));
 	if (len + cTextStart > right - 4)
@@ -1605,12 +5567,7 @@ TextEditor::UndoRecord::UndoRecord(
 	const TextEditor::Coordinates aRemovedEnd,
 	TextEditor::EditorState& aBefore,
 	TextEditor::EditorState& aAfter)
-	: mAdded(aAdded)
-	, mAddedStart(aAddedStart)
-	, mAddedEnd(aAddedEnd)
-	, mRemoved(aRemoved)
-	, mRemovedStart(aRemovedStart)
-	, mRemovedEnd(aRemovedEnd)
+	: UndoEdit{ aAdded, aAddedStart, aAddedEnd, aRemoved, aRemovedStart, aRemovedEnd }
 	, mBefore(aBefore)
 	, mAfter(aAfter)
 {
@@ -1618,45 +5575,575 @@ TextEditor::UndoRecord::UndoRecord(
 	assert(mRemovedStart <= mRemovedEnd);
 }
 
+size_t TextEditor::UndoRecord::GetMemoryUsage() const
+{
+	auto usage = sizeof(UndoRecord) + mAdded.capacity() + mRemoved.capacity() + mMoreEdits.capacity() * sizeof(UndoEdit) +
+		(mBefore.mCursors.capacity() + mAfter.mCursors.capacity()) * sizeof(Cursor);
+	for (auto& edit : mMoreEdits)
+		usage += edit.mAdded.capacity() + edit.mRemoved.capacity();
+	return usage;
+}
+
 void TextEditor::UndoRecord::Undo(TextEditor * aEditor)
 {
-	if (!mAdded.empty())
+	// Front to back, the reverse of the order the edits were made in, so each is at the coordinates it was recorded
+	// with. The lines from the first edit to the last are colorized once.
+	int firstLine = std::numeric_limits<int>::max();
+	int lastLine = 0;
+	auto undo = [&](const UndoEdit& aEdit)
 	{
-		aEditor->DeleteRange(mAddedStart, mAddedEnd);
-		aEditor->Colorize(mAddedStart.mLine - 1, mAddedEnd.mLine - mAddedStart.mLine + 2);
-	}
+		if (!aEdit.mAdded.empty())
+		{
+			aEditor->DeleteRange(aEdit.mAddedStart, aEdit.mAddedEnd);
+			firstLine = std::min(firstLine, aEdit.mAddedStart.mLine);
+			lastLine = aEdit.mAddedStart.mLine;
+		}
 
-	if (!mRemoved.empty())
-	{
-		auto start = mRemovedStart;
-		aEditor->InsertTextAt(start, mRemoved.c_str());
-		aEditor->Colorize(mRemovedStart.mLine - 1, mRemovedEnd.mLine - mRemovedStart.mLine + 2);
-	}
+		if (!aEdit.mRemoved.empty())
+		{
+			auto start = aEdit.mRemovedStart;
+			aEditor->InsertTextAt(start, aEdit.mRemoved.c_str());
+			firstLine = std::min(firstLine, aEdit.mRemovedStart.mLine);
+			lastLine = aEdit.mRemovedEnd.mLine;
+		}
+	};
+
+	undo(*this);
+	for (auto& edit : mMoreEdits)
+		undo(edit);
+	if (firstLine <= lastLine)
+		aEditor->Colorize(firstLine - 1, lastLine - firstLine + 2);
 
 	aEditor->mState = mBefore;
 	aEditor->EnsureCursorVisible();
+}
+
+// Extends a record of typed or deleted characters with the next one, unless that one starts a new word or is not
+// adjacent to it. Only called with single character records that added or removed no newline.
+bool TextEditor::UndoRecord::Merge(const UndoRecord& aNext)
+{
+	auto isWord = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || (c & 0x80) != 0; };
+	auto startsWord = [&](char aBefore, char aAfter) { return !isWord(aBefore) && isWord(aAfter); };
+
+	if (aNext.mBefore.mCursorPosition != mAfter.mCursorPosition)
+		return false;
+
+	if (mRemoved.empty() && aNext.mRemoved.empty())
+	{
+		if (aNext.mAddedStart != mAddedEnd || startsWord(mAdded.back(), aNext.mAdded[0]))
+			return false;
+		mAdded += aNext.mAdded;
+		mAddedEnd = aNext.mAddedEnd;
+	}
+	else if (mAdded.empty() && aNext.mAdded.empty())
+	{
+		if (aNext.mRemovedEnd == mRemovedStart && !startsWord(aNext.mRemoved[0], mRemoved[0]))
+		{
+			// Backspace
+			mRemoved.insert(0, aNext.mRemoved);
+			mRemovedStart = aNext.mRemovedStart;
+		}
+		else if (aNext.mRemovedStart == mRemovedStart && !startsWord(mRemoved.back(), aNext.mRemoved[0]))
+		{
+			// Delete
+			mRemoved += aNext.mRemoved;
+			++mRemovedEnd.mColumn;
+		}
+		else
+			return false;
+	}
+	else
+		return false;
 
+	mAfter = aNext.mAfter;
+	return true;
 }
 
 void TextEditor::UndoRecord::Redo(TextEditor * aEditor)
 {
-	if (!mRemoved.empty())
+	// Back to front, as the edits were made. The first one redone is the last in the text, the others move its end
+	// by the lines they add.
+	int firstLine = std::numeric_limits<int>::max();
+	int lastLine = -1;
+	auto redo = [&](const UndoEdit& aEdit)
+	{
+		auto lines = 0;
+		if (!aEdit.mRemoved.empty())
+		{
+			aEditor->DeleteRange(aEdit.mRemovedStart, aEdit.mRemovedEnd);
+			firstLine = std::min(firstLine, aEdit.mRemovedStart.mLine);
+			lines -= aEdit.mRemovedEnd.mLine - aEdit.mRemovedStart.mLine;
+		}
+
+		if (!aEdit.mAdded.empty())
+		{
+			auto start = aEdit.mAddedStart;
+			aEditor->InsertTextAt(start, aEdit.mAdded.c_str());
+			firstLine = std::min(firstLine, aEdit.mAddedStart.mLine);
+			lines += aEdit.mAddedEnd.mLine - aEdit.mAddedStart.mLine;
+		}
+
+		if (lastLine < 0)
+			lastLine = aEdit.mAdded.empty() ? aEdit.mRemovedStart.mLine : aEdit.mAddedEnd.mLine;
+		else
+			lastLine += lines;
+	};
+
+	for (auto edit = mMoreEdits.rbegin(); edit != mMoreEdits.rend(); ++edit)
+		redo(*edit);
+	redo(*this);
+	if (firstLine <= lastLine)
+		aEditor->Colorize(firstLine - 1, lastLine - firstLine + 2);
+
+	aEditor->mState = mAfter;
+	aEditor->EnsureCursorVisible();
+}
+
+void TextEditor::KeywordTable::Build(const LanguageDefinition& aLanguageDef)
+{
+	mCaseSensitive = aLanguageDef.mCaseSensitive;
+	mEntries.clear();
+	mDisplacements.clear();
+	mSlots.clear();
+	mMask = 0;
+
+	std::unordered_map<std::string, uint8_t> merged;
+	for (auto& k : aLanguageDef.mKeywords)
+		merged[k] |= IsKeyword;
+	for (auto& k : aLanguageDef.mIdentifiers)
+		merged[k.first] |= IsKnownIdentifier;
+	for (auto& k : aLanguageDef.mPreprocIdentifiers)
+		merged[k.first] |= IsPreprocIdentifier;
+
+	for (auto& m : merged)
 	{
-		aEditor->DeleteRange(mRemovedStart, mRemovedEnd);
-		aEditor->Colorize(mRemovedStart.mLine - 1, mRemovedEnd.mLine - mRemovedStart.mLine + 1);
+		// Case insensitive languages compare against the upper-cased identifier, anything else can never match
+		bool reachable = !m.first.empty();
+		if (!mCaseSensitive)
+			for (auto c : m.first)
+				reachable &= !(c >= 'a' && c <= 'z');
+		if (reachable)
+			mEntries.push_back(Entry{ m.first, m.second });
 	}
 
-	if (!mAdded.empty())
+	if (mEntries.empty())
+		return;
+
+	std::vector<uint32_t> hashes(mEntries.size());
+	for (size_t i = 0; i < mEntries.size(); ++i)
+		hashes[i] = Hash(mEntries[i].mName.data(), mEntries[i].mName.data() + mEntries[i].mName.size());
+
+	// Place the biggest buckets first, then search a displacement for each bucket that moves all its entries into free slots
+	const uint32_t bucketCount = (uint32_t)mEntries.size() / 2 + 1;
+	std::vector<std::vector<int>> buckets(bucketCount);
+	for (size_t i = 0; i < mEntries.size(); ++i)
+		buckets[hashes[i] % bucketCount].push_back((int)i);
+	std::vector<uint32_t> order(bucketCount);
+	for (uint32_t i = 0; i < bucketCount; ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+	uint32_t size = 1;
+	while (size < mEntries.size() * 2)
+		size <<= 1;
+
+	std::vector<uint32_t> placed;
+	for (;;)
 	{
-		auto start = mAddedStart;
-		aEditor->InsertTextAt(start, mAdded.c_str());
-		aEditor->Colorize(mAddedStart.mLine - 1, mAddedEnd.mLine - mAddedStart.mLine + 1);
+		mMask = size - 1;
+		mSlots.assign(size, -1);
+		mDisplacements.assign(bucketCount, 0);
+
+		bool success = true;
+		for (auto b : order)
+		{
+			auto& bucket = buckets[b];
+			if (bucket.empty())
+				break;
+
+			bool found = false;
+			for (uint32_t d = 0; d < 1024 && !found; ++d)
+			{
+				placed.clear();
+				found = true;
+				for (auto e : bucket)
+				{
+					auto slot = Slot(hashes[e], d, mMask);
+					if (mSlots[slot] != -1 || std::find(placed.begin(), placed.end(), slot) != placed.end())
+					{
+						found = false;
+						break;
+					}
+					placed.push_back(slot);
+				}
+				if (found)
+				{
+					mDisplacements[b] = d;
+					for (size_t k = 0; k < bucket.size(); ++k)
+						mSlots[placed[k]] = bucket[k];
+				}
+			}
+
+			if (!found)
+			{
+				success = false;
+				break;
+			}
+		}
+
+		if (success)
+			break;
+		size <<= 1;
 	}
+}
 
-	aEditor->mState = mAfter;
-	aEditor->EnsureCursorVisible();
+uint8_t TextEditor::KeywordTable::Find(const char* aBegin, const char* aEnd) const
+{
+	if (mSlots.empty())
+		return 0;
+
+	auto hash = Hash(aBegin, aEnd);
+	auto index = mSlots[Slot(hash, mDisplacements[hash % (uint32_t)mDisplacements.size()], mMask)];
+	if (index < 0)
+		return 0;
+
+	auto& entry = mEntries[index];
+	if (entry.mName.size() != (size_t)(aEnd - aBegin))
+		return 0;
+
+	if (mCaseSensitive)
+		return memcmp(entry.mName.data(), aBegin, entry.mName.size()) == 0 ? entry.mFlags : 0;
+
+	for (size_t i = 0; i < entry.mName.size(); ++i)
+	{
+		char c = aBegin[i];
+		if ((c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c) != entry.mName[i])
+			return 0;
+	}
+	return entry.mFlags;
+}
+
+uint32_t TextEditor::KeywordTable::Hash(const char* aBegin, const char* aEnd) const
+{
+	// FNV-1a, folding case when the language is case insensitive
+	uint32_t hash = 2166136261u;
+	for (auto p = aBegin; p < aEnd; ++p)
+	{
+		char c = *p;
+		if (!mCaseSensitive && c >= 'a' && c <= 'z')
+			c = c - 'a' + 'A';
+		hash = (hash ^ (uint8_t)c) * 16777619u;
+	}
+	return hash;
+}
+
+uint32_t TextEditor::KeywordTable::Slot(uint32_t aHash, uint32_t aDisplacement, uint32_t aMask)
+{
+	uint32_t x = aHash ^ (aDisplacement * 0x9E3779B9u);
+	x ^= x >> 16;
+	x *= 0x85EBCA6Bu;
+	x ^= x >> 13;
+	x *= 0xC2B2AE35u;
+	x ^= x >> 16;
+	return x & aMask;
+}
+
+// Hand written equivalents of the token regular expressions used by the built-in language definitions.
+// Each returns the end of the match std::regex_search(..., match_continuous) would produce for the same
+// expression, or nullptr, so both paths colorize identically.
+
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+static inline bool IsHexDigit(char c) { return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+static inline bool IsIdentifierStart(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+static inline bool IsIdentifierChar(char c) { return IsIdentifierStart(c) || IsDigit(c); }
+static inline bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+// "//.*" or "\-\-.*" ('.' stops at line terminators)
+static const char* MatchLineComment(const char* p, const char* end, char aFirst, char aSecond)
+{
+	if (p + 1 >= end || p[0] != aFirst || p[1] != aSecond)
+		return nullptr;
+	p += 2;
+	while (p < end && *p != '\n' && *p != '\r')
+		++p;
+	return p;
+}
+
+// "[ \t]*#[ \t]*[a-zA-Z_]+"
+static const char* MatchPreprocessor(const char* p, const char* end)
+{
+	while (p < end && IsBlank(*p))
+		++p;
+	if (p >= end || *p != '#')
+		return nullptr;
+	++p;
+	while (p < end && IsBlank(*p))
+		++p;
+	auto start = p;
+	while (p < end && (IsIdentifierStart(*p)))
+		++p;
+	return p > start ? p : nullptr;
+}
+
+// "L?\"(\\.|[^\"])*\""
+static const char* MatchCStyleString(const char* p, const char* end)
+{
+	if (p < end && *p == 'L')
+		++p;
+	if (p >= end || *p != '\"')
+		return nullptr;
+	++p;
+
+	// Greedy pass, which is also the first path the backtracking matcher explores
+	for (auto s = p; s < end;)
+	{
+		if (*s == '\\' && s + 1 < end && s[1] != '\n' && s[1] != '\r')
+			s += 2;
+		else if (*s == '\"')
+			return s + 1;
+		else
+			++s;
+	}
+
+	// Unterminated: every quote was taken as escaped. The regex backtracks into the escapes right to left, and the first
+	// one that leaves a closing quote behind it is the escape of the last quote, so the match ends there if there is one.
+	for (auto s = end; s > p;)
+		if (*--s == '\"')
+			return s + 1;
+	return nullptr;
+}
+
+// "\'\\?[^\']\'"
+static const char* MatchCharLiteral(const char* p, const char* end)
+{
+	if (p >= end || *p != '\'')
+		return nullptr;
+	if (p + 3 < end && p[1] == '\\' && p[2] != '\'' && p[3] == '\'')
+		return p + 4;
+	if (p + 2 < end && p[1] != '\'' && p[2] == '\'')
+		return p + 3;
+	return nullptr;
+}
+
+// "\'[^\']*\'"
+static const char* MatchSingleQuotedString(const char* p, const char* end)
+{
+	if (p >= end || *p != '\'')
+		return nullptr;
+	for (++p; p < end; ++p)
+		if (*p == '\'')
+			return p + 1;
+	return nullptr;
+}
+
+// "[uU]?[lL]?[lL]?"
+static const char* MatchIntegerSuffix(const char* p, const char* end)
+{
+	if (p < end && (*p == 'u' || *p == 'U'))
+		++p;
+	if (p < end && (*p == 'l' || *p == 'L'))
+		++p;
+	if (p < end && (*p == 'l' || *p == 'L'))
+		++p;
+	return p;
+}
+
+// "0[xX][0-9a-fA-F]+[uU]?[lL]?[lL]?"
+static const char* MatchHexNumber(const char* p, const char* end)
+{
+	if (p + 2 >= end || p[0] != '0' || (p[1] != 'x' && p[1] != 'X') || !IsHexDigit(p[2]))
+		return nullptr;
+	p += 3;
+	while (p < end && IsHexDigit(*p))
+		++p;
+	return MatchIntegerSuffix(p, end);
+}
+
+// "0[0-7]+[Uu]?[lL]?[lL]?"
+static const char* MatchOctalNumber(const char* p, const char* end)
+{
+	if (p + 1 >= end || p[0] != '0' || p[1] < '0' || p[1] > '7')
+		return nullptr;
+	p += 2;
+	while (p < end && *p >= '0' && *p <= '7')
+		++p;
+	return MatchIntegerSuffix(p, end);
+}
+
+// "[+-]?[0-9]+[Uu]?[lL]?[lL]?"
+static const char* MatchIntegerNumber(const char* p, const char* end)
+{
+	if (p < end && (*p == '+' || *p == '-'))
+		++p;
+	if (p >= end || !IsDigit(*p))
+		return nullptr;
+	while (p < end && IsDigit(*p))
+		++p;
+	return MatchIntegerSuffix(p, end);
+}
+
+// "[+-]?([0-9]+([.][0-9]*)?|[.][0-9]+)([eE][+-]?[0-9]+)?[fF]?"
+static const char* MatchFloatNumber(const char* p, const char* end)
+{
+	if (p < end && (*p == '+' || *p == '-'))
+		++p;
+
+	if (p < end && IsDigit(*p))
+	{
+		while (p < end && IsDigit(*p))
+			++p;
+		if (p < end && *p == '.')
+		{
+			++p;
+			while (p < end && IsDigit(*p))
+				++p;
+		}
+	}
+	else if (p + 1 < end && *p == '.' && IsDigit(p[1]))
+	{
+		p += 2;
+		while (p < end && IsDigit(*p))
+			++p;
+	}
+	else
+		return nullptr;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		auto e = p + 1;
+		if (e < end && (*e == '+' || *e == '-'))
+			++e;
+		if (e < end && IsDigit(*e))
+		{
+			while (e < end && IsDigit(*e))
+				++e;
+			p = e;
+		}
+	}
+
+	if (p < end && (*p == 'f' || *p == 'F'))
+		++p;
+	return p;
+}
+
+// "[a-zA-Z_][a-zA-Z0-9_]*"
+static const char* MatchIdentifier(const char* p, const char* end)
+{
+	if (p >= end || !IsIdentifierStart(*p))
+		return nullptr;
+	++p;
+	while (p < end && IsIdentifierChar(*p))
+		++p;
+	return p;
+}
+
+// "[\[\]\{\}\!\%\^\&\*\(\)\-\+\=\~\|\<\>\?\/\;\,\.]"
+static const char* MatchPunctuation(const char* p, const char* end)
+{
+	if (p >= end)
+		return nullptr;
+	switch (*p)
+	{
+	case '[': case ']': case '{': case '}': case '!': case '%': case '^': case '&': case '*': case '(': case ')':
+	case '-': case '+': case '=': case '~': case '|': case '<': case '>': case '?': case '/': case ';': case ',': case '.':
+		return p + 1;
+	default:
+		return nullptr;
+	}
+}
+
+#define TOKENIZE_TRY(MATCH, COLOR) \
+	if (auto tokenEnd = (MATCH)) \
+	{ \
+		aOutBegin = aInBegin; \
+		aOutEnd = tokenEnd; \
+		aPaletteIndex = COLOR; \
+		return true; \
+	}
+
+// Leading blanks only ever match as part of a preprocessor directive, if that fails skip the whole run at once
+#define TOKENIZE_TRY_PREPROCESSOR() \
+	TOKENIZE_TRY(MatchPreprocessor(aInBegin, aInEnd), PaletteIndex::Preprocessor) \
+	if (IsBlank(*aInBegin)) \
+	{ \
+		aOutBegin = aInBegin; \
+		aOutEnd = aInBegin; \
+		while (aOutEnd < aInEnd && IsBlank(*aOutEnd)) \
+			++aOutEnd; \
+		aPaletteIndex = PaletteIndex::Default; \
+		return true; \
+	}
+
+// Shared by C, HLSL and GLSL, which list the float expression first: it shadows the integer, octal and hex ones
+static bool TokenizeCStyle(const char* aInBegin, const char* aInEnd, const char*& aOutBegin, const char*& aOutEnd, TextEditor::PaletteIndex& aPaletteIndex)
+{
+	typedef TextEditor::PaletteIndex PaletteIndex;
+	TOKENIZE_TRY(MatchLineComment(aInBegin, aInEnd, '/', '/'), PaletteIndex::Comment)
+	TOKENIZE_TRY_PREPROCESSOR()
+	TOKENIZE_TRY(MatchCStyleString(aInBegin, aInEnd), PaletteIndex::String)
+	TOKENIZE_TRY(MatchCharLiteral(aInBegin, aInEnd), PaletteIndex::CharLiteral)
+	TOKENIZE_TRY(MatchFloatNumber(aInBegin, aInEnd), PaletteIndex::Number)
+	TOKENIZE_TRY(MatchIdentifier(aInBegin, aInEnd), PaletteIndex::Identifier)
+	TOKENIZE_TRY(MatchPunctuation(aInBegin, aInEnd), PaletteIndex::Punctuation)
+	return false;
+}
+
+static bool TokenizeCPlusPlus(const char* aInBegin, const char* aInEnd, const char*& aOutBegin, const char*& aOutEnd, TextEditor::PaletteIndex& aPaletteIndex)
+{
+	typedef TextEditor::PaletteIndex PaletteIndex;
+	TOKENIZE_TRY(MatchLineComment(aInBegin, aInEnd, '/', '/'), PaletteIndex::Comment)
+	TOKENIZE_TRY_PREPROCESSOR()
+	TOKENIZE_TRY(MatchCStyleString(aInBegin, aInEnd), PaletteIndex::String)
+	TOKENIZE_TRY(MatchCharLiteral(aInBegin, aInEnd), PaletteIndex::CharLiteral)
+	TOKENIZE_TRY(MatchHexNumber(aInBegin, aInEnd), PaletteIndex::Number)
+	TOKENIZE_TRY(MatchFloatNumber(aInBegin, aInEnd), PaletteIndex::Number)
+	TOKENIZE_TRY(MatchOctalNumber(aInBegin, aInEnd), PaletteIndex::Number)
+	TOKENIZE_TRY(MatchIntegerNumber(aInBegin, aInEnd), PaletteIndex::Number)
+	TOKENIZE_TRY(MatchIdentifier(aInBegin, aInEnd), PaletteIndex::Identifier)
+	TOKENIZE_TRY(MatchPunctuation(aInBegin, aInEnd), PaletteIndex::Punctuation)
+	return false;
+}
+
+static bool TokenizeSQL(const char* aInBegin, const char* aInEnd, const char*& aOutBegin, const char*& aOutEnd, TextEditor::PaletteIndex& aPaletteIndex)
+{
+	typedef TextEditor::PaletteIndex PaletteIndex;
+	TOKENIZE_TRY(MatchLineComment(aInBegin, aInEnd, '-', '-'), PaletteIndex::Comment)
+	TOKENIZE_TRY(MatchCStyleString(aInBegin, aInEnd), PaletteIndex::String)
+	TOKENIZE_TRY(MatchSingleQuotedString(aInBegin, aInEnd), PaletteIndex::String)
+	TOKENIZE_TRY(MatchFloatNumber(aInBegin, aInEnd), PaletteIndex::Number)
+	TOKENIZE_TRY(MatchIdentifier(aInBegin, aInEnd), PaletteIndex::Identifier)
+	TOKENIZE_TRY(MatchPunctuation(aInBegin, aInEnd), PaletteIndex::Punctuation)
+	return false;
+}
+
+static bool TokenizeAngelScript(const char* aInBegin, const char* aInEnd, const char*& aOutBegin, const char*& aOutEnd, TextEditor::PaletteIndex& aPaletteIndex)
+{
+	typedef TextEditor::PaletteIndex PaletteIndex;
+	TOKENIZE_TRY(MatchLineComment(aInBegin, aInEnd, '/', '/'), PaletteIndex::Comment)
+	TOKENIZE_TRY(MatchCStyleString(aInBegin, aInEnd), PaletteIndex::String)
+	TOKENIZE_TRY(MatchCharLiteral(aInBegin, aInEnd), PaletteIndex::String)
+	TOKENIZE_TRY(MatchFloatNumber(aInBegin, aInEnd), PaletteIndex::Number)
+	TOKENIZE_TRY(MatchIdentifier(aInBegin, aInEnd), PaletteIndex::Identifier)
+	TOKENIZE_TRY(MatchPunctuation(aInBegin, aInEnd), PaletteIndex::Punctuation)
+	return false;
 }
 
+static bool TokenizeLua(const char* aInBegin, const char* aInEnd, const char*& aOutBegin, const char*& aOutEnd, TextEditor::PaletteIndex& aPaletteIndex)
+{
+	typedef TextEditor::PaletteIndex PaletteIndex;
+	TOKENIZE_TRY(MatchLineComment(aInBegin, aInEnd, '-', '-'), PaletteIndex::Comment)
+	TOKENIZE_TRY(MatchCStyleString(aInBegin, aInEnd), PaletteIndex::String)
+	TOKENIZE_TRY(MatchSingleQuotedString(aInBegin, aInEnd), PaletteIndex::String)
+	TOKENIZE_TRY(MatchHexNumber(aInBegin, aInEnd), PaletteIndex::Number)
+	TOKENIZE_TRY(MatchFloatNumber(aInBegin, aInEnd), PaletteIndex::Number)
+	TOKENIZE_TRY(MatchIdentifier(aInBegin, aInEnd), PaletteIndex::Identifier)
+	TOKENIZE_TRY(MatchPunctuation(aInBegin, aInEnd), PaletteIndex::Punctuation)
+	return false;
+}
+
+#undef TOKENIZE_TRY
+#undef TOKENIZE_TRY_PREPROCESSOR
+
 TextEditor::LanguageDefinition TextEditor::LanguageDefinition::CPlusPlus()
 {
 	static bool inited = false;
@@ -1700,8 +6187,10 @@ TextEditor::LanguageDefinition TextEditor::LanguageDefinition::CPlusPlus()
 		langDef.mCommentEnd = "*/";
 
 		langDef.mCaseSensitive = true;
+		langDef.mFoldMode = FoldMode::Braces;
 
 		langDef.mName = "C++";
+		langDef.mTokenize = TokenizeCPlusPlus;
 
 		inited = true;
 	}
@@ -1771,8 +6260,10 @@ TextEditor::LanguageDefinition TextEditor::LanguageDefinition::HLSL()
 		langDef.mCommentEnd = "*/";
 
 		langDef.mCaseSensitive = true;
+		langDef.mFoldMode = FoldMode::Braces;
 
 		langDef.mName = "HLSL";
+		langDef.mTokenize = TokenizeCStyle;
 
 		inited = true;
 	}
@@ -1819,8 +6310,10 @@ TextEditor::LanguageDefinition TextEditor::LanguageDefinition::GLSL()
 		langDef.mCommentEnd = "*/";
 
 		langDef.mCaseSensitive = true;
+		langDef.mFoldMode = FoldMode::Braces;
 
 		langDef.mName = "GLSL";
+		langDef.mTokenize = TokenizeCStyle;
 
 		inited = true;
 	}
@@ -1867,8 +6360,10 @@ TextEditor::LanguageDefinition TextEditor::LanguageDefinition::C()
 		langDef.mCommentEnd = "*/";
 
 		langDef.mCaseSensitive = true;
+		langDef.mFoldMode = FoldMode::Braces;
 
 		langDef.mName = "C";
+		langDef.mTokenize = TokenizeCStyle;
 
 		inited = true;
 	}
@@ -1932,6 +6427,7 @@ TextEditor::LanguageDefinition TextEditor::LanguageDefinition::SQL()
 		langDef.mCaseSensitive = false;
 
 		langDef.mName = "SQL";
+		langDef.mTokenize = TokenizeSQL;
 
 		inited = true;
 	}
@@ -1979,8 +6475,10 @@ TextEditor::LanguageDefinition TextEditor::LanguageDefinition::AngelScript()
 		langDef.mCommentEnd = "*/";
 
 		langDef.mCaseSensitive = true;
+		langDef.mFoldMode = FoldMode::Braces;
 
 		langDef.mName = "AngelScript";
+		langDef.mTokenize = TokenizeAngelScript;
 
 		inited = true;
 	}
@@ -2028,12 +6526,14 @@ TextEditor::LanguageDefinition TextEditor::LanguageDefinition::Lua()
 		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[a-zA-Z_][a-zA-Z0-9_]*", PaletteIndex::Identifier));
 		langDef.mTokenRegexStrings.push_back(std::make_pair<std::string, PaletteIndex>("[\\[\\]\\{\\}\\!\\%\\^\\&\\*\\(\\)\\-\\+\\=\\~\\|\\<\\>\\?\\/\\;\\,\\.]", PaletteIndex::Punctuation));
 
-		langDef.mCommentStart = "\\-\\-\\[\\[";
-		langDef.mCommentEnd = "\\]\\]";
+		langDef.mCommentStart = "--[[";
+		langDef.mCommentEnd = "]]";
 
 		langDef.mCaseSensitive = true;
+		langDef.mFoldMode = FoldMode::Indentation;
 
 		langDef.mName = "Lua";
+		langDef.mTokenize = TokenizeLua;
 
 		inited = true;
 	}
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <array>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <unordered_set>
 #include <unordered_map>
@@ -36,6 +39,8 @@ public:
 		CurrentLineFill,
 		CurrentLineFillInactive,
 		CurrentLineEdge,
+		FindHighlight,
+		MatchingBracket,
 		Max
 	};
 
@@ -128,13 +133,104 @@ public:
 		Glyph(Char aChar, PaletteIndex aColorIndex) : mChar(aChar), mColorIndex(aColorIndex), mMultiLineComment(false) {}
 	};
 
-	typedef std::vector<Glyph> Line;
-	typedef std::vector<Line> Lines;
+	// Lexer state carried from the end of one line into the next
+	enum class LexerState : uint8_t
+	{
+		Default,
+		MultiLineComment,
+	};
+
+	// Glyphs plus the lexer state at the end of the line, so colorizing can restart at any line after an edit
+	// and stop as soon as a line ends in the same state as before. mVersion changes whenever the text or colors
+	// of the line do (see Lines::Touch), which is what cached render data is checked against.
+	struct Line : public std::vector<Glyph>
+	{
+		LexerState mEndState;
+		uint32_t mVersion;
+
+		Line() : mEndState(LexerState::Default), mVersion(0) {}
+	};
+
+	// The document's lines, stored in chunks of at most cChunkLines with the index of each chunk's first line. Inserting
+	// or removing a line only moves the lines of its own chunk and bumps the starts of the chunks after it, where a flat
+	// vector moved every line below the edit. Indexed like the vector it replaces.
+	//
+	// A mapped file is read-only: only a newline index is built up front, chunks are turned into (colorized) glyphs on
+	// first access and dropped again by Trim. The loaded chunks are a cache of the UI thread, which even const access
+	// fills, so whatever reads the whole document reads the mapping instead (GetMappedText, GetMappedLine).
+	class Lines
+	{
+	public:
+		enum { cChunkLines = 1024, cMaxLoadedChunks = 16 };
+
+		Lines() : mSize(0), mLastChunk(0), mColorizer(nullptr), mVersionCounter(0) {}
+
+		size_t size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		void clear();
+
+		Line& operator[](size_t aIndex) { return const_cast<Line&>(static_cast<const Lines&>(*this)[aIndex]); }
+		const Line& operator[](size_t aIndex) const
+		{
+			auto chunk = FindChunk((int)aIndex);
+			if (mChunks[chunk].empty())
+				Load(chunk);
+			return mChunks[chunk][aIndex - mChunkStarts[chunk]];
+		}
+		Line& back() { return (*this)[mSize - 1]; }
+
+		void push_back(Line&& aLine);
+		Line& insert(int aIndex, Line&& aLine);
+		void insert(int aIndex, std::vector<Line>&& aLines);
+		void erase(int aFirst, int aLast);
+		void Touch(Line& aLine) const { aLine.mVersion = ++mVersionCounter; }
+
+		bool Map(const char* aPath, const TextEditor* aColorizer);
+		bool IsMapped() const { return mFile != nullptr; }
+		const char* GetMappedText(size_t& aSize) const;
+		std::shared_ptr<const char> ShareMappedText(size_t& aSize) const;	// keeps the mapping alive, e.g. for a worker
+		const char* GetMappedLine(int aIndex, size_t& aSize) const;
+		void Trim(int aFirstLine, int aLastLine);	// keeps the chunks of these lines and the most recently loaded ones
+		void Unload();
+
+	private:
+		class MappedFile;
+
+		int FindChunk(int aIndex) const
+		{
+			// Consecutive lookups nearly always land in the same chunk
+			auto chunk = mLastChunk;
+			if (chunk >= (int)mChunks.size() || aIndex < mChunkStarts[chunk] || aIndex >= mChunkStarts[chunk] + (int)mChunks[chunk].size())
+			{
+				chunk = std::max(0, (int)(std::upper_bound(mChunkStarts.begin(), mChunkStarts.end(), aIndex) - mChunkStarts.begin()) - 1);
+				mLastChunk = chunk;
+			}
+			return chunk;
+		}
+		void UpdateStarts(int aFromChunk);
+		void Load(int aChunk) const;
+		void ColorizeChunks(int aChunk, LexerState aState) const;
+
+		mutable std::vector<std::vector<Line>> mChunks;	// only mutable for the mapped file, which loads on access
+		std::vector<int> mChunkStarts;
+		size_t mSize;
+		mutable int mLastChunk;
+
+		std::shared_ptr<MappedFile> mFile;
+		std::vector<uint64_t> mNewlines;	// offset of every '\n' in the mapped file
+		const TextEditor* mColorizer;
+		mutable std::vector<int> mLoadedChunks;	// oldest first
+		mutable std::vector<LexerState> mChunkStartStates;
+		mutable std::string mColorizeBuffer;
+		mutable uint32_t mVersionCounter;
+	};
 
 	struct LanguageDefinition
 	{
 		typedef std::pair<std::string, PaletteIndex> TokenRegexString;
 		typedef std::vector<TokenRegexString> TokenRegexStrings;
+		// Matches a single token starting at aInBegin, returns false if nothing matches there.
+		typedef bool (*TokenizeCallback)(const char* aInBegin, const char* aInEnd, const char*& aOutBegin, const char*& aOutEnd, PaletteIndex& aPaletteIndex);
 
 		std::string mName;
 		Keywords mKeywords;
@@ -143,9 +239,17 @@ public:
 		std::string mCommentStart, mCommentEnd;
 
 		TokenRegexStrings mTokenRegexStrings;
+		TokenizeCallback mTokenize;		// when set, used instead of mTokenRegexStrings
 
 		bool mCaseSensitive;
 
+		// Where fold regions are: between matching braces (in code, not comments or strings), or under a line indented
+		// less than the lines that follow it
+		enum class FoldMode : uint8_t { None, Braces, Indentation };
+		FoldMode mFoldMode;
+
+		LanguageDefinition() : mTokenize(nullptr), mCaseSensitive(true), mFoldMode(FoldMode::None) {}
+
 		static LanguageDefinition CPlusPlus();
 		static LanguageDefinition HLSL();
 		static LanguageDefinition GLSL();
@@ -169,14 +273,90 @@ public:
 
 	void Render(const char* aTitle, const ImVec2& aSize = ImVec2(), bool aBorder = false);
 	void SetText(const std::string& aText);
+	// Shows a file read-only without reading it in: the file is memory mapped and only the lines being looked at are
+	// turned into glyphs and colorized. Returns false if the file cannot be mapped. SetText leaves this mode.
+	bool OpenFileView(const char* aPath);
+	bool IsFileView() const { return mLines.IsMapped(); }
 	std::string GetText() const;
 	std::string GetSelectedText() const;
 
+	// Text streamed through a fixed size buffer, so large files are loaded and saved without a copy of the whole text.
+	// The reader returns the number of bytes it filled in, 0 at the end; the writer returns false to stop.
+	typedef size_t (*ReadCallback)(void* aUserData, char* aBuffer, size_t aSize);
+	typedef bool (*WriteCallback)(void* aUserData, const char* aData, size_t aSize);
+	void ReadText(ReadCallback aRead, void* aUserData);
+	bool WriteText(WriteCallback aWrite, void* aUserData) const;
+	bool LoadFile(const char* aPath);
+	bool SaveFile(const char* aPath) const;
+
+	// Log tail: text is added at the end of the document and only the new lines are colorized. The view keeps following
+	// the end while it is scrolled to the bottom. PostText may be called from any thread, the text is added by the next
+	// Render. With a line limit the oldest lines are dropped, a chunk of them at a time, once there are more; that also
+	// forgets the undo history.
+	void AppendText(const char* aBegin, const char* aEnd);
+	void AppendText(const std::string& aText) { AppendText(aText.data(), aText.data() + aText.size()); }
+	void PostText(std::string aText);
+	void SetLineLimit(int aLimit) { mLineLimit = std::max(0, aLimit); }	// 0 keeps every line
+	int GetLineLimit() const { return mLineLimit; }
+
 	int GetTotalLines() const { return (int)mLines.size(); }
+	// Read access for views that draw a document themselves, such as TextDiff. UpdateColors does the colorizing Render
+	// would, for a document that is not rendered.
+	const Line& GetLine(int aLineNo) const { return mLines[aLineNo]; }
+	int GetTabSize() const { return mTabSize; }
+	void UpdateColors();
 	bool IsOverwrite() const { return mOverwrite; }
 
 	void SetReadOnly(bool aValue);
-	bool IsReadOnly() const { return mReadOnly; }
+	bool IsReadOnly() const { return mReadOnly || mLines.IsMapped(); }
+
+	// Soft wrap: lines wider than the window continue on the rows below instead of scrolling horizontally, breaking
+	// after a blank where there is one. Up and down then move by screen rows.
+	void SetWordWrap(bool aValue);
+	bool IsWordWrap() const { return mWordWrap; }
+
+	// Folding a region hides all its lines but the first: up to the line before the closing brace, or the lines
+	// indented deeper, depending on the language. Regions are found again as the text changes, one stays folded while
+	// a region starts on its first line. Hidden lines take no rows, the cursor steps over them.
+	struct FoldRegion
+	{
+		int mStart;	// the line left visible
+		int mEnd;	// the last line hidden
+		bool mFolded;
+	};
+
+	std::vector<FoldRegion> GetFoldRegions() const;	// ordered by start, outermost first
+	bool Fold(int aLine, bool aFolded = true);	// the region starting at aLine, false if there is none
+	bool ToggleFold(int aLine);
+	void FoldAll(bool aFolded = true);
+	bool IsLineHidden(int aLine) const;
+
+	// Identifiers in the text are indexed as lines are colorized. GetCompletions returns the ones starting with aPrefix
+	// in order. With auto complete on, typing an identifier shows them below the cursor: up and down pick one, tab or
+	// enter takes it, escape closes the list.
+	std::vector<std::string> GetCompletions(const std::string& aPrefix, size_t aMax = 16) const;
+	void SetAutoComplete(bool aValue);
+	bool IsAutoComplete() const { return mAutoComplete; }
+
+	// Brackets outside comments and strings are indexed by nesting depth as lines are colorized, so the match of one is
+	// found without scanning the text between them. FindMatchingBracket looks at the bracket at aPosition, or else the
+	// one just before it. The bracket at the cursor and its match are outlined, ctrl+] moves the cursor to the match.
+	bool FindMatchingBracket(const Coordinates& aPosition, Coordinates& aOutBracket, Coordinates& aOutMatch) const;
+	bool JumpToMatchingBracket(bool aSelect = false);
+
+	// Colors worked out outside the editor, e.g. by a language server, drawn over the lexer's. Tokens are sorted by line
+	// then column, columns and lengths count glyphs as Coordinates do. They are only taken for the text version they
+	// were computed from. Edits drop the tokens of the lines they re-colorize, the others move along with their lines.
+	struct SemanticToken
+	{
+		int mLine;
+		int mColumn;
+		int mLength;
+		int mColorIndex;	// a PaletteIndex, an int so the layout is the same everywhere
+	};
+	uint32_t GetTextVersion() const { return mTextVersion; }
+	bool SetSemanticTokens(const SemanticToken* aTokens, size_t aCount, uint32_t aTextVersion);
+	void ClearSemanticTokens();
 
 	Coordinates GetCursorPosition() const { return GetActualCursorCoordinates(); }
 	void SetCursorPosition(const Coordinates& aPosition);
@@ -193,6 +373,15 @@ public:
 	void MoveHome(bool aSelect = false);
 	void MoveEnd(bool aSelect = false);
 
+	// More cursors besides the one above: alt+click adds one, alt+drag selects a column (the same columns on every line
+	// it spans), ctrl+alt+up or down adds one on the row above or below, escape leaves only the first. Moving, typing,
+	// deleting, cut, copy and paste work at every cursor, each edit as a single change and undo step. A paste of as
+	// many lines as there are cursors puts one line at each.
+	void AddCursor(const Coordinates& aPosition);
+	void SetColumnSelection(const Coordinates& aStart, const Coordinates& aEnd);
+	void ClearExtraCursors();
+	int GetCursorCount() const { return 1 + (int)mState.mCursors.size(); }
+
 	void SetSelectionStart(const Coordinates& aPosition);
 	void SetSelectionEnd(const Coordinates& aPosition);
 	void SetSelection(const Coordinates& aStart, const Coordinates& aEnd, bool awordmode = false);
@@ -205,11 +394,34 @@ public:
 	void Paste();
 	void Delete();
 
+	// Find and replace, matches never span lines. Literal searches scan each line for the first byte with memchr and
+	// verify the rest there, regular expressions (ECMAScript) are matched with std::regex. FindAll highlights every match
+	// and keeps them current as the text changes, searching only the lines an edit changed; for regular expressions it runs
+	// on a worker thread.
+	struct FindResult
+	{
+		Coordinates mStart;
+		Coordinates mEnd;
+	};
+
+	bool FindNext(const std::string& aWhat, bool aRegex = false, bool aCaseSensitive = true, bool aBackwards = false);
+	bool FindAll(const std::string& aWhat, bool aRegex = false, bool aCaseSensitive = true);	// false if the expression is invalid
+	void ClearFind();
+	bool IsFindPending() const;
+	const std::vector<FindResult>& GetFindResults() const { return mFindResults; }
+	bool Replace(const std::string& aWhat, const std::string& aWith, bool aRegex = false, bool aCaseSensitive = true);
+	int ReplaceAll(const std::string& aWhat, const std::string& aWith, bool aRegex = false, bool aCaseSensitive = true);	// a single undo step
+
 	bool CanUndo() const;
 	bool CanRedo() const;
 	void Undo(int aSteps = 1);
 	void Redo(int aSteps = 1);
 
+	// Undo history is kept under this many bytes by dropping the oldest records, the newest one is always kept
+	void SetUndoMemoryLimit(size_t aBytes);
+	size_t GetUndoMemoryLimit() const { return mUndoMemoryLimit; }
+	size_t GetUndoMemoryUsage() const { return mUndoMemory; }
+
 	static const Palette& GetDarkPalette();
 	static const Palette& GetLightPalette();
 	static const Palette& GetRetroBluePalette();
@@ -217,14 +429,249 @@ public:
 private:
 	typedef std::vector<std::pair<std::regex, PaletteIndex>> RegexList;
 
-	struct EditorState
+	// Background colorizer thread, defined in TextEditor.cpp so this header stays free of <thread> and <atomic> (it is included from /clr code)
+	class ColorizeWorker;
+	class FindWorker;
+
+	struct FindQuery
+	{
+		std::string mWhat;
+		bool mRegex;
+		bool mCaseSensitive;
+
+		FindQuery() : mRegex(false), mCaseSensitive(true) {}
+		FindQuery(const std::string& aWhat, bool aRegex, bool aCaseSensitive) : mWhat(aWhat), mRegex(aRegex), mCaseSensitive(aCaseSensitive) {}
+	};
+
+	// A compiled FindQuery, finds the matches within the text of one line
+	class FindMatcher
+	{
+	public:
+		explicit FindMatcher(const FindQuery& aQuery);
+
+		bool IsValid() const { return mValid; }
+		void Match(const char* aText, size_t aSize, std::vector<std::pair<int, int>>& aOut) const;
+		std::string Format(const char* aText, size_t aSize, int aBegin, const std::string& aWith) const;
+
+	private:
+		FindQuery mQuery;
+		bool mValid;
+		std::regex mRegex;
+		mutable std::string mLowerCase;
+	};
+
+	// Keywords, known identifiers and preprocessor identifiers of the language merged into a single perfect hash
+	// (hash and displace), so classifying an identifier is one hash, one slot and one compare straight off the line buffer.
+	class KeywordTable
+	{
+	public:
+		enum Flags : uint8_t
+		{
+			IsKeyword = 1 << 0,
+			IsKnownIdentifier = 1 << 1,
+			IsPreprocIdentifier = 1 << 2,
+		};
+
+		KeywordTable() : mMask(0), mCaseSensitive(true) {}
+
+		void Build(const LanguageDefinition& aLanguageDef);
+		uint8_t Find(const char* aBegin, const char* aEnd) const;
+
+	private:
+		struct Entry
+		{
+			std::string mName;
+			uint8_t mFlags;
+		};
+
+		uint32_t Hash(const char* aBegin, const char* aEnd) const;
+		static uint32_t Slot(uint32_t aHash, uint32_t aDisplacement, uint32_t aMask);
+
+		std::vector<Entry> mEntries;
+		std::vector<uint32_t> mDisplacements;
+		std::vector<int> mSlots;
+		uint32_t mMask;
+		bool mCaseSensitive;
+	};
+
+	// Every identifier in the text with the number of times it occurs. Words are found by hash without building a
+	// string, and by prefix in an array of them ordered by word. Ids stay valid until Clear: a word that no longer
+	// occurs keeps its entry, with a count of 0, and gets it back if it is added again.
+	class IdentifierIndex
+	{
+	public:
+		int Add(const char* aBegin, const char* aEnd);	// returns the id of the word
+		void Release(int aId) { --mEntries[aId].mCount; }
+		int Find(const char* aBegin, const char* aEnd) const;	// -1 if there is no entry
+		void FindPrefix(const char* aBegin, const char* aEnd, size_t aMax, std::vector<int>& aOut) const;
+		const std::string& GetWord(int aId) const { return mEntries[aId].mWord; }
+		void Clear();
+
+	private:
+		struct Entry
+		{
+			std::string mWord;
+			uint32_t mHash;
+			int mCount;
+		};
+
+		static uint32_t Hash(const char* aBegin, const char* aEnd);
+		size_t Probe(uint32_t aHash, const char* aBegin, const char* aEnd) const;	// the slot of the word, or the empty one it goes in
+		void Merge() const;
+
+		std::vector<Entry> mEntries;
+		std::vector<int> mSlots;	// ids by hash, linear probing, at most half full
+		mutable std::vector<int> mSorted;	// ids ordered by word
+		mutable std::vector<int> mUnsorted;	// ids added since, searched one by one until there are enough to merge in
+	};
+
+	// Quads of a visible line built once against the font and palette, so later frames only copy them into the draw list
+	struct RenderQuad
+	{
+		float mCellX;	// left edge of the character cell, increases along the line
+		ImVec2 mMin, mMax;	// relative to the start of the line
+		ImVec2 mUVMin, mUVMax;
+		ImU32 mColor;
+	};
+
+	// Only the text between mFirstColumn and mLastColumn (distances from the line start) gets quads, long lines are
+	// rebuilt for a new window when scrolled horizontally
+	struct LineRenderCache
+	{
+		int mLine;
+		uint32_t mLineVersion;
+		uint32_t mStyleVersion;
+		int mFirstColumn, mLastColumn;
+		int mWidth;	// in columns, tabs expanded
+		std::vector<RenderQuad> mQuads;	// line number first then the text, ordered left to right
+
+		LineRenderCache() : mLine(-1), mLineVersion(0), mStyleVersion(0), mFirstColumn(0), mLastColumn(0), mWidth(0) {}
+	};
+
+	// Distance from the line start at every cColumnBlock-th glyph of a long line, so converting between glyph index
+	// and distance walks at most one block instead of the whole line
+	struct ColumnIndex
+	{
+		int mLine;
+		uint32_t mLineVersion;
+		std::vector<int> mBlockDistances;
+
+		ColumnIndex() : mLine(-1), mLineVersion(0) {}
+	};
+
+	// Where the rows of a wrapped line start, as glyph indices and as distances from the line start, the first one at 0
+	struct LineWrap
+	{
+		int mLine;
+		uint32_t mLineVersion;
+		int mColumns;	// wrap width
+		std::vector<int> mGlyphs;
+		std::vector<int> mDistances;
+
+		LineWrap() : mLine(-1), mLineVersion(0), mColumns(0) {}
+	};
+
+	// A fold region as found, mEnd is -1 until the region is closed and at most mStart if there is nothing to hide
+	struct FoldRange
+	{
+		int mStart;
+		int mEnd;
+	};
+
+	// Fold ranges ordered by start, laid out as an implicit balanced tree (the middle of every range of them is its
+	// root) with the largest end under every node, so the ranges containing a line are found without a linear scan
+	class FoldTree
+	{
+	public:
+		void Build();
+		void Update(int aRange);	// after the end of a range changed
+		void MoveLines(int aFirstLine, int aLastLine, int aLineDelta);	// as InvalidateFolds
+		int Find(int aStart) const;	// the outermost range starting at aStart that hides anything, -1 if none
+		void Stab(int aLine, std::vector<int>& aOut) const;	// ranges hiding aLine, outermost first
+
+		std::vector<FoldRange> mRanges;
+
+	private:
+		int Build(int aFirst, int aLast);
+		int Update(int aFirst, int aLast, int aRange);
+		int MaxEnd(int aFirst, int aLast) const { return aFirst < aLast ? mMaxEnds[(aFirst + aLast) / 2] : -1; }
+		void Stab(int aFirst, int aLast, int aLine, std::vector<int>& aOut) const;
+
+		std::vector<int> mMaxEnds;
+	};
+
+	// What a line contributes to fold ranges: braces left unmatched in it, or its indentation
+	struct FoldLine
+	{
+		int mCloses;	// unmatched closing braces, all before the unmatched opening ones
+		int mOpens;
+		int mIndent;	// -1 for a blank line
+	};
+
+	struct FoldOpen
+	{
+		int mRange;
+		int mIndent;
+	};
+
+	// The fold ranges open before a line
+	struct FoldCheckpoint
+	{
+		int mLine;
+		std::vector<FoldOpen> mOpen;
+	};
+
+	// The nesting a line, or a run of lines, adds: +1 for every opening bracket and -1 for every closing one
+	struct BracketDepth
+	{
+		int mDelta;	// at the end
+		int mMin;	// lowest at the start or after any bracket, at most 0
+	};
+
+	// A semantic token without its line, the line is where it is in mSemanticSpans
+	struct SemanticSpan
+	{
+		int mColumn;
+		int mLength;
+		PaletteIndex mColorIndex;
+	};
+
+	struct Cursor
 	{
 		Coordinates mSelectionStart;
 		Coordinates mSelectionEnd;
 		Coordinates mCursorPosition;
 	};
 
-	class UndoRecord
+	// The cursor everything single cursor works with, and the others
+	struct EditorState : Cursor
+	{
+		std::vector<Cursor> mCursors;	// ordered, neither overlapping each other nor the first one
+	};
+
+	// The text from mStart to mEnd replaced with mText, by one cursor of a batched edit
+	struct CursorEdit
+	{
+		Coordinates mStart;
+		Coordinates mEnd;
+		std::string mText;
+	};
+
+	// Text added in place of removed text at one place
+	struct UndoEdit
+	{
+		std::string mAdded;
+		Coordinates mAddedStart;
+		Coordinates mAddedEnd;
+
+		std::string mRemoved;
+		Coordinates mRemovedStart;
+		Coordinates mRemovedEnd;
+	};
+
+	// An edit at one place, or one per cursor: mMoreEdits follow this one in the text. Those were made back to front,
+	// so each has the coordinates from before the ones ahead of it were made.
+	class UndoRecord : public UndoEdit
 	{
 	public:
 		UndoRecord() {}
@@ -244,36 +691,79 @@ private:
 
 		void Undo(TextEditor* aEditor);
 		void Redo(TextEditor* aEditor);
+		bool Merge(const UndoRecord& aNext);
+		size_t GetMemoryUsage() const;
 
-		std::string mAdded;
-		Coordinates mAddedStart;
-		Coordinates mAddedEnd;
-
-		std::string mRemoved;
-		Coordinates mRemovedStart;
-		Coordinates mRemovedEnd;
-
+		std::vector<UndoEdit> mMoreEdits;
 		EditorState mBefore;
 		EditorState mAfter;
 	};
 
-	typedef std::vector<UndoRecord> UndoBuffer;
+	typedef std::deque<UndoRecord> UndoBuffer;
+
+	// Text handed over by PostText, on a lock-free stack the UI thread empties in one go. Defined in TextEditor.cpp for
+	// the same reason as ColorizeWorker.
+	class PostedTextStack;
 
 	void ProcessInputs();
 	void Colorize(int aFromLine = 0, int aCount = -1);
+	void InvalidateLines(int aFromLine, int aToLine);
 	void ColorizeRange(int aFromLine = 0, int aToLine = 0);
 	void ColorizeInternal();
+	void ApplyColorizeResults();
+	void UpdateFindResults();
+	void InvalidateFindResults(int aFirstLine, int aLastLine, int aLineDelta);
+	void SetFindResults(int aFirstLine, int aLastLine, std::vector<FindResult>& aResults);
+	const char* GetLineText(int aLineNo, std::string& aBuffer, size_t& aSize) const;
+	LexerState ColorizeGlyphs(Glyph* aGlyphs, size_t aCount, LexerState aState, std::string& aBuffer) const;
+	bool MatchToken(const char* aFirst, const char* aLast, const char*& aOutBegin, const char*& aOutEnd, PaletteIndex& aOutColor) const;
 	int TextDistanceToLineStart(const Coordinates& aFrom) const;
+	int GlyphIndexAtDistance(int aLineNo, int aDistance) const;
+	const ColumnIndex* GetColumnIndex(int aLineNo, const Line& aLine) const;
 	void EnsureCursorVisible();
+	void SetWrapColumns(int aColumns);
+	bool HasRowIndex() const { return mWordWrap || !mFoldedLines.empty(); }
+	bool IsFolded(int aLine) const { return std::binary_search(mFoldedLines.begin(), mFoldedLines.end(), aLine); }
+	void InvalidateRows(int aFirstLine, int aLastLine, int aLineDelta) const;
+	void UpdateRows() const;
+	void RecountRows(int aFirstLine, int aLastLine) const;
+	int CountRows(int aLineNo) const;
+	void InvalidateFolds(int aFirstLine, int aLastLine, int aLineDelta);
+	void InvalidateColors(int aFirstLine, int aLastLine);
+	void UpdateFolds() const;
+	void UpdateHiddenLines() const;
+	void DropFolds(int aCount);
+	void ClearFolds();
+	int NextVisibleLine(int aLineNo) const;
+	int PreviousVisibleLine(int aLineNo) const;
+	void RevealLine(int aLineNo);
+	void MoveCursorOutOfFolds();
+	void InvalidateIdentifiers(int aFirstLine, int aLastLine, int aLineDelta);
+	void UpdateIdentifiers() const;
+	void UpdateCompletions(bool aTyped);
+	void AcceptCompletion();
+	void InvalidateBrackets(int aFirstLine, int aLastLine, int aLineDelta);
+	void UpdateBrackets() const;
+	void InvalidateSemanticTokens(int aFirstLine, int aLastLine, int aLineDelta);
+	int FindBracketLineForward(int aLine, int& aDepth) const;
+	int FindBracketLineBackward(int aLine, int& aDepth) const;
+	int LineToRow(int aLineNo) const;
+	int RowToLine(int aRow) const;
+	int GetRowCount() const;
+	const LineWrap& GetLineWrap(int aLineNo) const;
+	void GetRowPosition(const Coordinates& aPosition, int& aRow, int& aDistance) const;
+	Coordinates RowPositionToCoordinates(int aRow, int aDistance) const;
 	int GetPageSize() const;
-	int AppendBuffer(std::string& aBuffer, char chr, int aIndex);
+	const LineRenderCache& GetRenderCache(int aLineNo, const Line& aLine, int aFirstColumn, int aLastColumn);
 	std::string GetText(const Coordinates& aStart, const Coordinates& aEnd) const;
 	Coordinates GetActualCursorCoordinates() const;
 	Coordinates SanitizeCoordinates(const Coordinates& aValue) const;
 	void Advance(Coordinates& aCoordinates) const;
 	void DeleteRange(const Coordinates& aStart, const Coordinates& aEnd);
 	int InsertTextAt(Coordinates& aWhere, const char* aValue);
-	void AddUndo(UndoRecord& aValue);
+	void AddUndo(UndoRecord& aValue, bool aMergeable = false);
+	void ClearUndo();
+	void TrimUndo();
 	Coordinates ScreenPosToCoordinates(const ImVec2& aPosition) const;
 	Coordinates FindWordStart(const Coordinates& aFrom) const;
 	Coordinates FindWordEnd(const Coordinates& aFrom) const;
@@ -281,6 +771,18 @@ private:
 	void RemoveLine(int aStart, int aEnd);
 	void RemoveLine(int aIndex);
 	Line& InsertLine(int aIndex);
+	void InsertLines(int aIndex, std::vector<Line>&& aLines);
+	void AppendLines(const char* aFirst, const char* aLast, Line& aOpenLine);
+	void AppendGlyphs(const char* aFirst, const char* aLast);
+	void EndAppend(int aFirstLine);
+	void AppendPostedText();
+	void DropLines(int aCount);
+	std::vector<Cursor> GetCursors(int& aPrimary) const;	// all of them in order, aPrimary is the index of the first one
+	void SetCursors(std::vector<Cursor>& aCursors, int aPrimary);
+	bool ForEachCursor(const std::function<void()>& aAction);
+	void EditCursors(std::vector<CursorEdit>& aEdits);
+	void SelectColumns(int aStartLine, int aStartDistance, int aEndLine, int aEndDistance);
+	void AddCursorRow(int aDirection);
 	void EnterCharacter(Char aChar);
 	void BackSpace();
 	void DeleteSelection();
@@ -292,6 +794,10 @@ private:
 	EditorState mState;
 	UndoBuffer mUndoBuffer;
 	int mUndoIndex;
+	size_t mUndoMemory;
+	size_t mUndoMemoryLimit;
+	bool mUndoMergeable;	// the last record was a single character typed or deleted, the next one may extend it
+	long long mUndoTime;	// milliseconds, when it was added
 	
 	int mTabSize;
 	bool mOverwrite;
@@ -299,16 +805,69 @@ private:
 	bool mWithinRender;
 	bool mScrollToCursor;
 	bool mWordSelectionMode;
+	bool mWordWrap;
 	int mColorRangeMin, mColorRangeMax;
 
 	Palette mPalette;
 	LanguageDefinition mLanguageDefinition;
 	RegexList mRegexList;
+	KeywordTable mKeywordTable;
+	std::string mColorizeBuffer;
+	uint32_t mTextVersion;
+	uint32_t mEditVersion;	// mTextVersion of the last change other than text added at the end
+	int mColorizedLines;	// lines from this one down are left to the background colorizer
+	int mLastLineCount;
+	std::unique_ptr<ColorizeWorker> mColorizeWorker;
+	int mLineLimit;
+	bool mFollowEnd;	// text was added at the end, the view goes along if it is at the bottom
+	std::unique_ptr<PostedTextStack> mPostedText;
+
+	FindQuery mFindQuery;	// of FindAll, empty when there is none
+	std::vector<FindResult> mFindResults;	// ordered by position
+	int mFindDirtyMin, mFindDirtyMax;	// lines changed since they were searched, their matches are not in mFindResults
+	std::unique_ptr<FindWorker> mFindWorker;
+	std::string mFindBuffer;
 
-	bool mCheckMultilineComments;
 	Breakpoints mBreakpoints;
 	ErrorMarkers mErrorMarkers;
 	ImVec2 mCharAdvance;
+	std::vector<LineRenderCache> mRenderCache;	// direct mapped by line number
+	mutable std::vector<ColumnIndex> mColumnIndex;	// likewise
+	int mWrapColumns;	// set from the window width every frame
+	mutable std::vector<int> mLineRows;	// rows every line takes when wrapping or folding (0 if hidden), empty until needed
+	mutable ImFenwickTree<int> mRowStarts;	// prefix sums of mLineRows, the first row of every line
+	mutable int mRowStartsDirty;	// lines moved from this one on, the sums are built again from it
+	mutable int mRowsDirtyMin, mRowsDirtyMax;	// lines to count the rows of again
+	mutable int mRowsRecounted;	// lines from this one on were counted at an earlier wrap width, see RecountRows
+	mutable std::vector<LineWrap> mLineWraps;	// direct mapped by line number
+	mutable std::string mWrapBuffer;
+	mutable FoldTree mFolds;
+	mutable std::vector<FoldLine> mFoldLines;	// one per line, empty until needed
+	mutable std::vector<FoldCheckpoint> mFoldCheckpoints;	// about every cFoldCheckpointLines lines, ordered by line
+	mutable int mFoldDirtyMin, mFoldDirtyMax;	// lines to summarize again, ranges are found again from the first
+	mutable std::vector<int> mFoldedLines;	// first lines of folded regions, ordered
+	mutable std::vector<std::pair<int, int>> mHiddenLines;	// first and last line of every run of hidden lines, ordered
+	mutable IdentifierIndex mIdentifierIndex;
+	mutable std::vector<std::vector<int>> mLineIdentifiers;	// ids of the identifiers on every line, empty until needed
+	mutable int mIdentifiersDirtyMin, mIdentifiersDirtyMax;
+	mutable std::string mWordBuffer;
+	bool mAutoComplete;
+	std::vector<std::string> mCompletions;	// offered below the cursor, empty when there are none
+	int mCompletionIndex;	// the one picked
+	Coordinates mCompletionStart;	// of the word being completed
+	Coordinates mCompletionEnd;	// the cursor when the completions were found
+	uint32_t mCompletionVersion;	// mTextVersion they were found in
+	mutable std::vector<BracketDepth> mBracketLines;	// one per line, empty until needed
+	mutable std::vector<BracketDepth> mBracketTree;	// sums of mBracketLines in heap order, the lines are the leaves
+	mutable int mBracketLeaves;	// a power of two, at least the line count
+	mutable int mBracketTreeLines;	// the line count the sums were added up for
+	mutable int mBracketsDirtyMin, mBracketsDirtyMax;	// lines to summarize again
+	mutable int mBracketsMoved;	// first line that moved since the sums were updated, every sum from it is stale
+	std::vector<SemanticSpan> mSemanticSpans;	// by line then column
+	std::vector<int> mSemanticLineStarts;	// first span of every line plus the end, empty without tokens
+	uint32_t mStyleVersion;	// bumped when the palette, language or font change
+	const ImFont* mRenderFont;
+	float mRenderFontSize;
 	Coordinates mInteractiveStart, mInteractiveEnd;
 };
 
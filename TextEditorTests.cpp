@@ -0,0 +1,501 @@
+// Standalone checks and benchmarks for TextEditor, not part of the ImGuiCLI build. Run it from the repository root, the
+// sources there are used as test text.
+//   cl /EHsc /O2 TextEditorTests.cpp TextEditor.cpp imgui.cpp imgui_draw.cpp
+//   g++ -std=c++14 -O2 -pthread TextEditorTests.cpp TextEditor.cpp imgui.cpp imgui_draw.cpp -o TextEditorTests
+// Exits with 1 if a check fails. "TextEditorTests bench" also prints timings.
+
+#include "TextEditor.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+typedef TextEditor::LanguageDefinition LanguageDefinition;
+
+static int gFailures = 0;
+static bool gBench = false;
+
+#define CHECK(aExpr) do { if (!(aExpr)) { printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #aExpr); ++gFailures; } } while (0)
+
+static const char* cTempFile = "TextEditorTests.tmp";
+
+static double Milliseconds(std::chrono::high_resolution_clock::time_point aStart)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - aStart).count();
+}
+
+static std::string ReadFile(const char* aPath)
+{
+	std::ifstream in(aPath, std::ios::binary);
+	std::stringstream text;
+	text << in.rdbuf();
+	return text.str();
+}
+
+static void WriteFile(const char* aPath, const std::string& aText)
+{
+	std::ofstream out(aPath, std::ios::binary);
+	out << aText;
+}
+
+// Random lines over the characters the tokenizers look at, weighted towards strings, escapes, comments and numbers
+static std::string FuzzText(int aLines, const char* aAlphabet, unsigned aSeed)
+{
+	std::mt19937 rng(aSeed);
+	const size_t alphabetSize = strlen(aAlphabet);
+	std::string text;
+	for (int i = 0; i < aLines; ++i)
+	{
+		auto length = rng() % 40;
+		for (unsigned j = 0; j < length; ++j)
+			text.push_back(aAlphabet[rng() % alphabetSize]);
+		text.push_back('\n');
+	}
+	return text;
+}
+
+// Lines indented by how deep they are in braces, so blocks open for many lines in both fold modes, with blank lines
+static std::string NestedText(int aLines, unsigned aSeed)
+{
+	std::mt19937 rng(aSeed);
+	std::string text;
+	int depth = 0;
+	for (int i = 0; i < aLines; ++i)
+	{
+		auto kind = rng() % 8;
+		if (kind < 2 && depth < 12)
+			text += std::string(depth++, '\t') + "block {\n";
+		else if (kind < 4 && depth > 0)
+			text += std::string(--depth, '\t') + "}\n";
+		else if (kind == 4)
+			text += "\n";
+		else
+			text += std::string(depth, '\t') + "statement;\n";
+	}
+	return text;
+}
+
+// The colors of every glyph, as a file view colorizes them: synchronously, line by line as they are read
+static std::vector<uint8_t> Colorize(const LanguageDefinition& aLanguage, double& aOutMs)
+{
+	TextEditor editor;
+	editor.SetLanguageDefinition(aLanguage);
+	std::vector<uint8_t> colors;
+	auto start = std::chrono::high_resolution_clock::now();
+	CHECK(editor.OpenFileView(cTempFile));
+	for (int i = 0; i < editor.GetTotalLines(); ++i)
+	{
+		auto& line = editor.GetLine(i);
+		for (auto& glyph : line)
+			colors.push_back((uint8_t)glyph.mColorIndex);
+		colors.push_back(0xff);
+	}
+	aOutMs = Milliseconds(start);
+	return colors;
+}
+
+// The hand written tokenizers of the built-in languages must color every glyph as their regular expressions do
+static void TestTokenizersMatchRegex()
+{
+	LanguageDefinition(*languages[])() = {
+		LanguageDefinition::CPlusPlus, LanguageDefinition::HLSL, LanguageDefinition::GLSL, LanguageDefinition::C,
+		LanguageDefinition::SQL, LanguageDefinition::AngelScript, LanguageDefinition::Lua };
+	const char* textNames[] = { "source", "fuzz", "strings" };
+	std::string texts[] = {
+		ReadFile("imgui.cpp") + ReadFile("TextEditor.cpp") + ReadFile("imgui_demo.cpp"),
+		FuzzText(60000, "abcLxXeEfFuUlL0123456789_ \t\"'\\/-+.#*[]{}();:,<>=!%^&|~?@$`\r", 1234),
+		FuzzText(20000, "L\"\"\"'\\\\\\ a\r", 5678) };
+	CHECK(texts[0].size() > 100000);
+
+	for (int t = 0; t < 3; ++t)
+	{
+		WriteFile(cTempFile, texts[t]);
+		for (auto language : languages)
+		{
+			auto lexer = language();
+			auto regex = lexer;
+			regex.mTokenize = nullptr;
+			CHECK(lexer.mTokenize != nullptr);
+
+			double lexerMs, regexMs;
+			auto lexerColors = Colorize(lexer, lexerMs);
+			auto regexColors = Colorize(regex, regexMs);
+			CHECK(lexerColors == regexColors);
+			CHECK(std::count(lexerColors.begin(), lexerColors.end(), (uint8_t)TextEditor::PaletteIndex::String) > 0);
+			if (gBench)
+				printf("%-12s %-8s lexer %8.1f ms, regex %8.1f ms\n", lexer.mName.c_str(), textNames[t], lexerMs, regexMs);
+		}
+	}
+	remove(cTempFile);
+}
+
+// Text taken from a file view is read from the mapping, it must be the same as from the document loaded with SetText
+static void TestFileViewText()
+{
+	std::string text = ReadFile("TextEditor.cpp");
+	WriteFile(cTempFile, text);
+	TextEditor view, loaded;
+	CHECK(view.OpenFileView(cTempFile));
+	loaded.SetText(text);
+	CHECK(view.GetTotalLines() == loaded.GetTotalLines());
+	CHECK(view.GetText() == text);
+
+	view.SelectAll();
+	CHECK(view.GetSelectedText() == text);
+
+	std::mt19937 rng(42);
+	auto lines = loaded.GetTotalLines();
+	for (int i = 0; i < 1000; ++i)
+	{
+		TextEditor::Coordinates start((int)(rng() % lines), (int)(rng() % 100));
+		TextEditor::Coordinates end(start.mLine + (int)(rng() % 50), (int)(rng() % 100));
+		view.SetSelection(start, end);
+		loaded.SetSelection(start, end);
+		CHECK(view.GetSelectedText() == loaded.GetSelectedText());
+	}
+	remove(cTempFile);
+}
+
+// One frame with the editor in a window, which is when it brings its find results up to date. The window width sets
+// the wrap width.
+static void RenderFrame(TextEditor& aEditor, float aWidth = 0.0f)
+{
+	ImGui::NewFrame();
+	if (aWidth > 0.0f)
+		ImGui::SetNextWindowSize(ImVec2(aWidth, 600.0f));
+	ImGui::Begin("TextEditorTests");
+	aEditor.Render("editor");
+	ImGui::End();
+	ImGui::Render();
+}
+
+static bool SameResults(const std::vector<TextEditor::FindResult>& aLeft, const std::vector<TextEditor::FindResult>& aRight)
+{
+	if (aLeft.size() != aRight.size())
+		return false;
+	for (size_t i = 0; i < aLeft.size(); ++i)
+		if (aLeft[i].mStart != aRight[i].mStart || aLeft[i].mEnd != aRight[i].mEnd)
+			return false;
+	return true;
+}
+
+// FindAll results kept up to date line by line through random edits must be those of searching the whole text again
+static void TestFindAllFollowsEdits()
+{
+	const char* inserts[] = { "x", "value", "\n", "value\nvalue", "\n\n", "va", "lue", " value = 1;\n" };
+	for (int regex = 0; regex < 2; ++regex)
+	{
+		TextEditor editor;
+		editor.SetText(ReadFile("TextEditor.h"));
+		auto what = regex ? "val[a-z]+|^$" : "value";
+		CHECK(editor.FindAll(what, regex != 0));
+		std::mt19937 rng(7 + regex);
+		for (int step = 0; step < 300; ++step)
+		{
+			auto lines = editor.GetTotalLines();
+			TextEditor::Coordinates at((int)(rng() % lines), (int)(rng() % 40));
+			switch (rng() % 4)
+			{
+			case 0:
+			case 1:
+				editor.SetCursorPosition(at);
+				editor.InsertText(inserts[rng() % (sizeof(inserts) / sizeof(inserts[0]))]);
+				break;
+			case 2:
+				editor.SetSelection(at, TextEditor::Coordinates(std::min(lines - 1, at.mLine + (int)(rng() % 3)), (int)(rng() % 40)));
+				editor.Delete();
+				break;
+			default:
+				editor.SetCursorPosition(TextEditor::Coordinates(at.mLine, std::numeric_limits<int>::max()));
+				editor.Delete();
+				break;
+			}
+
+			RenderFrame(editor);
+			for (int wait = 0; wait < 1000 && editor.IsFindPending(); ++wait)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				RenderFrame(editor);
+			}
+
+			TextEditor fresh;
+			fresh.SetText(editor.GetText());
+			CHECK(fresh.FindAll(what, regex != 0));
+			for (int wait = 0; wait < 1000 && fresh.IsFindPending(); ++wait)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				RenderFrame(fresh);
+			}
+			if (!SameResults(editor.GetFindResults(), fresh.GetFindResults()))
+			{
+				CHECK(!"find results differ from a new search");
+				break;
+			}
+		}
+	}
+}
+
+// Wrapped rows kept up to date line by line through random edits and changes of the wrap width must be those of
+// counting every line again. Rows are seen through moving the cursor down from the start.
+static void TestRowsFollowEdits()
+{
+	const char* inserts[] = { "x", "\n", "\t\t\t\t", "\n\n", "some words to make a line wrap once the text area is narrow enough, ",
+		"an_identifier_too_long_for_any_row_so_it_is_broken_inside_the_word_rather_than_at_a_space_before_it" };
+	const float widths[] = { 400.0f, 700.0f, 1200.0f };
+	std::string text;
+	for (int copy = 0; copy < 20; ++copy)
+		text += ReadFile("TextEditor.h");
+
+	TextEditor editor;
+	editor.SetText(text);
+	editor.SetWordWrap(true);
+	auto width = widths[0];
+	auto rowPosition = [](TextEditor& aEditor, int aRow)
+	{
+		aEditor.SetCursorPosition(TextEditor::Coordinates(0, 0));
+		aEditor.MoveDown(aRow);
+		return aEditor.GetCursorPosition();
+	};
+	std::mt19937 rng(11);
+	for (int step = 0; step < 150; ++step)
+	{
+		auto lines = editor.GetTotalLines();
+		TextEditor::Coordinates at((int)(rng() % lines), (int)(rng() % 40));
+		switch (rng() % 4)
+		{
+		case 0:
+		case 1:
+			editor.SetCursorPosition(at);
+			editor.InsertText(inserts[rng() % (sizeof(inserts) / sizeof(inserts[0]))]);
+			break;
+		case 2:
+			editor.SetSelection(at, TextEditor::Coordinates(std::min(lines - 1, at.mLine + (int)(rng() % 3)), (int)(rng() % 40)));
+			editor.Delete();
+			break;
+		default:
+			width = widths[rng() % (sizeof(widths) / sizeof(widths[0]))];
+			break;
+		}
+
+		// More lines than are counted again in a frame after the width changed, and a scrollbar showing up changes it
+		// once more
+		for (int frame = 0; frame < 3; ++frame)
+			RenderFrame(editor, width);
+
+		TextEditor fresh;
+		fresh.SetText(editor.GetText());
+		fresh.SetWordWrap(true);
+		RenderFrame(fresh, width);
+		auto same = rowPosition(editor, std::numeric_limits<int>::max()) == rowPosition(fresh, std::numeric_limits<int>::max());
+		for (int sample = 0; sample < 50 && same; ++sample)
+		{
+			auto row = (int)(rng() % (2 * lines));
+			same = rowPosition(editor, row) == rowPosition(fresh, row);
+		}
+		if (!same)
+		{
+			CHECK(!"rows differ from counting every line again");
+			break;
+		}
+	}
+}
+
+// The fold regions of an editor must be those of scanning its whole text again, also after folding all and unfolding
+// the regions each of aProbes is hidden in. That goes through the largest ends kept for the ranges, and a stale one shows
+// on the first or last line a region hides.
+static bool SameFolds(TextEditor& aEditor, const LanguageDefinition& aLanguage, const std::vector<int>& aProbes)
+{
+	TextEditor fresh;
+	fresh.SetLanguageDefinition(aLanguage);
+	fresh.SetText(aEditor.GetText());
+	auto regions = aEditor.GetFoldRegions();
+	auto expected = fresh.GetFoldRegions();
+	auto same = regions.size() == expected.size();
+	for (size_t i = 0; i < regions.size() && same; ++i)
+		same = regions[i].mStart == expected[i].mStart && regions[i].mEnd == expected[i].mEnd;
+
+	for (size_t probe = 0; probe < aProbes.size() && same; ++probe)
+	{
+		for (auto e : { &aEditor, &fresh })
+		{
+			e->SetCursorPosition(TextEditor::Coordinates(0, 0));
+			e->FoldAll();
+			e->SetCursorPosition(TextEditor::Coordinates(aProbes[probe], 0));
+		}
+		auto unfolded = aEditor.GetFoldRegions();
+		auto expectedUnfolded = fresh.GetFoldRegions();
+		for (size_t i = 0; i < unfolded.size() && same; ++i)
+			same = unfolded[i].mFolded == expectedUnfolded[i].mFolded;
+	}
+	return same;
+}
+
+// Fold regions kept up to date through random edits and lines dropped from the start. The text has no strings or
+// comments, so the regions do not depend on how far colorizing got.
+static void TestFoldsFollowEdits()
+{
+	const char* inserts[] = { "{", "}", "\n", "\n\t", "{\n\t}\n", "}\n}\n{", "  a {\n", "\n\n\n", "\t\t" };
+	const LanguageDefinition languages[] = { LanguageDefinition::CPlusPlus(), LanguageDefinition::Lua() };
+	for (auto& language : languages)
+	{
+		TextEditor editor;
+		editor.SetLanguageDefinition(language);
+		editor.SetLineLimit(12000);
+		editor.SetText(NestedText(10000, 5));
+		std::mt19937 rng(13);
+		for (int step = 0; step < 200; ++step)
+		{
+			auto lines = editor.GetTotalLines();
+			TextEditor::Coordinates at((int)(rng() % lines), rng() % 2 ? 0 : (int)(rng() % 40));
+			switch (rng() % 5)
+			{
+			case 0:
+			case 1:
+				editor.SetCursorPosition(at);
+				editor.SetSelection(at, at);
+				editor.InsertText(inserts[rng() % (sizeof(inserts) / sizeof(inserts[0]))]);
+				break;
+			case 2:
+				editor.SetSelection(at, TextEditor::Coordinates(std::min(lines - 1, at.mLine + (int)(rng() % 3)), (int)(rng() % 40)));
+				editor.Delete();
+				break;
+			case 3:
+				editor.SetCursorPosition(TextEditor::Coordinates(at.mLine, std::numeric_limits<int>::max()));
+				editor.Delete();
+				break;
+			default:
+				editor.AppendText(rng() % 2 ? NestedText(1000, step) : FuzzText(1000, "{{}}  \t\tab", step));
+				break;
+			}
+			RenderFrame(editor);
+
+			auto regions = editor.GetFoldRegions();
+			std::vector<int> probes;
+			for (int probe = 0; probe < 8 && !regions.empty(); ++probe)
+			{
+				auto& region = regions[rng() % regions.size()];
+				probes.push_back(probe % 2 ? region.mEnd : region.mStart + 1);
+			}
+			if (!SameFolds(editor, language, probes))
+			{
+				CHECK(!"fold regions differ from scanning the whole text again");
+				break;
+			}
+		}
+	}
+
+	// Blocks open across the checkpoints a new text gets every 1024 lines, where the scan after an edit may stop early:
+	// a header indented further with the same ranges open past it, a last line made blank before an indentation block is
+	// closed, a block closed later by indenting the line that closed it, and a newline inside a block before later ones
+	struct Case { const LanguageDefinition& mLanguage; std::string mText; int mLine; const char* mInsert; };
+	auto lines = [](int aCount, const char* aLine) { std::string text; while (aCount--) text += aLine; return text; };
+	auto lua = LanguageDefinition::Lua();
+	auto cpp = LanguageDefinition::CPlusPlus();
+	auto block = "{\n" + lines(2000, "\t{\n\t}\n") + "}\n";
+	const Case cases[] = {
+		{ lua, "a\n" + lines(2000, "\t\tb\n") + "\tc\n" + lines(10, "\t\td\n"), 0, "\t" },
+		{ lua, "a\n" + lines(1019, "\tb\n") + "\tb\n" + lines(10, "\n") + "c\n" + lines(2000, "\td\n"), 1020, nullptr },
+		{ lua, "a\n" + lines(2999, "\tb\n") + "c\n" + lines(500, "\td\n") + "e\n", 3000, "\t" },
+		{ cpp, block + block + block, 100, "\n" },
+	};
+	for (auto& c : cases)
+	{
+		TextEditor editor;
+		editor.SetLanguageDefinition(c.mLanguage);
+		editor.SetText(c.mText);
+		editor.GetFoldRegions();
+		if (c.mInsert)
+		{
+			editor.SetCursorPosition(TextEditor::Coordinates(c.mLine, 0));
+			editor.SetSelection(TextEditor::Coordinates(c.mLine, 0), TextEditor::Coordinates(c.mLine, 0));
+			editor.InsertText(c.mInsert);
+		}
+		else
+		{
+			editor.SetSelection(TextEditor::Coordinates(c.mLine, 0), TextEditor::Coordinates(c.mLine, std::numeric_limits<int>::max()));
+			editor.Delete();
+		}
+
+		std::vector<int> probes;
+		for (auto& region : editor.GetFoldRegions())
+			if (region.mEnd - region.mStart > 1)
+			{
+				probes.push_back(region.mStart + 1);
+				probes.push_back(region.mEnd);
+			}
+		CHECK(SameFolds(editor, c.mLanguage, probes));
+	}
+}
+
+// Edits at the start, middle and end of a 500k line document: single characters, newlines, a 1000 line paste and a 20k
+// character line. Each splits or joins lines, which used to move every line below the edit.
+static void BenchEditing()
+{
+	std::string text;
+	for (int i = 0; i < 500000; ++i)
+		text += "    generated_value_" + std::to_string(i) + " = compute(" + std::to_string(i * 7) + ", 0x1F);\n";
+	std::string paste;
+	for (int i = 0; i < 1000; ++i)
+		paste += "\tpasted line " + std::to_string(i) + ";\n";
+	std::string longLine(20000, 'x');
+
+	TextEditor editor;
+	auto start = std::chrono::high_resolution_clock::now();
+	editor.SetText(text);
+	printf("SetText %.1f MB, %d lines: %.1f ms\n", text.size() / 1048576.0, editor.GetTotalLines(), Milliseconds(start));
+
+	const char* where[] = { "start", "middle", "end" };
+	for (int w = 0; w < 3; ++w)
+	{
+		int line = w == 0 ? 0 : w == 1 ? editor.GetTotalLines() / 2 : editor.GetTotalLines() - 1;
+		auto time = [&](const std::string& aText, int aCount)
+		{
+			double ms = 0;
+			for (int i = 0; i < aCount; ++i)
+			{
+				editor.SetCursorPosition(TextEditor::Coordinates(line, 4));
+				auto start = std::chrono::high_resolution_clock::now();
+				editor.InsertText(aText);
+				ms += Milliseconds(start);
+			}
+			return ms * 1000.0 / aCount;
+		};
+		auto character = time("x", 100);
+		auto newline = time("\n", 100);
+		auto block = time(paste, 5);
+		auto wide = time(longLine, 5);
+		printf("%-6s: character %.1f us, newline %.1f us, 1000 line paste %.0f us, 20k character paste %.0f us\n", where[w], character, newline, block, wide);
+	}
+	CHECK(editor.GetTotalLines() == 500001 + 3 * (100 + 5 * 1000));
+}
+
+int main(int argc, char** argv)
+{
+	gBench = argc > 1 && strcmp(argv[1], "bench") == 0;
+	ImGui::CreateContext();
+	ImGuiIO& io = ImGui::GetIO();
+	io.DisplaySize = ImVec2(1920, 1080);
+	io.DeltaTime = 1.0f / 60.0f;
+	io.IniFilename = nullptr;
+	io.MousePos = ImVec2(0, 0);
+	unsigned char* pixels;
+	int width, height;
+	io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+	TestTokenizersMatchRegex();
+	TestFileViewText();
+	TestFindAllFollowsEdits();
+	TestRowsFollowEdits();
+	TestFoldsFollowEdits();
+	if (gBench)
+		BenchEditing();
+
+	ImGui::DestroyContext();
+	printf(gFailures ? "%d check(s) failed\n" : "all checks passed\n", gFailures);
+	return gFailures ? 1 : 0;
+}
@@ -33,6 +33,11 @@
 //---- Don't implement ImFormatString(), ImFormatStringV() so you can reimplement them yourself.
 //#define IMGUI_DISABLE_FORMAT_STRING_FUNCTIONS
 
+//---- Record hierarchical timings of NewFrame/Begin/End/Render/platform windows and user IMGUI_PROFILE_SCOPE() markers (see Metrics window and ImGui::ProfilerExportChromeTrace())
+//---- When not defined the markers compile to nothing.
+//#define IMGUI_ENABLE_PROFILER
+//#define IMGUI_PROFILER_FRAMES     120             // Number of frames kept in the profiler ring buffer
+
 //---- Include imgui_user.h at the end of imgui.h as a convenience
 //#define IMGUI_INCLUDE_IMGUI_USER_H
 
@@ -670,6 +670,9 @@
 #else
 #include <stdint.h>     // intptr_t
 #endif
+#ifdef IMGUI_ENABLE_PROFILER
+#include <chrono>       // steady_clock
+#endif
 
 #define IMGUI_DEBUG_NAV_SCORING     0
 #define IMGUI_DEBUG_NAV_RECTS       0
@@ -804,6 +807,34 @@ static void*  (*GImAllocatorAllocFunc)(size_t size, void* user_data) = MallocWra
 static void   (*GImAllocatorFreeFunc)(void* ptr, void* user_data) = FreeWrapper;
 static void*    GImAllocatorUserData = NULL;
 static size_t   GImAllocatorActiveAllocationsCount = 0;
+static ImU64    GImAllocatorTotalCount = 0;
+
+// Allocation accounting. Live allocations are recorded in an open addressing table keyed by pointer rather than in a header before each block,
+// so memory handed over to ImGui and released with MemFree() (e.g. ImFontConfig::FontData) keeps working. The table itself is not accounted.
+struct ImGuiAllocRecord { void* Ptr; size_t Size; ImGuiAllocTag Tag; };
+static ImGuiAllocTag        GImAllocatorCurrentTag = ImGuiAllocTag_Other;
+static ImGuiAllocStats      GImAllocatorStats[ImGuiAllocTag_COUNT];
+static ImGuiAllocRecord*    GImAllocatorRecords = NULL;
+static int                  GImAllocatorRecordsCapacity = 0;    // Power of two
+static int                  GImAllocatorRecordsCount = 0;
+
+// MemAlloc()/MemFree() may be called from other threads than the one running the frame (e.g. a font atlas built in the background),
+// so the counters and the table above are only touched under this lock. Define IMGUI_ALLOC_LOCK()/IMGUI_ALLOC_UNLOCK() in imconfig.h to use your own.
+#ifndef IMGUI_ALLOC_LOCK
+#if defined(_MSC_VER)
+#include <intrin.h>
+static volatile long        GImAllocatorLock = 0;
+#define IMGUI_ALLOC_LOCK()      while (_InterlockedExchange(&GImAllocatorLock, 1)) {}
+#define IMGUI_ALLOC_UNLOCK()    _InterlockedExchange(&GImAllocatorLock, 0)
+#elif defined(__GNUC__)
+static volatile int         GImAllocatorLock = 0;
+#define IMGUI_ALLOC_LOCK()      while (__sync_lock_test_and_set(&GImAllocatorLock, 1)) {}
+#define IMGUI_ALLOC_UNLOCK()    __sync_lock_release(&GImAllocatorLock)
+#else
+#define IMGUI_ALLOC_LOCK()
+#define IMGUI_ALLOC_UNLOCK()
+#endif
+#endif
 
 //-----------------------------------------------------------------------------
 // User facing structures
@@ -1575,7 +1606,10 @@ int* ImGuiStorage::GetIntRef(ImGuiID key, int default_val)
 {
     ImVector<Pair>::iterator it = LowerBound(Data, key);
     if (it == Data.end() || it->key != key)
+    {
+        ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Storage);
         it = Data.insert(it, Pair(key, default_val));
+    }
     return &it->val_i;
 }
 
@@ -1588,7 +1622,10 @@ float* ImGuiStorage::GetFloatRef(ImGuiID key, float default_val)
 {
     ImVector<Pair>::iterator it = LowerBound(Data, key);
     if (it == Data.end() || it->key != key)
+    {
+        ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Storage);
         it = Data.insert(it, Pair(key, default_val));
+    }
     return &it->val_f;
 }
 
@@ -1596,7 +1633,10 @@ void** ImGuiStorage::GetVoidPtrRef(ImGuiID key, void* default_val)
 {
     ImVector<Pair>::iterator it = LowerBound(Data, key);
     if (it == Data.end() || it->key != key)
+    {
+        ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Storage);
         it = Data.insert(it, Pair(key, default_val));
+    }
     return &it->val_p;
 }
 
@@ -1606,6 +1646,7 @@ void ImGuiStorage::SetInt(ImGuiID key, int val)
     ImVector<Pair>::iterator it = LowerBound(Data, key);
     if (it == Data.end() || it->key != key)
     {
+        ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Storage);
         Data.insert(it, Pair(key, val));
         return;
     }
@@ -1622,6 +1663,7 @@ void ImGuiStorage::SetFloat(ImGuiID key, float val)
     ImVector<Pair>::iterator it = LowerBound(Data, key);
     if (it == Data.end() || it->key != key)
     {
+        ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Storage);
         Data.insert(it, Pair(key, val));
         return;
     }
@@ -1633,6 +1675,7 @@ void ImGuiStorage::SetVoidPtr(ImGuiID key, void* val)
     ImVector<Pair>::iterator it = LowerBound(Data, key);
     if (it == Data.end() || it->key != key)
     {
+        ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Storage);
         Data.insert(it, Pair(key, val));
         return;
     }
@@ -1652,6 +1695,7 @@ void ImGuiStorage::SetAllInt(int v)
 // Helper: Parse and apply text filters. In format "aaaaa[,bbbb][,ccccc]"
 ImGuiTextFilter::ImGuiTextFilter(const char* default_filter)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_TextBuffer);
     if (default_filter)
     {
         ImStrncpy(InputBuf, default_filter, IM_ARRAYSIZE(InputBuf));
@@ -1696,6 +1740,7 @@ void ImGuiTextFilter::TextRange::split(char separator, ImVector<TextRange>& out)
 
 void ImGuiTextFilter::Build()
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_TextBuffer);
     Filters.resize(0);
     TextRange input_range(InputBuf, InputBuf+strlen(InputBuf));
     input_range.split(',', Filters);
@@ -1758,6 +1803,7 @@ bool ImGuiTextFilter::PassFilter(const char* text, const char* text_end) const
 // Helper: Text buffer for logging/accumulating text
 void ImGuiTextBuffer::appendfv(const char* fmt, va_list args)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_TextBuffer);
     va_list args_copy;
     va_copy(args_copy, args);
 
@@ -1918,6 +1964,113 @@ bool ImGuiListClipper::Step()
     return false;
 }
 
+//-----------------------------------------------------------------------------
+// ImGuiListClipperVariable
+//-----------------------------------------------------------------------------
+
+void ImGuiListClipperVariable::Begin(int count, HeightGetter items_height_getter, void* user_data)
+{
+    IM_ASSERT(count >= 0 && items_height_getter != NULL);
+    if (count != ItemsCount || items_height_getter != ItemsHeightGetter || user_data != UserData)
+        Dirty = true;
+    ItemsCount = count;
+    ItemsHeightGetter = items_height_getter;
+    UserData = user_data;
+
+    if (Dirty)
+    {
+        Heights.resize(count);
+        for (int i = 0; i < count; i++)
+            Heights[i] = ItemsHeightGetter(UserData, i);
+        Tree.Build(Heights.Data, count);
+        Dirty = false;
+    }
+
+    StartPosY = ImGui::GetCursorPosY();
+    DisplayStart = DisplayEnd = -1;
+    StepNo = 0;
+}
+
+void ImGuiListClipperVariable::End()
+{
+    if (StepNo >= 2)
+        return;
+    // Seek to the end of the list, using the height of the last item as the dummy previous line
+    if (ItemsCount > 0)
+        SetCursorPosYAndSetupDummyPrevLine(StartPosY + GetTotalHeight(), Heights[ItemsCount - 1]);
+    StepNo = 2;
+}
+
+bool ImGuiListClipperVariable::Step()
+{
+    ImGuiContext& g = *GImGui;
+    ImGuiWindow* window = g.CurrentWindow;
+    if (ItemsCount == 0 || window->SkipItems)
+    {
+        StepNo = 2;
+        return false;
+    }
+    if (StepNo == 0) // Step 0: seek the first visible item and gather the range of items covering the clip rectangle.
+    {
+        if (g.LogEnabled)
+        {
+            // If logging is active, do not perform any clipping
+            DisplayStart = 0;
+            DisplayEnd = ItemsCount;
+        }
+        else
+        {
+            const float pos_y = window->DC.CursorPos.y;
+            DisplayStart = GetItemAtOffset(window->ClipRect.Min.y - pos_y);
+            const float clip_max = window->ClipRect.Max.y - pos_y;
+            float y = GetItemOffset(DisplayStart);
+            DisplayEnd = DisplayStart;
+            while (DisplayEnd < ItemsCount && y < clip_max)
+                y += Heights[DisplayEnd++];
+            if (g.NavMoveRequest && g.NavMoveDir == ImGuiDir_Up) // When performing a navigation request, ensure we have one item extra in the direction we are moving to
+                DisplayStart = ImMax(DisplayStart - 1, 0);
+            if (g.NavMoveRequest && g.NavMoveDir == ImGuiDir_Down)
+                DisplayEnd = ImMin(DisplayEnd + 1, ItemsCount);
+        }
+        if (DisplayStart > 0)
+            SetCursorPosYAndSetupDummyPrevLine(StartPosY + GetItemOffset(DisplayStart), Heights[DisplayStart - 1]); // advance cursor
+        StepNo = 1;
+        return true;
+    }
+    if (StepNo == 1) // Step 1: advance the cursor to the end of the list and return 'false' to end the loop.
+        End();
+    return false;
+}
+
+void ImGuiListClipperVariable::SetItemHeight(int idx, float height)
+{
+    IM_ASSERT(idx >= 0 && idx < ItemsCount && !Dirty);
+    const double delta = (double)height - (double)Heights[idx];
+    Heights[idx] = height;
+    if (delta != 0.0)
+        Tree.Add(idx, delta);
+}
+
+void ImGuiListClipperVariable::InvalidateItem(int idx)
+{
+    if (Dirty)
+        return; // Everything gets re-queried on next Begin() anyway
+    SetItemHeight(idx, ItemsHeightGetter(UserData, idx));
+}
+
+float ImGuiListClipperVariable::GetItemOffset(int idx) const
+{
+    IM_ASSERT(idx >= 0 && idx <= ItemsCount);
+    return (float)Tree.GetSum(idx);
+}
+
+int ImGuiListClipperVariable::GetItemAtOffset(float offset) const
+{
+    if (offset <= 0.0f || ItemsCount == 0)
+        return 0;
+    return Tree.Find(offset);
+}
+
 //-----------------------------------------------------------------------------
 // ImGuiWindow
 //-----------------------------------------------------------------------------
@@ -1973,6 +2126,9 @@ ImGuiWindow::ImGuiWindow(ImGuiContext* context, const char* name)
 
     DrawList = &DrawListInst;
     DrawList->_OwnerName = Name;
+    DrawCacheSkipList = NULL;
+    DrawCacheFingerprint = DrawCacheLastFingerprint = DrawCacheStateHash = 0;
+    DrawCacheStable = DrawCacheReplaying = false;
     ParentWindow = NULL;
     RootWindow = NULL;
     RootWindowForTitleBarHighlight = NULL;
@@ -1991,6 +2147,7 @@ ImGuiWindow::ImGuiWindow(ImGuiContext* context, const char* name)
 ImGuiWindow::~ImGuiWindow()
 {
     IM_ASSERT(DrawList == &DrawListInst);
+    IM_DELETE(DrawCacheSkipList);
     IM_DELETE(Name);
     for (int i = 0; i != ColumnsStorage.Size; i++)
         ColumnsStorage[i].~ImGuiColumnsSet();
@@ -2611,18 +2768,169 @@ float ImGui::CalcWrapWidthForPos(const ImVec2& pos, float wrap_pos_x)
 
 //-----------------------------------------------------------------------------
 
+static inline int AllocRecordSlot(void* ptr, int capacity)
+{
+    return (int)((((size_t)ptr >> 4) * 2654435761u) & (size_t)(capacity - 1));
+}
+
+static void AllocRecordInsert(void* ptr, size_t sz, ImGuiAllocTag tag)
+{
+    // Keep the load factor under 1/2
+    if ((GImAllocatorRecordsCount + 1) * 2 > GImAllocatorRecordsCapacity)
+    {
+        const int old_capacity = GImAllocatorRecordsCapacity;
+        ImGuiAllocRecord* old_records = GImAllocatorRecords;
+        GImAllocatorRecordsCapacity = old_capacity ? old_capacity * 2 : 256;
+        GImAllocatorRecords = (ImGuiAllocRecord*)GImAllocatorAllocFunc((size_t)GImAllocatorRecordsCapacity * sizeof(ImGuiAllocRecord), GImAllocatorUserData);
+        memset(GImAllocatorRecords, 0, (size_t)GImAllocatorRecordsCapacity * sizeof(ImGuiAllocRecord));
+        for (int n = 0; n < old_capacity; n++)
+            if (old_records[n].Ptr)
+            {
+                int slot = AllocRecordSlot(old_records[n].Ptr, GImAllocatorRecordsCapacity);
+                while (GImAllocatorRecords[slot].Ptr)
+                    slot = (slot + 1) & (GImAllocatorRecordsCapacity - 1);
+                GImAllocatorRecords[slot] = old_records[n];
+            }
+        if (old_records)
+            GImAllocatorFreeFunc(old_records, GImAllocatorUserData);
+    }
+    int slot = AllocRecordSlot(ptr, GImAllocatorRecordsCapacity);
+    while (GImAllocatorRecords[slot].Ptr)
+        slot = (slot + 1) & (GImAllocatorRecordsCapacity - 1);
+    GImAllocatorRecords[slot].Ptr = ptr;
+    GImAllocatorRecords[slot].Size = sz;
+    GImAllocatorRecords[slot].Tag = tag;
+    GImAllocatorRecordsCount++;
+}
+
+static bool AllocRecordRemove(void* ptr, ImGuiAllocRecord* out_record)
+{
+    if (GImAllocatorRecordsCount == 0)
+        return false;
+    const int mask = GImAllocatorRecordsCapacity - 1;
+    int slot = AllocRecordSlot(ptr, GImAllocatorRecordsCapacity);
+    while (GImAllocatorRecords[slot].Ptr != ptr)
+    {
+        if (GImAllocatorRecords[slot].Ptr == NULL)
+            return false;
+        slot = (slot + 1) & mask;
+    }
+    *out_record = GImAllocatorRecords[slot];
+    GImAllocatorRecordsCount--;
+
+    // Backward shift deletion: move up the following records of the cluster that would not be found anymore
+    int hole = slot;
+    for (int next = (slot + 1) & mask; GImAllocatorRecords[next].Ptr != NULL; next = (next + 1) & mask)
+    {
+        const int home = AllocRecordSlot(GImAllocatorRecords[next].Ptr, GImAllocatorRecordsCapacity);
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            GImAllocatorRecords[hole] = GImAllocatorRecords[next];
+            hole = next;
+        }
+    }
+    GImAllocatorRecords[hole].Ptr = NULL;
+    return true;
+}
+
 void* ImGui::MemAlloc(size_t sz)
 {
+    void* ptr = GImAllocatorAllocFunc(sz, GImAllocatorUserData);
+    IMGUI_ALLOC_LOCK();
     GImAllocatorActiveAllocationsCount++;
-    return GImAllocatorAllocFunc(sz, GImAllocatorUserData);
+    GImAllocatorTotalCount++;
+    if (ptr)
+    {
+        AllocRecordInsert(ptr, sz, GImAllocatorCurrentTag);
+        ImGuiAllocStats& stats = GImAllocatorStats[GImAllocatorCurrentTag];
+        stats.TotalCount++;
+        stats.LiveCount++;
+        stats.LiveBytes += sz;
+        stats.PeakCount = ImMax(stats.PeakCount, stats.LiveCount);
+        if (stats.LiveBytes > stats.PeakBytes)
+            stats.PeakBytes = stats.LiveBytes;
+    }
+    IMGUI_ALLOC_UNLOCK();
+    return ptr;
 }
 
 void ImGui::MemFree(void* ptr)
 {
-    if (ptr) GImAllocatorActiveAllocationsCount--;
+    if (ptr)
+    {
+        IMGUI_ALLOC_LOCK();
+        GImAllocatorActiveAllocationsCount--;
+        ImGuiAllocRecord record;
+        if (AllocRecordRemove(ptr, &record))
+        {
+            ImGuiAllocStats& stats = GImAllocatorStats[record.Tag];
+            stats.LiveCount--;
+            stats.LiveBytes -= record.Size;
+        }
+        IMGUI_ALLOC_UNLOCK();
+    }
     return GImAllocatorFreeFunc(ptr, GImAllocatorUserData);
 }
 
+ImGuiAllocTag ImGui::SetAllocTag(ImGuiAllocTag tag)
+{
+    IM_ASSERT(tag >= 0 && tag < ImGuiAllocTag_COUNT);
+    ImGuiAllocTag backup_tag = GImAllocatorCurrentTag;
+    GImAllocatorCurrentTag = tag;
+    return backup_tag;
+}
+
+const ImGuiAllocStats& ImGui::GetAllocStats(ImGuiAllocTag tag)
+{
+    IM_ASSERT(tag >= 0 && tag < ImGuiAllocTag_COUNT);
+    return GImAllocatorStats[tag];
+}
+
+void* ImGui::MemAllocFrame(size_t size)
+{
+    return GImGui->FrameArena.Alloc(size);
+}
+
+void* ImGuiFrameArena::Alloc(size_t size)
+{
+    const int offset = (BlockUsed + 15) & ~15;
+    if ((size_t)offset + size <= (size_t)Block.Size)
+    {
+        BlockUsed = offset + (int)size;
+        return Block.Data + offset;
+    }
+    ImGuiAllocTagScope tag_scope(ImGuiAllocTag_FrameArena);
+    void* ptr = ImGui::MemAlloc(size);
+    Overflow.push_back(ptr);
+    OverflowSize += ((int)size + 15) & ~15;
+    return ptr;
+}
+
+void ImGuiFrameArena::Reset()
+{
+    if (OverflowSize > 0)
+    {
+        ImGuiAllocTagScope tag_scope(ImGuiAllocTag_FrameArena);
+        const int new_size = Block.Size + OverflowSize;
+        Block.clear();
+        Block.resize(new_size);
+        FreeOverflow();
+    }
+
+    // Overwrite the released scratch data, so reading it after the frame it was allocated in doesn't go unnoticed
+    if (BlockUsed > 0)
+        memset(Block.Data, 0xDD, (size_t)BlockUsed);
+    BlockUsed = 0;
+}
+
+void ImGuiFrameArena::FreeOverflow()
+{
+    for (int n = 0; n < Overflow.Size; n++)
+        ImGui::MemFree(Overflow[n]);
+    Overflow.resize(0);
+    OverflowSize = 0;
+}
+
 const char* ImGui::GetClipboardText()
 {
     return GImGui->IO.GetClipboardTextFn ? GImGui->IO.GetClipboardTextFn(GImGui->IO.ClipboardUserData) : "";
@@ -3580,6 +3888,7 @@ void ImGui::UpdatePlatformWindows()
     g.Viewports[0]->LastPos = g.Viewports[0]->Pos;
     if (!(g.IO.ConfigFlags & ImGuiConfigFlags_ViewportsEnable))
         return;
+    IMGUI_PROFILE_SCOPE("UpdatePlatformWindows");
 
     // Create/resize/destroy platform windows to match each active viewport.
     // Skip the main viewport (index 0), which is always fully handled by the application!
@@ -3702,6 +4011,7 @@ void ImGui::RenderPlatformWindowsDefault(void* platform_render_arg, void* render
 {
     if (!(ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable))
         return;
+    IMGUI_PROFILE_SCOPE("RenderPlatformWindowsDefault");
 
     // Skip the main viewport (index 0), which is always fully handled by the application!
     ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
@@ -3832,6 +4142,8 @@ void ImGui::NewFrame()
 {
     IM_ASSERT(GImGui != NULL && "No current context. Did you call ImGui::CreateContext() or ImGui::SetCurrentContext()?");
     ImGuiContext& g = *GImGui;
+    IMGUI_PROFILE_NEW_FRAME();
+    IMGUI_PROFILE_PUSH("NewFrame");
 
     // Check user data
     // (We pass an error message in the assert expression to make it visible to programmers who are not using a debugger, as most assert handlers display their argument)
@@ -3901,6 +4213,11 @@ void ImGui::NewFrame()
     g.TooltipOverrideCount = 0;
     g.WindowsActiveCount = 0;
 
+    // Release last frame scratch memory, count last frame allocations
+    g.FrameArena.Reset();
+    g.IO.MetricsAllocs = (int)(GImAllocatorTotalCount - g.FrameAllocsStart);
+    g.FrameAllocsStart = GImAllocatorTotalCount;
+
     UpdateViewports();
 
     // Setup font, draw list shared data
@@ -4049,6 +4366,7 @@ void ImGui::NewFrame()
     g.CurrentWindowStack.resize(0);
     g.CurrentPopupStack.resize(0);
     ClosePopupsOverWindow(g.NavWindow);
+    IMGUI_PROFILE_POP(); // Before the implicit window which stays open until EndFrame()
 
     // Create implicit window - we will only render it if the user has added something to it.
     // We don't use "Debug" to avoid colliding with user trying to create a "Debug" window with custom flags.
@@ -4236,6 +4554,7 @@ ImGuiWindowSettings* ImGui::FindWindowSettings(ImGuiID id)
 
 static ImGuiWindowSettings* AddWindowSettings(const char* name)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Window);
     ImGuiContext& g = *GImGui;
     g.SettingsWindows.push_back(ImGuiWindowSettings());
     ImGuiWindowSettings* settings = &g.SettingsWindows.back();
@@ -4338,6 +4657,7 @@ static void SaveIniSettingsToDisk(const char* ini_filename)
 
 static void SaveIniSettingsToMemory(ImVector<char>& out_buf)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_TextBuffer);
     ImGuiContext& g = *GImGui;
     g.SettingsDirtyTimer = 0.0f;
 
@@ -4520,6 +4840,7 @@ void ImGui::EndFrame()
     if (g.CurrentWindow && !g.CurrentWindow->WriteAccessed)
         g.CurrentWindow->Active = false;
     End();
+    IMGUI_PROFILE_SCOPE("EndFrame");
 
     SetCurrentViewport(NULL);
 
@@ -4616,6 +4937,8 @@ void ImGui::Render()
     if (g.FrameCountEnded != g.FrameCount)
         ImGui::EndFrame();
     g.FrameCountRendered = g.FrameCount;
+    IMGUI_PROFILE_SCOPE("Render");
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_DrawList);
 
     // Gather windows to render
     g.IO.MetricsRenderVertices = g.IO.MetricsRenderIndices = g.IO.MetricsActiveWindows = 0;
@@ -5437,6 +5760,13 @@ void ImGui::SetTooltip(const char* fmt, ...)
     va_end(args);
 }
 
+void ImGui::SetTooltipUnformatted(const char* text, const char* text_end)
+{
+    BeginTooltipEx(0, true);
+    TextUnformatted(text, text_end);
+    EndTooltip();
+}
+
 void ImGui::BeginTooltip()
 {
     BeginTooltipEx(0, false);
@@ -5991,6 +6321,7 @@ ImGuiWindow* ImGui::FindWindowByName(const char* name)
 
 static ImGuiWindow* CreateNewWindow(const char* name, ImVec2 size, ImGuiWindowFlags flags)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Window);
     ImGuiContext& g = *GImGui;
 
     // Create window the first time
@@ -6446,6 +6777,71 @@ static inline void ClampWindowRect(ImGuiWindow* window, const ImRect& rect, cons
     window->Pos = ImMin(rect.Max - padding, ImMax(window->Pos + window->Size, rect.Min + padding) - window->Size);
 }
 
+// ImGuiWindowFlags_RetainDrawList: decide if last frame vertices can be displayed again.
+// When they can, DrawList points to DrawCacheSkipList for the frame: widgets still run and their primitives are fingerprinted but not tessellated.
+static void UpdateWindowDrawCache(ImGuiWindow* window)
+{
+    ImGuiContext& g = *GImGui;
+    ImGuiIO& io = g.IO;
+
+    // Compare last frame submissions with the ones DrawListInst was built from
+    if (!window->WasActive)
+    {
+        window->DrawCacheStable = false;
+    }
+    else if (window->DrawCacheReplaying)
+    {
+        // Content changed without any input: last frame displayed stale vertices, rebuild now
+        if (window->DrawCacheLastFingerprint != window->DrawCacheFingerprint)
+            window->DrawCacheStable = false;
+    }
+    else
+    {
+        window->DrawCacheStable = (window->DrawCacheLastFingerprint == window->DrawCacheFingerprint);
+        window->DrawCacheFingerprint = window->DrawCacheLastFingerprint;
+    }
+
+    // State that affects this frame submissions before they can be fingerprinted. A spurious change only costs a rebuild.
+    ImU32 state_hash = ImHash(&window->Pos, sizeof(ImVec2), 0);
+    state_hash = ImHash(&window->Size, sizeof(ImVec2), state_hash);
+    state_hash = ImHash(&window->SizeContents, sizeof(ImVec2), state_hash);
+    state_hash = ImHash(&window->Scroll, sizeof(ImVec2), state_hash);
+    state_hash = ImHash(&g.Style, sizeof(ImGuiStyle), state_hash);
+    const void* state_ptrs[] = { g.Font, io.Fonts->TexID, g.HoveredWindow, g.NavWindow, g.NavWindowingTarget };
+    state_hash = ImHash(state_ptrs, sizeof(state_ptrs), state_hash);
+    const ImU32 state_values[] = { g.HoveredIdPreviousFrame, g.ActiveId, g.NavId, (ImU32)window->Collapsed, (ImU32)g.NavDisableHighlight, (ImU32)g.DragDropActive };
+    state_hash = ImHash(state_values, sizeof(state_values), state_hash);
+    const float state_floats[] = { g.FontSize, window->FontWindowScale, window->FontDpiScale };
+    state_hash = ImHash(state_floats, sizeof(state_floats), state_hash);
+
+    // Inputs processed by the widgets of this frame
+    bool has_input = window->Appearing || window->HiddenFrames > 0 || window->AutoFitFramesX > 0 || window->AutoFitFramesY > 0;
+    has_input |= (g.ActiveId != 0 && g.ActiveIdWindow == window);
+    if (g.HoveredWindow == window)
+    {
+        has_input |= (io.MouseDelta.x != 0.0f || io.MouseDelta.y != 0.0f || io.MouseWheel != 0.0f || io.MouseWheelH != 0.0f);
+        for (int n = 0; n < IM_ARRAYSIZE(io.MouseDown) && !has_input; n++)
+            has_input |= (io.MouseDown[n] || io.MouseReleased[n]);
+    }
+    if (g.NavWindow == window)
+    {
+        has_input |= (io.InputCharacters[0] != 0 || io.KeyCtrl || io.KeyShift || io.KeyAlt || io.KeySuper);
+        for (int n = 0; n < IM_ARRAYSIZE(io.KeysDown) && !has_input; n++)
+            has_input |= io.KeysDown[n];
+        for (int n = 0; n < IM_ARRAYSIZE(io.NavInputs) && !has_input; n++)
+            has_input |= (io.NavInputs[n] > 0.0f);
+    }
+
+    window->DrawCacheReplaying = window->DrawCacheStable && !has_input && state_hash == window->DrawCacheStateHash;
+    window->DrawCacheStateHash = state_hash;
+    if (window->DrawCacheReplaying && window->DrawCacheSkipList == NULL)
+    {
+        window->DrawCacheSkipList = IM_NEW(ImDrawList)(&g.DrawListSharedData);
+        window->DrawCacheSkipList->_OwnerName = window->Name;
+    }
+    window->DrawList = window->DrawCacheReplaying ? window->DrawCacheSkipList : &window->DrawListInst;
+}
+
 // Push a new ImGui window to add widgets to.
 // - A default window called "Debug" is automatically stacked at the beginning of every frame so you can use widgets without explicitly calling a Begin/End pair.
 // - Begin/End can be called multiple times during the frame with the same window name to append content.
@@ -6455,6 +6851,7 @@ static inline void ClampWindowRect(ImGuiWindow* window, const ImRect& rect, cons
 // - Passing 'bool* p_open' displays a Close button on the upper-right corner of the window, the pointed value will be set to false when the button is pressed.
 bool ImGui::Begin(const char* name, bool* p_open, ImGuiWindowFlags flags)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Window);
     ImGuiContext& g = *GImGui;
     const ImGuiStyle& style = g.Style;
     IM_ASSERT(name != NULL);                        // Window name required
@@ -6518,7 +6915,10 @@ bool ImGui::Begin(const char* name, bool* p_open, ImGuiWindowFlags flags)
     // Add to stack
     // We intentionally set g.CurrentWindow to NULL to prevent usage until when the viewport is set, then will call SetCurrentWindow()
     g.CurrentWindowStack.push_back(window);
+    IMGUI_PROFILE_WINDOW_PUSH(window);
     g.CurrentWindow = NULL;
+    if (!first_begin_of_the_frame && window->DrawCacheReplaying)
+        window->DrawList = window->DrawCacheSkipList;
     CheckStacksSize(window, true);
     if (flags & ImGuiWindowFlags_Popup)
     {
@@ -6836,8 +7236,14 @@ bool ImGui::Begin(const char* name, bool* p_open, ImGuiWindowFlags flags)
         // DRAWING
 
         // Setup draw list and outer clipping rectangle
+        if (flags & ImGuiWindowFlags_RetainDrawList)
+            UpdateWindowDrawCache(window);
+        else
+            window->DrawCacheReplaying = false;
         window->DrawList->Clear();
         window->DrawList->Flags = (g.Style.AntiAliasedLines ? ImDrawListFlags_AntiAliasedLines : 0) | (g.Style.AntiAliasedFill ? ImDrawListFlags_AntiAliasedFill : 0);
+        if (flags & ImGuiWindowFlags_RetainDrawList)
+            window->DrawList->Flags |= ImDrawListFlags_Fingerprint | (window->DrawCacheReplaying ? ImDrawListFlags_SkipTessellation : 0);
         window->DrawList->PushTextureID(g.Font->ContainerAtlas->TexID);
         if ((flags & ImGuiWindowFlags_ChildWindow) && !(flags & ImGuiWindowFlags_Popup) && !window_is_child_tooltip)
             PushClipRect(parent_window->ClipRect.Min, parent_window->ClipRect.Max, true);
@@ -7167,6 +7573,13 @@ void ImGui::End()
         EndColumns();
     PopClipRect();   // Inner window clip rectangle
 
+    // Retained draw list: keep the fingerprint to validate the cache on next frame, and expose the retained vertices to Render()
+    if (window->Flags & ImGuiWindowFlags_RetainDrawList)
+    {
+        window->DrawCacheLastFingerprint = window->DrawList->_Fingerprint;
+        window->DrawList = &window->DrawListInst;
+    }
+
     // Stop logging
     if (!(window->Flags & ImGuiWindowFlags_ChildWindow))    // FIXME: add more options for scope of logging
         LogFinish();
@@ -7175,6 +7588,7 @@ void ImGui::End()
     g.CurrentWindowStack.pop_back();
     if (window->Flags & ImGuiWindowFlags_Popup)
         g.CurrentPopupStack.pop_back();
+    IMGUI_PROFILE_WINDOW_POP();
     CheckStacksSize(window, false);
     SetCurrentWindow(g.CurrentWindowStack.empty() ? NULL : g.CurrentWindowStack.back());
     if (g.CurrentWindow)
@@ -8293,6 +8707,14 @@ void ImGui::TextWrapped(const char* fmt, ...)
     va_end(args);
 }
 
+void ImGui::TextWrappedUnformatted(const char* text, const char* text_end)
+{
+    bool need_wrap = (GImGui->CurrentWindow->DC.TextWrapPos < 0.0f);    // Keep existing wrap position is one ia already set
+    if (need_wrap) PushTextWrapPos(0.0f);
+    TextUnformatted(text, text_end);
+    if (need_wrap) PopTextWrapPos();
+}
+
 void ImGui::TextUnformatted(const char* text, const char* text_end)
 {
     ImGuiWindow* window = GetCurrentWindow();
@@ -8412,6 +8834,17 @@ void ImGui::AlignTextToFramePadding()
 
 // Add a label+text combo aligned to other label+value widgets
 void ImGui::LabelTextV(const char* label, const char* fmt, va_list args)
+{
+    ImGuiWindow* window = GetCurrentWindow();
+    if (window->SkipItems)
+        return;
+
+    ImGuiContext& g = *GImGui;
+    const char* value_text_end = g.TempBuffer + ImFormatStringV(g.TempBuffer, IM_ARRAYSIZE(g.TempBuffer), fmt, args);
+    LabelTextUnformatted(label, g.TempBuffer, value_text_end);
+}
+
+void ImGui::LabelTextUnformatted(const char* label, const char* text, const char* text_end)
 {
     ImGuiWindow* window = GetCurrentWindow();
     if (window->SkipItems)
@@ -8429,9 +8862,7 @@ void ImGui::LabelTextV(const char* label, const char* fmt, va_list args)
         return;
 
     // Render
-    const char* value_text_begin = &g.TempBuffer[0];
-    const char* value_text_end = value_text_begin + ImFormatStringV(g.TempBuffer, IM_ARRAYSIZE(g.TempBuffer), fmt, args);
-    RenderTextClipped(value_bb.Min, value_bb.Max, value_text_begin, value_text_end, NULL, ImVec2(0.0f,0.5f));
+    RenderTextClipped(value_bb.Min, value_bb.Max, text, text_end, NULL, ImVec2(0.0f,0.5f));
     if (label_size.x > 0.0f)
         RenderText(ImVec2(value_bb.Max.x + style.ItemInnerSpacing.x, value_bb.Min.y + style.FramePadding.y), label);
 }
@@ -10811,6 +11242,7 @@ static bool InputTextFilterCharacter(unsigned int* p_char, ImGuiInputTextFlags f
 // FIXME: Rather messy function partly because we are doing UTF8 > u16 > UTF8 conversions on the go to more easily handle stb_textedit calls. Ideally we should stay in UTF-8 all the time. See https://github.com/nothings/stb/issues/188
 bool ImGui::InputTextEx(const char* label, char* buf, int buf_size, const ImVec2& size_arg, ImGuiInputTextFlags flags, ImGuiTextEditCallback callback, void* user_data)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_TextBuffer);
     ImGuiWindow* window = GetCurrentWindow();
     if (window->SkipItems)
         return false;
@@ -14012,6 +14444,150 @@ void ImGui::EndDragDropTarget()
     IM_ASSERT(g.DragDropActive);
 }
 
+//-----------------------------------------------------------------------------
+// PROFILER
+//-----------------------------------------------------------------------------
+
+#ifdef IMGUI_ENABLE_PROFILER
+
+static ImU64 ProfilerGetTicks()
+{
+    return (ImU64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Close the frame being recorded and start a new one. Called at the beginning of NewFrame().
+void ImGui::ProfilerNewFrame()
+{
+    ImGuiContext& g = *GImGui;
+    ImGuiProfiler& profiler = g.Profiler;
+    const ImU64 now = ProfilerGetTicks();
+
+    ImGuiProfilerFrame& prev_frame = profiler.Frames[profiler.FrameIdx];
+    if (profiler.Recording && prev_frame.FrameCount >= 0)
+    {
+        // Scopes left open across the frame boundary are closed here
+        for (int n = 0; n < profiler.Stack.Size; n++)
+            prev_frame.Events[profiler.Stack[n]].EndTicks = now;
+        prev_frame.EndTicks = now;
+        profiler.FrameIdx = (profiler.FrameIdx + 1) % IMGUI_PROFILER_FRAMES;
+    }
+    profiler.Stack.resize(0);
+    profiler.Recording = !profiler.Paused;
+
+    ImGuiProfilerFrame& frame = profiler.Frames[profiler.FrameIdx];
+    frame.FrameCount = profiler.Recording ? g.FrameCount + 1 : -1;
+    frame.StartTicks = frame.EndTicks = now;
+    frame.Events.resize(0);
+    frame.NameBuffer.resize(0);
+}
+
+void ImGui::ProfilerPush(const char* name, bool copy_name)
+{
+    ImGuiContext& g = *GImGui;
+    ImGuiProfiler& profiler = g.Profiler;
+    if (!profiler.Recording)
+        return;
+
+    ImGuiProfilerFrame& frame = profiler.Frames[profiler.FrameIdx];
+    ImGuiProfilerEvent ev;
+    ev.Name = copy_name ? NULL : name;
+    ev.NameOffset = 0;
+    if (copy_name)
+    {
+        const int name_size = (int)strlen(name) + 1;
+        ev.NameOffset = frame.NameBuffer.Size;
+        frame.NameBuffer.resize(frame.NameBuffer.Size + name_size);
+        memcpy(frame.NameBuffer.Data + ev.NameOffset, name, (size_t)name_size);
+    }
+    ev.WindowID = 0;
+    ev.Depth = profiler.Stack.Size;
+    profiler.Stack.push_back(frame.Events.Size);
+    frame.Events.push_back(ev);
+    frame.Events.back().StartTicks = frame.Events.back().EndTicks = ProfilerGetTicks();
+}
+
+void ImGui::ProfilerPushWindow(ImGuiWindow* window)
+{
+    ImGuiContext& g = *GImGui;
+    if (!g.Profiler.Recording)
+        return;
+    ProfilerPush(window->Name);
+    g.Profiler.Frames[g.Profiler.FrameIdx].Events.back().WindowID = window->ID;
+}
+
+void ImGui::ProfilerPop()
+{
+    ImGuiContext& g = *GImGui;
+    ImGuiProfiler& profiler = g.Profiler;
+    if (!profiler.Recording || profiler.Stack.empty())
+        return;
+    profiler.Frames[profiler.FrameIdx].Events[profiler.Stack.back()].EndTicks = ProfilerGetTicks();
+    profiler.Stack.pop_back();
+}
+
+static void ProfilerWriteJsonString(FILE* f, const char* s)
+{
+    fputc('"', f);
+    for (; *s; s++)
+    {
+        const unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+bool ImGui::ProfilerExportChromeTrace(const char* filename, int frames_count)
+{
+    ImGuiContext& g = *GImGui;
+    ImGuiProfiler& profiler = g.Profiler;
+    if (frames_count < 0 || frames_count > IMGUI_PROFILER_FRAMES - 1)
+        frames_count = IMGUI_PROFILER_FRAMES - 1;
+
+    FILE* f = ImFileOpen(filename, "wt");
+    if (!f)
+        return false;
+
+    // Completed frames from oldest to newest. The frame currently being recorded is skipped.
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first_event = true;
+    ImU64 base_ticks = 0;
+    for (int age = frames_count; age >= 1; age--)
+    {
+        const ImGuiProfilerFrame& frame = profiler.Frames[(profiler.FrameIdx + IMGUI_PROFILER_FRAMES - age) % IMGUI_PROFILER_FRAMES];
+        if (frame.FrameCount < 0 || frame.EndTicks < frame.StartTicks)
+            continue;
+        if (first_event)
+            base_ticks = frame.StartTicks;
+        fprintf(f, "%s\n{\"name\":\"Frame %d\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}", first_event ? "" : ",",
+            frame.FrameCount, (frame.StartTicks - base_ticks) / 1000.0, (frame.EndTicks - frame.StartTicks) / 1000.0);
+        first_event = false;
+        for (int n = 0; n < frame.Events.Size; n++)
+        {
+            const ImGuiProfilerEvent& ev = frame.Events[n];
+            fprintf(f, ",\n{\"name\":");
+            ProfilerWriteJsonString(f, frame.GetName(ev));
+            fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}", ev.WindowID ? "window" : "scope",
+                (ev.StartTicks - base_ticks) / 1000.0, (ev.EndTicks - ev.StartTicks) / 1000.0);
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return true;
+}
+
+#else
+
+void ImGui::ProfilerPush(const char*, bool) {}
+void ImGui::ProfilerPop() {}
+bool ImGui::ProfilerExportChromeTrace(const char*, int) { return false; }
+
+#endif // #ifdef IMGUI_ENABLE_PROFILER
+
 //-----------------------------------------------------------------------------
 // PLATFORM DEPENDENT HELPERS
 //-----------------------------------------------------------------------------
@@ -14162,7 +14738,7 @@ void ImGui::ShowMetricsWindow(bool* p_open)
         ImGui::Text("Dear ImGui %s", ImGui::GetVersion());
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
         ImGui::Text("%d vertices, %d indices (%d triangles)", ImGui::GetIO().MetricsRenderVertices, ImGui::GetIO().MetricsRenderIndices, ImGui::GetIO().MetricsRenderIndices / 3);
-        ImGui::Text("%d allocations", (int)GImAllocatorActiveAllocationsCount);
+        ImGui::Text("%d allocations, %d MemAlloc() calls last frame", (int)GImAllocatorActiveAllocationsCount, ImGui::GetIO().MetricsAllocs);
         static bool show_clip_rects = true;
         static bool show_window_begin_order = false;
         ImGui::Checkbox("Show clipping rectangles when hovering draw commands", &show_clip_rects);
@@ -14269,6 +14845,8 @@ void ImGui::ShowMetricsWindow(bool* p_open)
                     ImGui::BulletText("NavRectRel[0]: <None>");
                 ImGui::BulletText("Viewport: %d, ViewportId: 0x%08X, ViewportPos: (%.1f,%.1f)", window->Viewport ? window->Viewport->Idx : -1, window->ViewportId, window->ViewportPos.x, window->ViewportPos.y);
                 ImGui::BulletText("ViewportMonitor: %d", window->Viewport ? window->Viewport->PlatformMonitor : -1);
+                if (window->Flags & ImGuiWindowFlags_RetainDrawList)
+                    ImGui::BulletText("RetainDrawList: Stable %d, Replaying %d, Fingerprint 0x%08X", window->DrawCacheStable, window->DrawCacheReplaying, window->DrawCacheFingerprint);
                 if (window->RootWindow != window) NodeWindow(window->RootWindow, "RootWindow");
                 if (window->ParentWindow != NULL) NodeWindow(window->ParentWindow, "ParentWindow");
                 if (window->DC.ChildWindows.Size > 0) NodeWindows(window->DC.ChildWindows, "ChildWindows");
@@ -14310,6 +14888,22 @@ void ImGui::ShowMetricsWindow(bool* p_open)
                     ImGui::TreePop();
                 }
             }
+
+#ifdef IMGUI_ENABLE_PROFILER
+            // Events are stored depth-first, return the index following the subtree of 'event_n'
+            static int NodeProfilerEvent(const ImGuiProfilerFrame* frame, int event_n)
+            {
+                const ImGuiProfilerEvent& ev = frame->Events[event_n];
+                int next_n = event_n + 1;
+                const bool has_children = next_n < frame->Events.Size && frame->Events[next_n].Depth > ev.Depth;
+                const bool node_open = ImGui::TreeNodeEx((void*)(intptr_t)event_n, has_children ? 0 : (ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen), "%s: %.3f ms", frame->GetName(ev), (ev.EndTicks - ev.StartTicks) / 1000000.0);
+                while (next_n < frame->Events.Size && frame->Events[next_n].Depth > ev.Depth)
+                    next_n = (node_open && has_children) ? NodeProfilerEvent(frame, next_n) : next_n + 1;
+                if (node_open && has_children)
+                    ImGui::TreePop();
+                return next_n;
+            }
+#endif
         };
 
         // Access private state, we are going to display the draw lists from last frame
@@ -14365,6 +14959,89 @@ void ImGui::ShowMetricsWindow(bool* p_open)
             ImGui::Text("MousePosViewport: 0x%08X, Hovered: 0x%08X -> Ref 0x%08X", g.IO.MousePosViewport, g.IO.MouseHoveredViewport, g.MouseRefViewport->ID);
             ImGui::TreePop();
         }
+        if (ImGui::TreeNode("Memory"))
+        {
+            const char* tag_names[] = { "Other", "Window", "DrawList", "Font", "Storage", "TextBuffer", "FrameArena" }; IM_ASSERT(IM_ARRAYSIZE(tag_names) == ImGuiAllocTag_COUNT);
+            ImGui::Columns(6, "##memory");
+            ImGui::Text("Tag"); ImGui::NextColumn();
+            ImGui::Text("Live"); ImGui::NextColumn();
+            ImGui::Text("Live KB"); ImGui::NextColumn();
+            ImGui::Text("Peak"); ImGui::NextColumn();
+            ImGui::Text("Peak KB"); ImGui::NextColumn();
+            ImGui::Text("Total"); ImGui::NextColumn();
+            ImGui::Separator();
+            for (int tag = 0; tag < ImGuiAllocTag_COUNT; tag++)
+            {
+                const ImGuiAllocStats& stats = ImGui::GetAllocStats(tag);
+                ImGui::Text("%s", tag_names[tag]); ImGui::NextColumn();
+                ImGui::Text("%d", stats.LiveCount); ImGui::NextColumn();
+                ImGui::Text("%.1f", stats.LiveBytes / 1024.0f); ImGui::NextColumn();
+                ImGui::Text("%d", stats.PeakCount); ImGui::NextColumn();
+                ImGui::Text("%.1f", stats.PeakBytes / 1024.0f); ImGui::NextColumn();
+                ImGui::Text("%llu", (unsigned long long)stats.TotalCount); ImGui::NextColumn();
+            }
+            ImGui::Columns(1);
+            ImGui::Text("Frame arena: %d / %d bytes used, %d overflow allocations", g.FrameArena.BlockUsed, g.FrameArena.Block.Size, g.FrameArena.Overflow.Size);
+            ImGui::TreePop();
+        }
+#ifdef IMGUI_ENABLE_PROFILER
+        if (ImGui::TreeNode("Profiler"))
+        {
+            ImGuiProfiler& profiler = g.Profiler;
+            static int export_frames_count = 60;
+            ImGui::Checkbox("Pause", &profiler.Paused);
+            ImGui::SameLine();
+            ImGui::PushItemWidth(ImGui::GetFontSize() * 6);
+            ImGui::InputInt("Frames", &export_frames_count);
+            ImGui::PopItemWidth();
+            ImGui::SameLine();
+            if (ImGui::Button("Export imgui_trace.json"))
+                ImGui::ProfilerExportChromeTrace("imgui_trace.json", export_frames_count);
+            if (const ImGuiProfilerFrame* frame = profiler.GetLastFrame())
+            {
+                ImGui::Text("Frame %d: %.3f ms, %d scopes", frame->FrameCount, (frame->EndTicks - frame->StartTicks) / 1000000.0, frame->Events.Size);
+                if (ImGui::TreeNode("Scopes"))
+                {
+                    for (int event_n = 0; event_n < frame->Events.Size; )
+                        event_n = Funcs::NodeProfilerEvent(frame, event_n);
+                    ImGui::TreePop();
+                }
+                if (ImGui::TreeNode("Windows"))
+                {
+                    // Window times are inclusive of their child windows
+                    ImGuiStorage& window_ms = profiler.WindowTimes;
+                    window_ms.Data.resize(0);
+                    for (int event_n = 0; event_n < frame->Events.Size; event_n++)
+                        if (ImGuiID id = frame->Events[event_n].WindowID)
+                        {
+                            float* ms = window_ms.GetFloatRef(id, 0.0f);
+                            *ms += (frame->Events[event_n].EndTicks - frame->Events[event_n].StartTicks) / 1000000.0f;
+                        }
+                    ImGui::Columns(5, "##profiler_windows");
+                    ImGui::Text("Window"); ImGui::NextColumn();
+                    ImGui::Text("CPU ms"); ImGui::NextColumn();
+                    ImGui::Text("Vertices"); ImGui::NextColumn();
+                    ImGui::Text("Indices"); ImGui::NextColumn();
+                    ImGui::Text("Draw cmds"); ImGui::NextColumn();
+                    ImGui::Separator();
+                    for (int n = 0; n < g.Windows.Size; n++)
+                    {
+                        ImGuiWindow* window = g.Windows[n];
+                        if (!window->WasActive)
+                            continue;
+                        ImGui::TextUnformatted(window->Name); ImGui::NextColumn();
+                        ImGui::Text("%.3f", window_ms.GetFloat(window->ID)); ImGui::NextColumn();
+                        ImGui::Text("%d", window->DrawList->VtxBuffer.Size); ImGui::NextColumn();
+                        ImGui::Text("%d", window->DrawList->IdxBuffer.Size); ImGui::NextColumn();
+                        ImGui::Text("%d", window->DrawList->CmdBuffer.Size); ImGui::NextColumn();
+                    }
+                    ImGui::Columns(1);
+                    ImGui::TreePop();
+                }
+            }
+            ImGui::TreePop();
+        }
+#endif
         if (show_window_begin_order)
         {
             for (int n = 0; n < g.Windows.Size; n++)
@@ -71,9 +71,11 @@ struct ImGuiTextBuffer;             // Text buffer for logging/accumulating text
 struct ImGuiTextEditCallbackData;   // Shared state of ImGui::InputText() when using custom ImGuiTextEditCallback (rare/advanced use)
 struct ImGuiSizeCallbackData;       // Structure used to constraint window size in custom ways when using custom ImGuiSizeCallback (rare/advanced use)
 struct ImGuiListClipper;            // Helper to manually clip large list of items
+struct ImGuiListClipperVariable;    // Helper to manually clip large list of items of varying height
 struct ImGuiPayload;                // User data payload for drag and drop operations
 struct ImGuiViewport;               // Viewport (generally ~1 per window to output to at the OS level. Need per-platform support to use multiple viewports)
 struct ImGuiPlatformIO;             // Multi-viewport support: interface for Platform/Renderer back-ends + viewports to render
+struct ImGuiAllocStats;             // Live/peak counters of ImGui::MemAlloc() allocations for one ImGuiAllocTag
 struct ImGuiContext;                // ImGui context (opaque)
 
 #ifndef ImTextureID
@@ -91,6 +93,7 @@ typedef int ImGuiKey;               // enum: a key identifier (ImGui-side enum)
 typedef int ImGuiNavInput;          // enum: an input identifier for navigation // enum ImGuiNavInput_
 typedef int ImGuiMouseCursor;       // enum: a mouse cursor identifier          // enum ImGuiMouseCursor_
 typedef int ImGuiStyleVar;          // enum: a variable identifier for styling  // enum ImGuiStyleVar_
+typedef int ImGuiAllocTag;          // enum: a subsystem for memory accounting  // enum ImGuiAllocTag_
 typedef int ImDrawCornerFlags;      // flags: for ImDrawList::AddRect*() etc.   // enum ImDrawCornerFlags_
 typedef int ImDrawListFlags;        // flags: for ImDrawList                    // enum ImDrawListFlags_
 typedef int ImFontAtlasFlags;       // flags: for ImFontAtlas                   // enum ImFontAtlasFlags_
@@ -304,8 +307,10 @@ namespace ImGui
     IMGUI_API void          TextDisabledV(const char* fmt, va_list args)                    IM_FMTLIST(1);
     IMGUI_API void          TextWrapped(const char* fmt, ...)                               IM_FMTARGS(1); // shortcut for PushTextWrapPos(0.0f); Text(fmt, ...); PopTextWrapPos();. Note that this won't work on an auto-resizing window if there's no other widgets to extend the window width, yoy may need to set a size using SetNextWindowSize().
     IMGUI_API void          TextWrappedV(const char* fmt, va_list args)                     IM_FMTLIST(1);
+    IMGUI_API void          TextWrappedUnformatted(const char* text, const char* text_end = NULL);         // raw text variant of TextWrapped(), no formatting pass and no buffer size limit
     IMGUI_API void          LabelText(const char* label, const char* fmt, ...)              IM_FMTARGS(2); // display text+label aligned the same way as value+label widgets
     IMGUI_API void          LabelTextV(const char* label, const char* fmt, va_list args)    IM_FMTLIST(2);
+    IMGUI_API void          LabelTextUnformatted(const char* label, const char* text, const char* text_end = NULL); // raw text variant of LabelText()
     IMGUI_API void          BulletText(const char* fmt, ...)                                IM_FMTARGS(1); // shortcut for Bullet()+Text()
     IMGUI_API void          BulletTextV(const char* fmt, va_list args)                      IM_FMTLIST(1);
 
@@ -423,6 +428,7 @@ namespace ImGui
     // Tooltips
     IMGUI_API void          SetTooltip(const char* fmt, ...) IM_FMTARGS(1);                     // set text tooltip under mouse-cursor, typically use with ImGui::IsItemHovered(). overidde any previous call to SetTooltip().
     IMGUI_API void          SetTooltipV(const char* fmt, va_list args) IM_FMTLIST(1);
+    IMGUI_API void          SetTooltipUnformatted(const char* text, const char* text_end = NULL);       // raw text variant of SetTooltip()
     IMGUI_API void          BeginTooltip();                                                     // begin/append a tooltip window. to create full-featured tooltip (with any kind of contents).
     IMGUI_API void          EndTooltip();
 
@@ -559,9 +565,28 @@ namespace ImGui
     IMGUI_API void          SetAllocatorFunctions(void* (*alloc_func)(size_t sz, void* user_data), void(*free_func)(void* ptr, void* user_data), void* user_data = NULL);
     IMGUI_API void*         MemAlloc(size_t size);
     IMGUI_API void          MemFree(void* ptr);
+    IMGUI_API ImGuiAllocTag SetAllocTag(ImGuiAllocTag tag);                                     // account the following MemAlloc() calls to 'tag', return the previous tag. ImGui sets its own tags around its subsystems.
+    IMGUI_API const ImGuiAllocStats& GetAllocStats(ImGuiAllocTag tag);                          // counters of MemAlloc() calls, shared by all contexts. Memory handed over to ImGui but not allocated with MemAlloc() is not accounted.
+    IMGUI_API void*         MemAllocFrame(size_t size);                                         // scratch memory from the current context frame arena, 16-bytes aligned. Released (and overwritten) by the next NewFrame(), never free it. Doesn't call MemAlloc() once the arena has grown to the frame needs.
+
+    // Profiler
+    // Hierarchical CPU timing of the frame. Requires '#define IMGUI_ENABLE_PROFILER' in imconfig.h, otherwise those functions are empty and IMGUI_PROFILE_SCOPE() compiles to nothing.
+    // Scopes are recorded in a ring buffer of the last IMGUI_PROFILER_FRAMES frames (a frame runs from one NewFrame() to the next). Inspect them in the Metrics window.
+    IMGUI_API void          ProfilerPush(const char* name, bool copy_name = false);             // open a timed scope. 'name' must outlive the ring buffer (string literal) unless copy_name is set.
+    IMGUI_API void          ProfilerPop();                                                      // close the last scope opened with ProfilerPush().
+    IMGUI_API bool          ProfilerExportChromeTrace(const char* filename, int frames_count = -1); // write the last 'frames_count' completed frames (-1: all recorded) as Chrome trace JSON, viewable in chrome://tracing.
 
 } // namespace ImGui
 
+#ifdef IMGUI_ENABLE_PROFILER
+struct ImGuiProfileScope { ImGuiProfileScope(const char* name) { ImGui::ProfilerPush(name); } ~ImGuiProfileScope() { ImGui::ProfilerPop(); } };
+#define IMGUI_PROFILE_CAT_(_A,_B)   _A##_B
+#define IMGUI_PROFILE_CAT(_A,_B)    IMGUI_PROFILE_CAT_(_A,_B)
+#define IMGUI_PROFILE_SCOPE(_NAME)  ImGuiProfileScope IMGUI_PROFILE_CAT(imgui_profile_scope_, __LINE__)(_NAME)
+#else
+#define IMGUI_PROFILE_SCOPE(_NAME)
+#endif
+
 // Flags for ImGui::Begin()
 enum ImGuiWindowFlags_
 {
@@ -586,6 +611,7 @@ enum ImGuiWindowFlags_
     ImGuiWindowFlags_NoNavInputs            = 1 << 18,  // No gamepad/keyboard navigation within the window
     ImGuiWindowFlags_NoNavFocus             = 1 << 19,  // No focusing toward this window with gamepad/keyboard navigation (e.g. skipped by CTRL+TAB)
     ImGuiWindowFlags_NoNav                  = ImGuiWindowFlags_NoNavInputs | ImGuiWindowFlags_NoNavFocus,
+    ImGuiWindowFlags_RetainDrawList         = 1 << 20,  // [BETA] Reuse last frame vertices/indices when the window primitives are identical (fingerprinted) and the window receives no input, skipping tessellation. Content changes that are not caused by input are displayed one frame late. Not compatible with ImDrawData::ScaleClipRects()/DeIndexAllBuffers().
 
     // [Internal]
     ImGuiWindowFlags_NavFlattened           = 1 << 23,  // [BETA] Allow gamepad/keyboard navigation to cross over parent border to this child (only use on child that have no scrolling!)
@@ -961,6 +987,28 @@ enum ImGuiMouseCursor_
 #endif
 };
 
+// Subsystems for memory accounting, see ImGui::SetAllocTag(), ImGui::GetAllocStats() and the Metrics window
+enum ImGuiAllocTag_
+{
+    ImGuiAllocTag_Other,
+    ImGuiAllocTag_Window,           // Windows, window stacks and settings
+    ImGuiAllocTag_DrawList,         // ImDrawList buffers and draw data
+    ImGuiAllocTag_Font,             // ImFontAtlas, ImFont, glyphs and texture data
+    ImGuiAllocTag_Storage,          // ImGuiStorage
+    ImGuiAllocTag_TextBuffer,       // ImGuiTextBuffer, ImGuiTextFilter, InputText() buffers
+    ImGuiAllocTag_FrameArena,       // ImGui::MemAllocFrame() blocks
+    ImGuiAllocTag_COUNT
+};
+
+struct ImGuiAllocStats
+{
+    int         LiveCount;          // Allocations not freed yet
+    int         PeakCount;
+    size_t      LiveBytes;
+    size_t      PeakBytes;
+    ImU64       TotalCount;         // MemAlloc() calls since startup
+};
+
 // Condition for ImGui::SetWindow***(), SetNextWindow***(), SetNextTreeNode***() functions
 // Important: Treat as a regular enum! Do NOT combine multiple values using binary operators! All the functions above treat 0 as a shortcut to ImGuiCond_Always. 
 enum ImGuiCond_
@@ -1102,6 +1150,7 @@ struct ImGuiIO
     int         MetricsRenderVertices;      // Vertices output during last call to Render()
     int         MetricsRenderIndices;       // Indices output during last call to Render() = number of triangles * 3
     int         MetricsActiveWindows;       // Number of visible root windows (exclude child windows)
+    int         MetricsAllocs;              // Number of ImGui::MemAlloc() calls during the previous frame (from NewFrame() to NewFrame(), all contexts). Zero on a steady state frame.
     ImVec2      MouseDelta;                 // Mouse delta. Note that this is zero if either current or previous position are invalid (-FLT_MAX,-FLT_MAX), so a disappearing/reappearing mouse won't have a huge delta.
 
     //------------------------------------------------------------------
@@ -1475,6 +1524,101 @@ struct ImGuiListClipper
     IMGUI_API void End();                                               // Automatically called on the last call of Step() that returns false.
 };
 
+// Helper: Fenwick tree (binary indexed tree) of prefix sums over a list of non-negative values kept by the caller.
+// Changing a value, getting the sum of the values before an item and finding the item at a sum are all O(log N).
+// Used by ImGuiListClipperVariable for item heights, and usable on its own for anything mapping items to offsets (e.g. lines to wrapped rows).
+template<typename T>
+struct ImFenwickTree
+{
+    ImVector<T>     Sums;                                               // Partial sums (1-based, Sums[0] is unused)
+
+    int             Count() const                                       { return Sums.Size > 0 ? Sums.Size - 1 : 0; }
+
+    // Rebuild after items [from, count) changed, moved or were added/removed. Items before 'from' must be the ones the sums were built from. O(count - from + log N).
+    template<typename U>
+    void Build(const U* values, int count, int from = 0)
+    {
+        if (from > Count())
+            from = Count();
+        if (from > count)
+            from = count;
+        Sums.resize(count + 1);
+        Sums[0] = (T)0;
+        for (int i = from + 1; i <= count; i++)
+            Sums[i] = (T)values[i - 1];
+        // Linear time construction: each node pushes its partial sum to its parent once. The nodes before 'from' are complete, and only those covering
+        // a prefix of [0, from) have a parent past it.
+        for (int i = from; i > 0; i -= (i & -i))
+            if (i + (i & -i) <= count)
+                Sums[i + (i & -i)] += Sums[i];
+        for (int i = from + 1; i <= count; i++)
+            if (i + (i & -i) <= count)
+                Sums[i + (i & -i)] += Sums[i];
+    }
+
+    void            Add(int idx, T delta)                               { for (int i = idx + 1; i < Sums.Size; i += (i & -i)) Sums[i] += delta; }
+    T               GetSum(int idx) const                               { T sum = (T)0; for (int i = idx; i > 0; i -= (i & -i)) sum += Sums[i]; return sum; } // Sum of items [0, idx)
+
+    // Index of the last item whose preceding items sum to 'sum' or less, i.e. the one covering 'sum' (0 if there are no items)
+    int Find(T sum) const
+    {
+        // Descend the implicit tree: find the largest 'pos' such that the sum of items [0, pos) is <= sum
+        const int count = Count();
+        int step = 1;
+        while (step * 2 <= count)
+            step *= 2;
+        int pos = 0;
+        for (; step > 0; step >>= 1)
+        {
+            if (pos + step <= count && Sums[pos + step] <= sum)
+            {
+                pos += step;
+                sum -= Sums[pos];
+            }
+        }
+        return pos < count ? pos : (count > 0 ? count - 1 : 0);
+    }
+};
+
+// Helper: Manually clip large list of items of varying height.
+// Item heights are queried from a user callback and kept in an ImFenwickTree of prefix sums, so seeking to the first visible item is O(log N)
+// and the per-frame cost is proportional to the number of visible items rather than the list size.
+// The instance must persist across frames (e.g. static or a member of your panel): the index is only rebuilt when the item count changes or Invalidate() is called.
+// When a single item changes height (wrapped text re-flowed, tree node opened) call InvalidateItem() which re-queries it in O(log N).
+// Usage:
+//     static ImGuiListClipperVariable clipper;
+//     clipper.Begin(1000000, [](void* data, int idx) { return MyRowHeight(data, idx); }, my_data);
+//     while (clipper.Step())
+//         for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+//             MyDrawRow(my_data, i);
+// - Step 0: the clipper seeks the first visible item from the prefix sums, walks forward until the clip rectangle is filled and positions the cursor before DisplayStart.
+// - Step 1: the clipper advances the cursor to the end of the list and returns 'false' to end the loop.
+// Heights must include the spacing between items, typically the result of GetTextLineHeightWithSpacing() or the measured height of a multi-line row plus ItemSpacing.y.
+struct ImGuiListClipperVariable
+{
+    typedef float (*HeightGetter)(void* user_data, int idx);
+
+    float           StartPosY;
+    int             ItemsCount, StepNo, DisplayStart, DisplayEnd;
+    HeightGetter    ItemsHeightGetter;
+    void*           UserData;
+    ImVector<float> Heights;                                            // Cached height of each item, as last returned by ItemsHeightGetter
+    ImFenwickTree<double> Tree;                                         // Prefix sums of Heights. Double so that 1M+ rows of incremental updates do not drift.
+    bool            Dirty;                                              // Re-query every height on next Begin()
+
+    ImGuiListClipperVariable()                                          { ItemsCount = 0; StepNo = 2; DisplayStart = DisplayEnd = 0; StartPosY = 0.0f; ItemsHeightGetter = NULL; UserData = NULL; Dirty = true; }
+
+    IMGUI_API void  Begin(int items_count, HeightGetter items_height_getter, void* user_data = NULL); // Call every frame before Step(). O(N) only when the count changed or after Invalidate(), otherwise O(1).
+    IMGUI_API bool  Step();                                             // Call until it returns false. The DisplayStart/DisplayEnd fields will be set and you can process/draw those items.
+    IMGUI_API void  End();                                              // Automatically called on the last call of Step() that returns false.
+    void            Invalidate()                                        { Dirty = true; }
+    IMGUI_API void  InvalidateItem(int idx);                            // Re-query the height of a single item. O(log N).
+    IMGUI_API void  SetItemHeight(int idx, float height);               // Set the height of a single item directly (e.g. measured after submission). O(log N).
+    IMGUI_API float GetItemOffset(int idx) const;                       // Sum of the heights of items [0, idx). O(log N).
+    IMGUI_API int   GetItemAtOffset(float offset) const;                // Index of the item covering 'offset' pixels from the start of the list. O(log N).
+    float           GetTotalHeight() const                              { return GetItemOffset(ItemsCount); }
+};
+
 //-----------------------------------------------------------------------------
 // Draw List
 // Hold a series of drawing commands. The user provides a renderer for ImDrawData which essentially contains an array of ImDrawList.
@@ -1543,7 +1687,9 @@ enum ImDrawCornerFlags_
 enum ImDrawListFlags_
 {
     ImDrawListFlags_AntiAliasedLines = 1 << 0,
-    ImDrawListFlags_AntiAliasedFill  = 1 << 1
+    ImDrawListFlags_AntiAliasedFill  = 1 << 1,
+    ImDrawListFlags_Fingerprint      = 1 << 2,  // Hash the parameters of every primitive, clip rectangle and texture change into _Fingerprint (used by ImGuiWindowFlags_RetainDrawList)
+    ImDrawListFlags_SkipTessellation = 1 << 3   // Don't output primitives added with the Add*() functions. Vertices written directly with PrimReserve() are not affected.
 };
 
 // Draw command list
@@ -1572,6 +1718,7 @@ struct ImDrawList
     int                     _ChannelsCurrent;   // [Internal] current channel number (0)
     int                     _ChannelsCount;     // [Internal] number of active channels (1+)
     ImVector<ImDrawChannel> _Channels;          // [Internal] draw channels for columns API (not resized down so _ChannelsCount may be smaller than _Channels.Size)
+    ImU32                   _Fingerprint;       // [Internal] hash of the submitted primitives since Clear(), when ImDrawListFlags_Fingerprint is set
 
     // If you want to create ImDrawList instances, pass them ImGui::GetDrawListSharedData() or create and use your own ImDrawListSharedData (so you can use ImDrawList without ImGui)
     ImDrawList(const ImDrawListSharedData* shared_data) { _Data = shared_data; _OwnerName = NULL; Clear(); }
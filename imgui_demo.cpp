@@ -3149,7 +3149,7 @@ static void ShowExampleAppLongText(bool* p_open)
     static ImGuiTextBuffer log;
     static int lines = 0;
     ImGui::Text("Printing unusually long amount of text.");
-    ImGui::Combo("Test type", &test_type, "Single call to TextUnformatted()\0Multiple calls to Text(), clipped manually\0Multiple calls to Text(), not clipped (slow)\0");
+    ImGui::Combo("Test type", &test_type, "Single call to TextUnformatted()\0Multiple calls to Text(), clipped manually\0Multiple calls to Text(), not clipped (slow)\0Variable height lines, clipped manually\0");
     ImGui::Text("Buffer contents: %d lines, %d bytes", lines, log.size());
     if (ImGui::Button("Clear")) { log.clear(); lines = 0; }
     ImGui::SameLine();
@@ -3184,6 +3184,25 @@ static void ShowExampleAppLongText(bool* p_open)
             ImGui::Text("%i The quick brown fox jumps over the lazy dog", i);
         ImGui::PopStyleVar();
         break;
+    case 3:
+        {
+            // Every 10th line spans two lines of text - demonstrate how to use the ImGuiListClipperVariable helper.
+            // The clipper is static: its height index is only rebuilt when the number of lines changes.
+            struct Funcs { static float LineHeight(void*, int idx) { return ImGui::GetTextLineHeight() * ((idx % 10) == 0 ? 2.0f : 1.0f); } };
+            static ImGuiListClipperVariable clipper;
+            ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0,0));
+            clipper.Begin(lines, Funcs::LineHeight);
+            while (clipper.Step())
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                {
+                    if ((i % 10) == 0)
+                        ImGui::Text("%i The quick brown fox\n   jumps over the lazy dog", i);
+                    else
+                        ImGui::Text("%i The quick brown fox jumps over the lazy dog", i);
+                }
+            ImGui::PopStyleVar();
+            break;
+        }
     }
     ImGui::EndChild();
     ImGui::End();
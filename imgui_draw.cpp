@@ -325,6 +325,7 @@ void ImDrawList::Clear()
     _Path.resize(0);
     _ChannelsCurrent = 0;
     _ChannelsCount = 1;
+    _Fingerprint = 0;
     // NB: Do not clear channels so our allocations are re-used after the first frame.
 }
 
@@ -352,6 +353,7 @@ void ImDrawList::ClearFreeMemory()
 
 ImDrawList* ImDrawList::CloneOutput() const
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_DrawList);
     ImDrawList* dst = IM_NEW(ImDrawList(NULL));
     dst->CmdBuffer = CmdBuffer;
     dst->IdxBuffer = IdxBuffer;
@@ -364,8 +366,41 @@ ImDrawList* ImDrawList::CloneOutput() const
 #define GetCurrentClipRect()    (_ClipRectStack.Size ? _ClipRectStack.Data[_ClipRectStack.Size-1]  : _Data->ClipRectFullscreen)
 #define GetCurrentTextureId()   (_TextureIdStack.Size ? _TextureIdStack.Data[_TextureIdStack.Size-1] : NULL)
 
+// Fingerprint of the submitted primitives (see ImGuiWindowFlags_RetainDrawList).
+// This runs for every primitive so it mixes 32-bit words rather than using the byte-wise CRC32 of ImHash().
+static inline ImU32 ImDrawListFingerprintData(ImU32 hash, const void* data, int data_size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (; data_size >= 4; data_size -= 4, p += 4)
+    {
+        ImU32 word;
+        memcpy(&word, p, 4);
+        hash = ((hash ^ word) * 0x9E3779B1) ^ (hash >> 15);
+    }
+    for (; data_size > 0; data_size--, p++)
+        hash = ((hash ^ *p) * 0x9E3779B1) ^ (hash >> 15);
+    return hash;
+}
+
+// Hash the parameters of a primitive into the draw list fingerprint. Return true if the primitive must not be tessellated.
+// Both paths hash identically so the submissions of a skipped frame can be compared with the ones of the retained vertices.
+static inline bool ImDrawListFingerprintPrim(ImDrawList* draw_list, ImU32 col, const ImVec4& params, const void* data = NULL, int data_size = 0)
+{
+    if (!(draw_list->Flags & (ImDrawListFlags_Fingerprint | ImDrawListFlags_SkipTessellation)))
+        return false;
+    if (draw_list->Flags & ImDrawListFlags_Fingerprint)
+    {
+        ImU32 hash = ImDrawListFingerprintData(draw_list->_Fingerprint ^ col, &params, (int)sizeof(params));
+        if (data_size > 0)
+            hash = ImDrawListFingerprintData(hash, data, data_size);
+        draw_list->_Fingerprint = hash;
+    }
+    return (draw_list->Flags & ImDrawListFlags_SkipTessellation) != 0;
+}
+
 void ImDrawList::AddDrawCmd()
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_DrawList);
     ImDrawCmd draw_cmd;
     draw_cmd.ClipRect = GetCurrentClipRect();
     draw_cmd.TextureId = GetCurrentTextureId();
@@ -384,6 +419,8 @@ void ImDrawList::AddCallback(ImDrawCallback callback, void* callback_data)
     }
     current_cmd->UserCallback = callback;
     current_cmd->UserCallbackData = callback_data;
+    if (Flags & ImDrawListFlags_Fingerprint)
+        _Fingerprint = ImDrawListFingerprintData(ImDrawListFingerprintData(_Fingerprint, &callback, (int)sizeof(callback)), &callback_data, (int)sizeof(callback_data));
 
     AddDrawCmd(); // Force a new command after us (see comment below)
 }
@@ -394,6 +431,8 @@ void ImDrawList::UpdateClipRect()
 {
     // If current command is used with different settings we need to add a new command
     const ImVec4 curr_clip_rect = GetCurrentClipRect();
+    if (Flags & ImDrawListFlags_Fingerprint)
+        _Fingerprint = ImDrawListFingerprintData(_Fingerprint, &curr_clip_rect, (int)sizeof(curr_clip_rect));
     ImDrawCmd* curr_cmd = CmdBuffer.Size > 0 ? &CmdBuffer.Data[CmdBuffer.Size-1] : NULL;
     if (!curr_cmd || (curr_cmd->ElemCount != 0 && memcmp(&curr_cmd->ClipRect, &curr_clip_rect, sizeof(ImVec4)) != 0) || curr_cmd->UserCallback != NULL)
     {
@@ -413,6 +452,8 @@ void ImDrawList::UpdateTextureID()
 {
     // If current command is used with different settings we need to add a new command
     const ImTextureID curr_texture_id = GetCurrentTextureId();
+    if (Flags & ImDrawListFlags_Fingerprint)
+        _Fingerprint = ImDrawListFingerprintData(_Fingerprint, &curr_texture_id, (int)sizeof(curr_texture_id));
     ImDrawCmd* curr_cmd = CmdBuffer.Size ? &CmdBuffer.back() : NULL;
     if (!curr_cmd || (curr_cmd->ElemCount != 0 && curr_cmd->TextureId != curr_texture_id) || curr_cmd->UserCallback != NULL)
     {
@@ -434,6 +475,7 @@ void ImDrawList::UpdateTextureID()
 // Render-level scissoring. This is passed down to your render function but not used for CPU-side coarse clipping. Prefer using higher-level ImGui::PushClipRect() to affect logic (hit-testing and widget culling)
 void ImDrawList::PushClipRect(ImVec2 cr_min, ImVec2 cr_max, bool intersect_with_current_clip_rect)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_DrawList);
     ImVec4 cr(cr_min.x, cr_min.y, cr_max.x, cr_max.y);
     if (intersect_with_current_clip_rect && _ClipRectStack.Size)
     {
@@ -464,6 +506,7 @@ void ImDrawList::PopClipRect()
 
 void ImDrawList::PushTextureID(ImTextureID texture_id)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_DrawList);
     _TextureIdStack.push_back(texture_id);
     UpdateTextureID();
 }
@@ -477,6 +520,7 @@ void ImDrawList::PopTextureID()
 
 void ImDrawList::ChannelsSplit(int channels_count)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_DrawList);
     IM_ASSERT(_ChannelsCurrent == 0 && _ChannelsCount == 1);
     int old_channels_count = _Channels.Size;
     if (old_channels_count < channels_count)
@@ -546,6 +590,8 @@ void ImDrawList::ChannelsSetCurrent(int idx)
 {
     IM_ASSERT(idx < _ChannelsCount);
     if (_ChannelsCurrent == idx) return;
+    if (Flags & ImDrawListFlags_Fingerprint)
+        _Fingerprint = ImDrawListFingerprintData(_Fingerprint, &idx, (int)sizeof(idx));
     memcpy(&_Channels.Data[_ChannelsCurrent].CmdBuffer, &CmdBuffer, sizeof(CmdBuffer)); // copy 12 bytes, four times
     memcpy(&_Channels.Data[_ChannelsCurrent].IdxBuffer, &IdxBuffer, sizeof(IdxBuffer));
     _ChannelsCurrent = idx;
@@ -560,13 +606,20 @@ void ImDrawList::PrimReserve(int idx_count, int vtx_count)
     ImDrawCmd& draw_cmd = CmdBuffer.Data[CmdBuffer.Size-1];
     draw_cmd.ElemCount += idx_count;
 
+    // Only swap the allocation tag when a buffer actually needs to grow, this is called for every primitive.
     int vtx_buffer_old_size = VtxBuffer.Size;
+    int idx_buffer_old_size = IdxBuffer.Size;
+    const bool grow = (vtx_buffer_old_size + vtx_count > VtxBuffer.Capacity) || (idx_buffer_old_size + idx_count > IdxBuffer.Capacity);
+    ImGuiAllocTag backup_tag = grow ? ImGui::SetAllocTag(ImGuiAllocTag_DrawList) : 0;
+
     VtxBuffer.resize(vtx_buffer_old_size + vtx_count);
     _VtxWritePtr = VtxBuffer.Data + vtx_buffer_old_size;
 
-    int idx_buffer_old_size = IdxBuffer.Size;
     IdxBuffer.resize(idx_buffer_old_size + idx_count);
     _IdxWritePtr = IdxBuffer.Data + idx_buffer_old_size;
+
+    if (grow)
+        ImGui::SetAllocTag(backup_tag);
 }
 
 // Fully unrolled with inline call to keep our debug builds decently fast.
@@ -619,6 +672,8 @@ void ImDrawList::AddPolyline(const ImVec2* points, const int points_count, ImU32
 {
     if (points_count < 2)
         return;
+    if (ImDrawListFingerprintPrim(this, col, ImVec4(thickness, closed ? 1.0f : 0.0f, 0.0f, 0.0f), points, points_count * (int)sizeof(ImVec2)))
+        return;
 
     const ImVec2 uv = _Data->TexUvWhitePixel;
 
@@ -796,6 +851,9 @@ void ImDrawList::AddPolyline(const ImVec2* points, const int points_count, ImU32
 
 void ImDrawList::AddConvexPolyFilled(const ImVec2* points, const int points_count, ImU32 col)
 {
+    if (ImDrawListFingerprintPrim(this, col, ImVec4(0.0f, 0.0f, 0.0f, 0.0f), points, points_count * (int)sizeof(ImVec2)))
+        return;
+
     const ImVec2 uv = _Data->TexUvWhitePixel;
 
     if (Flags & ImDrawListFlags_AntiAliasedFill)
@@ -877,6 +935,7 @@ void ImDrawList::AddConvexPolyFilled(const ImVec2* points, const int points_coun
 
 void ImDrawList::PathArcToFast(const ImVec2& centre, float radius, int a_min_of_12, int a_max_of_12)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_DrawList);
     if (radius == 0.0f || a_min_of_12 > a_max_of_12)
     {
         _Path.push_back(centre);
@@ -892,6 +951,7 @@ void ImDrawList::PathArcToFast(const ImVec2& centre, float radius, int a_min_of_
 
 void ImDrawList::PathArcTo(const ImVec2& centre, float radius, float a_min, float a_max, int num_segments)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_DrawList);
     if (radius == 0.0f)
     {
         _Path.push_back(centre);
@@ -933,6 +993,7 @@ static void PathBezierToCasteljau(ImVector<ImVec2>* path, float x1, float y1, fl
 
 void ImDrawList::PathBezierCurveTo(const ImVec2& p2, const ImVec2& p3, const ImVec2& p4, int num_segments)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_DrawList);
     ImVec2 p1 = _Path.back();
     if (num_segments == 0)
     {
@@ -1012,6 +1073,8 @@ void ImDrawList::AddRectFilled(const ImVec2& a, const ImVec2& b, ImU32 col, floa
     }
     else
     {
+        if (ImDrawListFingerprintPrim(this, col, ImVec4(a.x, a.y, b.x, b.y)))
+            return;
         PrimReserve(6, 4);
         PrimRect(a, b, col);
     }
@@ -1021,6 +1084,9 @@ void ImDrawList::AddRectFilledMultiColor(const ImVec2& a, const ImVec2& c, ImU32
 {
     if (((col_upr_left | col_upr_right | col_bot_right | col_bot_left) & IM_COL32_A_MASK) == 0)
         return;
+    const ImU32 cols[3] = { col_upr_right, col_bot_right, col_bot_left };
+    if (ImDrawListFingerprintPrim(this, col_upr_left, ImVec4(a.x, a.y, c.x, c.y), cols, (int)sizeof(cols)))
+        return;
 
     const ImVec2 uv = _Data->TexUvWhitePixel;
     PrimReserve(6, 4);
@@ -1126,6 +1192,13 @@ void ImDrawList::AddText(const ImFont* font, float font_size, const ImVec2& pos,
 
     IM_ASSERT(font->ContainerAtlas->TexID == _TextureIdStack.back());  // Use high-level ImGui::PushFont() or low-level ImDrawList::PushTextureId() to change font.
 
+    if (Flags & (ImDrawListFlags_Fingerprint | ImDrawListFlags_SkipTessellation))
+    {
+        ImDrawListFingerprintPrim(this, col, cpu_fine_clip_rect ? *cpu_fine_clip_rect : ImVec4(0.0f, 0.0f, 0.0f, 0.0f), &font, (int)sizeof(font));
+        if (ImDrawListFingerprintPrim(this, col, ImVec4(pos.x, pos.y, font_size, wrap_width), text_begin, (int)(text_end - text_begin)))
+            return;
+    }
+
     ImVec4 clip_rect = _ClipRectStack.back();
     if (cpu_fine_clip_rect)
     {
@@ -1151,8 +1224,12 @@ void ImDrawList::AddImage(ImTextureID user_texture_id, const ImVec2& a, const Im
     if (push_texture_id)
         PushTextureID(user_texture_id);
 
-    PrimReserve(6, 4);
-    PrimRectUV(a, b, uv_a, uv_b, col);
+    const ImVec4 uvs(uv_a.x, uv_a.y, uv_b.x, uv_b.y);
+    if (!ImDrawListFingerprintPrim(this, col, ImVec4(a.x, a.y, b.x, b.y), &uvs, (int)sizeof(uvs)))
+    {
+        PrimReserve(6, 4);
+        PrimRectUV(a, b, uv_a, uv_b, col);
+    }
 
     if (push_texture_id)
         PopTextureID();
@@ -1167,8 +1244,12 @@ void ImDrawList::AddImageQuad(ImTextureID user_texture_id, const ImVec2& a, cons
     if (push_texture_id)
         PushTextureID(user_texture_id);
 
-    PrimReserve(6, 4);
-    PrimQuadUV(a, b, c, d, uv_a, uv_b, uv_c, uv_d, col);
+    const ImVec2 quad[8] = { a, b, c, d, uv_a, uv_b, uv_c, uv_d };
+    if (!ImDrawListFingerprintPrim(this, col, ImVec4(0.0f, 0.0f, 0.0f, 0.0f), quad, (int)sizeof(quad)))
+    {
+        PrimReserve(6, 4);
+        PrimQuadUV(a, b, c, d, uv_a, uv_b, uv_c, uv_d, col);
+    }
 
     if (push_texture_id)
         PopTextureID();
@@ -1442,6 +1523,7 @@ void    ImFontAtlas::Clear()
 
 void    ImFontAtlas::GetTexDataAsAlpha8(unsigned char** out_pixels, int* out_width, int* out_height, int* out_bytes_per_pixel)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     // Build atlas on demand
     if (TexPixelsAlpha8 == NULL)
     {
@@ -1458,6 +1540,7 @@ void    ImFontAtlas::GetTexDataAsAlpha8(unsigned char** out_pixels, int* out_wid
 
 void    ImFontAtlas::GetTexDataAsRGBA32(unsigned char** out_pixels, int* out_width, int* out_height, int* out_bytes_per_pixel)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     // Convert to RGBA32 format on demand
     // Although it is likely to be the most commonly used format, our font rendering is 1 channel / 8 bpp
     if (!TexPixelsRGBA32)
@@ -1482,6 +1565,7 @@ void    ImFontAtlas::GetTexDataAsRGBA32(unsigned char** out_pixels, int* out_wid
 
 ImFont* ImFontAtlas::AddFont(const ImFontConfig* font_cfg)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     IM_ASSERT(font_cfg->FontData != NULL && font_cfg->FontDataSize > 0);
     IM_ASSERT(font_cfg->SizePixels > 0.0f);
 
@@ -1543,6 +1627,7 @@ ImFont* ImFontAtlas::AddFontDefault(const ImFontConfig* font_cfg_template)
 
 ImFont* ImFontAtlas::AddFontFromFileTTF(const char* filename, float size_pixels, const ImFontConfig* font_cfg_template, const ImWchar* glyph_ranges)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     int data_size = 0;
     void* data = ImFileLoadToMemory(filename, "rb", &data_size, 0);
     if (!data)
@@ -1576,6 +1661,7 @@ ImFont* ImFontAtlas::AddFontFromMemoryTTF(void* ttf_data, int ttf_size, float si
 
 ImFont* ImFontAtlas::AddFontFromMemoryCompressedTTF(const void* compressed_ttf_data, int compressed_ttf_size, float size_pixels, const ImFontConfig* font_cfg_template, const ImWchar* glyph_ranges)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     const unsigned int buf_decompressed_size = stb_decompress_length((const unsigned char*)compressed_ttf_data);
     unsigned char* buf_decompressed_data = (unsigned char *)ImGui::MemAlloc(buf_decompressed_size);
     stb_decompress(buf_decompressed_data, (const unsigned char*)compressed_ttf_data, (unsigned int)compressed_ttf_size);
@@ -1598,6 +1684,7 @@ ImFont* ImFontAtlas::AddFontFromMemoryCompressedBase85TTF(const char* compressed
 
 int ImFontAtlas::AddCustomRectRegular(unsigned int id, int width, int height)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     IM_ASSERT(id >= 0x10000);
     IM_ASSERT(width > 0 && width <= 0xFFFF);
     IM_ASSERT(height > 0 && height <= 0xFFFF);
@@ -1611,6 +1698,7 @@ int ImFontAtlas::AddCustomRectRegular(unsigned int id, int width, int height)
 
 int ImFontAtlas::AddCustomRectFontGlyph(ImFont* font, ImWchar id, int width, int height, float advance_x, const ImVec2& offset)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     IM_ASSERT(font != NULL);
     IM_ASSERT(width > 0 && width <= 0xFFFF);
     IM_ASSERT(height > 0 && height <= 0xFFFF);
@@ -1657,6 +1745,7 @@ bool ImFontAtlas::GetMouseCursorTexData(ImGuiMouseCursor cursor_type, ImVec2* ou
 
 bool    ImFontAtlas::Build()
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     return ImFontAtlasBuildWithStbTruetype(this);
 }
 
@@ -2188,6 +2277,7 @@ void    ImFont::ClearOutputData()
 
 void ImFont::BuildLookupTable()
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     int max_codepoint = 0;
     for (int i = 0; i != Glyphs.Size; i++)
         max_codepoint = ImMax(max_codepoint, (int)Glyphs[i].Codepoint);
@@ -2233,6 +2323,7 @@ void ImFont::SetFallbackChar(ImWchar c)
 
 void ImFont::GrowIndex(int new_size)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     IM_ASSERT(IndexAdvanceX.Size == IndexLookup.Size);
     if (new_size <= IndexLookup.Size)
         return;
@@ -2242,6 +2333,7 @@ void ImFont::GrowIndex(int new_size)
 
 void ImFont::AddGlyph(ImWchar codepoint, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, float advance_x)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     Glyphs.resize(Glyphs.Size + 1);
     ImFontGlyph& glyph = Glyphs.back();
     glyph.Codepoint = (ImWchar)codepoint;
@@ -2265,6 +2357,7 @@ void ImFont::AddGlyph(ImWchar codepoint, float x0, float y0, float x1, float y1,
 
 void ImFont::AddRemapChar(ImWchar dst, ImWchar src, bool overwrite_dst)
 {
+    ImGuiAllocTagScope alloc_tag(ImGuiAllocTag_Font);
     IM_ASSERT(IndexLookup.Size > 0);    // Currently this can only be called AFTER the font has been built, aka after calling ImFontAtlas::GetTexDataAs*() function.
     int index_size = IndexLookup.Size;
 
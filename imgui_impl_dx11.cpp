@@ -58,6 +58,7 @@ void ImGui_ImplDX11_ShutdownPlatformInterface();
 // (this used to be set in io.RenderDrawListsFn and called by ImGui::Render(), but you can now call this directly from your main loop)
 void ImGui_ImplDX11_RenderDrawData(ImDrawData* draw_data)
 {
+    IMGUI_PROFILE_SCOPE("ImGui_ImplDX11_RenderDrawData");
     ID3D11DeviceContext* ctx = g_pd3dDeviceContext;
 
     // Create and grow vertex/index buffers if needed
@@ -160,6 +160,9 @@ void    ImGui_ImplWin32_NewFrame()
 {
     ImGuiIO& io = ImGui::GetIO();
 
+    // This scope lands at the end of the previous profiler frame, ImGui::NewFrame() closes it
+    IMGUI_PROFILE_SCOPE("ImGui_ImplWin32_NewFrame");
+
     // Setup display size (every frame to accommodate for window resizing)
     RECT rect;
     ::GetClientRect(g_hWnd, &rect);
@@ -588,6 +588,84 @@ struct ImGuiNextWindowData
     }
 };
 
+// Account the MemAlloc() calls made within a scope to a subsystem
+struct ImGuiAllocTagScope
+{
+    ImGuiAllocTag           BackupTag;
+    ImGuiAllocTagScope(ImGuiAllocTag tag)   { BackupTag = ImGui::SetAllocTag(tag); }
+    ~ImGuiAllocTagScope()                   { ImGui::SetAllocTag(BackupTag); }
+};
+
+// Linear allocator for scratch memory that doesn't outlive the frame (see ImGui::MemAllocFrame())
+// Reset by NewFrame(): allocations that didn't fit in Block are freed and Block grows so that the next frames fit without allocating.
+struct IMGUI_API ImGuiFrameArena
+{
+    ImVector<char>          Block;
+    int                     BlockUsed;
+    ImVector<void*>         Overflow;                           // Allocations made this frame while Block was full
+    int                     OverflowSize;
+
+    ImGuiFrameArena()       { BlockUsed = OverflowSize = 0; }
+    ~ImGuiFrameArena()      { FreeOverflow(); }
+    void*                   Alloc(size_t size);
+    void                    Reset();
+    void                    FreeOverflow();
+};
+
+#ifdef IMGUI_ENABLE_PROFILER
+#ifndef IMGUI_PROFILER_FRAMES
+#define IMGUI_PROFILER_FRAMES   120
+#endif
+
+// A timed scope recorded by ImGui::ProfilerPush()/ProfilerPop(), or by Begin()/End() for windows
+struct ImGuiProfilerEvent
+{
+    const char*             Name;                               // Persistent name, or NULL when the name was copied into the frame NameBuffer
+    int                     NameOffset;                         // Offset into ImGuiProfilerFrame::NameBuffer when Name is NULL
+    ImGuiID                 WindowID;                           // Set for window Begin()/End() scopes
+    int                     Depth;
+    ImU64                   StartTicks, EndTicks;               // Nanoseconds
+};
+
+// All scopes recorded from one NewFrame() to the next
+struct ImGuiProfilerFrame
+{
+    int                             FrameCount;                 // Value of ImGuiContext::FrameCount during this frame, -1 if the slot was never used
+    ImU64                           StartTicks, EndTicks;
+    ImVector<ImGuiProfilerEvent>    Events;                     // In push order, which is a depth-first traversal of the scope tree
+    ImVector<char>                  NameBuffer;
+
+    ImGuiProfilerFrame()            { FrameCount = -1; StartTicks = EndTicks = 0; }
+    const char* GetName(const ImGuiProfilerEvent& ev) const { return ev.Name ? ev.Name : NameBuffer.Data + ev.NameOffset; }
+};
+
+// Ring buffer of the last IMGUI_PROFILER_FRAMES frames. Buffers are recycled with resize(0) so a steady state frame does not allocate.
+struct ImGuiProfiler
+{
+    ImGuiProfilerFrame      Frames[IMGUI_PROFILER_FRAMES];
+    int                     FrameIdx;                           // Slot of the frame currently being recorded
+    ImVector<int>           Stack;                              // Indices of the currently open events in Frames[FrameIdx].Events
+    ImGuiStorage            WindowTimes;                        // Milliseconds per window ID for the metrics window, kept so it is refilled without allocating
+    bool                    Paused;                             // Takes effect on the next NewFrame()
+    bool                    Recording;
+
+    ImGuiProfiler()         { FrameIdx = 0; Paused = false; Recording = true; }
+    ImGuiProfilerFrame*     GetLastFrame()                      { ImGuiProfilerFrame* frame = &Frames[(FrameIdx + IMGUI_PROFILER_FRAMES - 1) % IMGUI_PROFILER_FRAMES]; return frame->FrameCount >= 0 ? frame : NULL; }
+};
+
+#define IMGUI_PROFILE_NEW_FRAME()           ImGui::ProfilerNewFrame()
+#define IMGUI_PROFILE_PUSH(_NAME)           ImGui::ProfilerPush(_NAME)
+#define IMGUI_PROFILE_POP()                 ImGui::ProfilerPop()
+#define IMGUI_PROFILE_WINDOW_PUSH(_WINDOW)  ImGui::ProfilerPushWindow(_WINDOW)
+#define IMGUI_PROFILE_WINDOW_POP()          ImGui::ProfilerPop()
+#else
+#define IMGUI_PROFILE_NEW_FRAME()
+#define IMGUI_PROFILE_PUSH(_NAME)
+#define IMGUI_PROFILE_POP()
+#define IMGUI_PROFILE_WINDOW_PUSH(_WINDOW)
+#define IMGUI_PROFILE_WINDOW_POP()
+#endif // #ifdef IMGUI_ENABLE_PROFILER
+
 // Main state for ImGui
 struct ImGuiContext
 {
@@ -739,10 +817,17 @@ struct ImGuiContext
     int                     WantCaptureKeyboardNextFrame;
     int                     WantTextInputNextFrame;
     char                    TempBuffer[1024*3+1];               // Temporary text buffer
+    ImGuiFrameArena         FrameArena;                         // Scratch memory released at the beginning of every frame
+    ImU64                   FrameAllocsStart;                   // Total MemAlloc() calls at the beginning of the frame, see io.MetricsAllocs
+
+#ifdef IMGUI_ENABLE_PROFILER
+    ImGuiProfiler           Profiler;
+#endif
 
     ImGuiContext(ImFontAtlas* shared_font_atlas)
     {
         Initialized = false;
+        FrameAllocsStart = 0;
         Font = NULL;
         FontSize = FontBaseSize = 0.0f;
         FontAtlasOwnedByContext = shared_font_atlas ? false : true;
@@ -1003,6 +1088,12 @@ struct IMGUI_API ImGuiWindow
 
     ImDrawList*             DrawList;                           // == &DrawListInst (for backward compatibility reason with code using imgui_internal.h we keep this a pointer)
     ImDrawList              DrawListInst;
+    ImDrawList*             DrawCacheSkipList;                  // ImGuiWindowFlags_RetainDrawList: receives the fingerprinted, non-tessellated submissions while DrawListInst is reused
+    ImU32                   DrawCacheFingerprint;               // Fingerprint of the submissions DrawListInst was built from
+    ImU32                   DrawCacheLastFingerprint;           // Fingerprint of the submissions of the last frame
+    ImU32                   DrawCacheStateHash;                 // Hash of the state affecting the submissions, at Begin() of the last frame
+    bool                    DrawCacheStable;                    // The last frames produced identical submissions
+    bool                    DrawCacheReplaying;                 // DrawListInst is reused this frame and DrawList points to DrawCacheSkipList
     ImGuiWindow*            ParentWindow;                       // If we are a child _or_ popup window, this is pointing to our parent. Otherwise NULL.
     ImGuiWindow*            RootWindow;                         // Point to ourself or first ancestor that is not a child window.
     ImGuiWindow*            RootWindowForTitleBarHighlight;     // Point to ourself or first ancestor which will display TitleBgActive color when this window is active.
@@ -1078,6 +1169,12 @@ namespace ImGui
 
     IMGUI_API void          NewFrameUpdateHoveredWindowAndCaptureFlags();
 
+#ifdef IMGUI_ENABLE_PROFILER
+    // Profiler
+    IMGUI_API void          ProfilerNewFrame();
+    IMGUI_API void          ProfilerPushWindow(ImGuiWindow* window);
+#endif
+
     // Viewports
     IMGUI_API ImGuiViewportP*       FindViewportByID(ImGuiID id);
     IMGUI_API void                  SetNextWindowViewport(ImGuiID id);
@@ -0,0 +1,141 @@
+// Standalone checks for the ImGui changes made in this tree, not part of the ImGuiCLI build. Runs headless, no backend needed.
+//   cl /EHsc /O2 imgui_tests.cpp imgui.cpp imgui_draw.cpp imgui_demo.cpp
+//   g++ -std=c++11 -O2 -pthread imgui_tests.cpp imgui.cpp imgui_draw.cpp imgui_demo.cpp -o imgui_tests
+// Exits with 1 if a check fails. "imgui_tests bench" also times Text() against TextUnformatted().
+
+#include "imgui.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int  g_Failures = 0;
+static int  g_MallocCalls = 0;
+
+#define CHECK(_EXPR)    do { if (!(_EXPR)) { printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #_EXPR); g_Failures++; } } while (0)
+
+static void* CountingAlloc(size_t size, void* user_data) { (void)user_data; g_MallocCalls++; return malloc(size); }
+static void* PlainAlloc(size_t size, void* user_data)    { (void)user_data; return malloc(size); }
+static void  PlainFree(void* ptr, void* user_data)       { (void)user_data; free(ptr); }
+
+static void NewHeadlessContext()
+{
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(1920, 1080);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = NULL;
+    unsigned char* pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+}
+
+// Once every window has been created and every buffer has grown to its size, a frame of the demo and metrics windows must not allocate.
+// The warm-up is longer than IMGUI_PROFILER_FRAMES, so each slot of the profiler ring buffer has been used once or more.
+static void TestSteadyStateAllocations()
+{
+    ImGui::SetAllocatorFunctions(CountingAlloc, PlainFree);
+    NewHeadlessContext();
+    ImGuiIO& io = ImGui::GetIO();
+    int steady_mallocs = 0, steady_metrics = 0;
+    for (int frame = 0; frame < 400; frame++)
+    {
+        const int mallocs_before = g_MallocCalls;
+        ImGui::NewFrame();
+        ImGui::ShowDemoWindow();
+        bool open = true;
+        ImGui::ShowMetricsWindow(&open);
+        float* scratch = (float*)ImGui::MemAllocFrame(sizeof(float) * 1000);
+        CHECK(((size_t)scratch & 15) == 0);
+        scratch[999] = 1.0f;
+        ImGui::Render();
+        if (frame >= 300)
+        {
+            steady_mallocs += g_MallocCalls - mallocs_before;
+            steady_metrics += io.MetricsAllocs;
+        }
+    }
+    printf("steady state: %d allocations in 100 frames, io.MetricsAllocs %d\n", steady_mallocs, steady_metrics);
+    CHECK(steady_mallocs == 0);
+    CHECK(steady_metrics == 0);
+
+    ImGui::DestroyContext();
+    for (int tag = 0; tag < ImGuiAllocTag_COUNT; tag++)
+    {
+        CHECK(ImGui::GetAllocStats(tag).LiveCount == 0);
+        CHECK(ImGui::GetAllocStats(tag).LiveBytes == 0);
+    }
+    ImGui::SetAllocatorFunctions(PlainAlloc, PlainFree);
+}
+
+// The accounting must stay consistent when MemAlloc()/MemFree() are called from several threads at once
+static void TestConcurrentAllocations()
+{
+    const ImGuiAllocStats before = ImGui::GetAllocStats(ImGuiAllocTag_Other);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+        threads.push_back(std::thread([]()
+        {
+            void* ptrs[64];
+            for (int round = 0; round < 2000; round++)
+            {
+                for (int n = 0; n < 64; n++)
+                    ptrs[n] = ImGui::MemAlloc(16 + n);
+                for (int n = 0; n < 64; n++)
+                    ImGui::MemFree(ptrs[n]);
+            }
+        }));
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+    const ImGuiAllocStats& after = ImGui::GetAllocStats(ImGuiAllocTag_Other);
+    CHECK(after.LiveCount == before.LiveCount);
+    CHECK(after.LiveBytes == before.LiveBytes);
+    CHECK(after.TotalCount == before.TotalCount + 4 * 2000 * 64);
+}
+
+// Log-like lines drawn through the printf path and the unformatted one, as the CLI Text() binding did before and does now
+static void BenchText()
+{
+    NewHeadlessContext();
+    std::vector<std::string> lines;
+    for (int n = 0; n < 5000; n++)
+        lines.push_back("[12:00:00.123] INFO  subsystem/module: message number " + std::to_string(n) + " value=42 100% done");
+    for (int unformatted = 0; unformatted < 2; unformatted++)
+    {
+        double best_us = 1e9;
+        for (int run = 0; run < 20; run++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int frame = 0; frame < 20; frame++)
+            {
+                ImGui::NewFrame();
+                ImGui::SetNextWindowSize(ImVec2(1900, 1000));
+                ImGui::Begin("log");
+                for (size_t n = 0; n < lines.size(); n++)
+                    if (unformatted)
+                        ImGui::TextUnformatted(lines[n].c_str(), lines[n].c_str() + lines[n].size());
+                    else
+                        ImGui::Text("%s", lines[n].c_str());
+                ImGui::End();
+                ImGui::Render();
+            }
+            const double us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / 20;
+            best_us = us < best_us ? us : best_us;
+        }
+        printf("%-16s %8.1f us/frame (%d lines)\n", unformatted ? "TextUnformatted" : "Text(fmt)", best_us, (int)lines.size());
+    }
+    ImGui::DestroyContext();
+}
+
+int main(int argc, char** argv)
+{
+    TestSteadyStateAllocations();
+    TestConcurrentAllocations();
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        BenchText();
+    printf(g_Failures ? "%d check(s) failed\n" : "all checks passed\n", g_Failures);
+    return g_Failures ? 1 : 0;
+}